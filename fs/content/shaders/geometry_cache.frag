@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec4 Color;
+in float Visible;
+
+out vec4 FragColor;
+
+void main()
+{
+    // Outside the instance's sweep
+    if (Visible < 0.5)
+        discard;
+
+    FragColor = Color;
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Per vertex
+layout(location = 0) in vec3 Vertex;
+layout(location = 1) in float ColorRate;
+layout(location = 2) in float ArcPos;
+
+// Per instance, proj * view * model premultiplied on the CPU
+layout(location = 3) in vec4 WvpRow0;
+layout(location = 4) in vec4 WvpRow1;
+layout(location = 5) in vec4 WvpRow2;
+layout(location = 6) in vec4 WvpRow3;
+layout(location = 7) in vec4 Color0;
+layout(location = 8) in vec4 Color1;
+layout(location = 9) in vec2 Arc;       // Start, length
+
+out vec4 Color;
+out float Visible;
+
+void main()
+{
+    vec4 pos = vec4(Vertex, 1);
+
+    gl_Position = vec4(dot(WvpRow0, pos),
+                       dot(WvpRow1, pos),
+                       dot(WvpRow2, pos),
+                       dot(WvpRow3, pos));
+
+    Color = mix(Color0, Color1, ColorRate);
+    Visible = (ArcPos < 0.0 || Arc.y >= 1.0 || fract(ArcPos - Arc.x) <= Arc.y) ? 1.0 : 0.0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <string>
+#include <vector>
+
+// Host-native snapshot of what the editor derives from a PTCL resource, so
+// later launches of the same pack skip the work. It currently holds the
+// texture previews, detiled and converted as TextureStreamer uploads them.
+//
+// The file is named after the MD5 of the source PTCL and laid out for
+// mapping: a header, a table of records sorted by source offset, then the
+// data. Records refer to their data by file offset. open() maps the whole
+// file copy-on-write and turns those offsets into pointers in place, which
+// only touches the table pages; data pages are read when a texture is first
+// uploaded. Files of another version, byte order or source are ignored and
+// replaced on the next bake.
+class BakedCache
+{
+public:
+    static constexpr u32 cMagic = 0x4B414245;       // "EBAK"
+    static constexpr u32 cVersion = 1;
+    static constexpr u32 cByteOrder = 0x01020304;   // As written by the host
+    static constexpr u32 cDataAlignment = 256;
+
+    struct Header
+    {
+        u32     magic;
+        u32     version;
+        u32     byte_order;
+        u32     header_size;
+        u64     file_size;
+        u32     texture_num;
+        u32     texture_table;      // File offset
+        char    source_hash[32];    // MD5 of the PTCL, hex
+    };
+    static_assert(sizeof(Header) == 64, "BakedCache::Header size mismatch");
+
+    struct TextureRecord
+    {
+        u32     source_offset;      // Of the image data in the PTCL
+        u32     width;
+        u32     height;
+        u32     compressed_format;  // GX2 format of BC1-BC5 blocks, 0 for RGBA8
+        u32     size;
+        u32     reserved;
+        u64     data;               // File offset on disk, address once opened
+    };
+    static_assert(sizeof(TextureRecord) == 32, "BakedCache::TextureRecord size mismatch");
+
+    struct Texture
+    {
+        u32             source_offset;
+        u32             width;
+        u32             height;
+        u32             compressed_format;
+        std::vector<u8> data;
+    };
+
+public:
+    BakedCache();
+    ~BakedCache();
+
+    BakedCache(const BakedCache&) = delete;
+    BakedCache& operator=(const BakedCache&) = delete;
+
+    static bool isSupported();
+
+    static std::string hashSource(const void* data, u32 size);
+
+    // False if the file is missing or was baked from another source
+    bool open(const std::string& path, const std::string& source_hash);
+    void close();
+
+    bool isOpen() const { return mpBase != nullptr; }
+
+    const TextureRecord* findTexture(u32 source_offset) const;
+    static const u8* getData(const TextureRecord& record) { return reinterpret_cast<const u8*>(uintptr_t(record.data)); }
+
+    u32 getTextureNum() const { return mTextureNum; }
+    u64 getFileSize() const { return mFileSize; }
+
+    // Writes through a temporary file renamed over path, so a reader never
+    // sees a partial file. Safe to call from worker threads.
+    static bool write(const std::string& path, const std::string& source_hash, std::vector<Texture> textures);
+
+private:
+    u8*             mpBase;
+    u64             mFileSize;
+    TextureRecord*  mpTextures;
+    u32             mTextureNum;
+};
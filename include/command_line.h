@@ -0,0 +1,38 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <string>
+
+// Options given on the command line. Without any, the editor starts as usual.
+//
+//   --regression               Render every emitter set and compare it against
+//                              the golden images, then exit with 0 if all
+//                              passed and 1 otherwise
+//   --update-golden            Same, but overwrite the golden images instead
+//   --golden-dir <dir>         Empty uses <cwd>/regression/golden
+//   --report-dir <dir>         Empty uses <cwd>/regression/report
+//   --diff <a> <b>             Compare two PTCL files and print what changed,
+//                              without opening a window. Exits with 0 if they
+//                              are identical, 1 if not and 2 on errors
+//   --json                     Print the comparison as JSON
+//   --optimize <in> <out>      Write a copy of a PTCL with duplicate and unused
+//                              texture data removed, without opening a window.
+//                              Exits with 0 on success and 2 on errors
+struct CommandLine
+{
+    bool        regression;
+    bool        update_golden;
+    std::string golden_dir;
+    std::string report_dir;
+    std::string diff_path[2];   // Empty unless comparing
+    bool        diff_json;
+    std::string optimize_path[2];   // Empty unless optimizing
+
+    s32         exit_code;  // Returned from main() once the main loop ends
+};
+
+extern CommandLine g_CommandLine;
+
+// Returns false on unknown or incomplete options
+bool ParseCommandLine(int argc, char** argv);
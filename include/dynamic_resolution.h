@@ -0,0 +1,73 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+// Scales the resolution the view is rendered at so that its GPU time stays
+// within a budget. The GPU time of the whole view pass is measured with a
+// pair of timestamp queries, read back cFrameLatency frames later, and the
+// scale is nudged towards the one that would have met the budget. The view
+// shows the smaller image stretched to its full size.
+//
+// Timestamps are used instead of an elapsed-time query so the emitter
+// profiler can keep its own GL_TIME_ELAPSED queries inside the same pass.
+class DynamicResolution
+{
+public:
+    static constexpr u32 cFrameLatency = 4;
+
+    struct Stats
+    {
+        f32 gpu_time_ms;    // Smoothed, of the latest collected frame
+        f32 scale;
+    };
+
+public:
+    DynamicResolution();
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    static bool isSupported();
+
+    void initialize();
+    void finalize();
+
+    // When disabled the view renders at exactly its displayed size
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mEnabled && mInitialized; }
+
+    void setTargetTimeMs(f32 time_ms) { mTargetTimeMs = time_ms; }
+    f32 getTargetTimeMs() const { return mTargetTimeMs; }
+
+    void setMinScale(f32 scale) { mMinScale = scale; }
+    f32 getMinScale() const { return mMinScale; }
+
+    void beginFrame();
+    void endFrame();
+
+    // Per-axis scale to apply to the view size
+    f32 getScale() const { return isEnabled() ? mScale : 1.0f; }
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    void update_(f32 gpu_time_ms);
+
+    struct Frame
+    {
+        u32     query[2];   // Begin, end
+        bool    pending;
+    };
+
+    Frame   mFrame[cFrameLatency];
+    u32     mFrameIndex;
+    bool    mInitialized;
+    bool    mEnabled;
+    bool    mRecording;
+    f32     mTargetTimeMs;
+    f32     mMinScale;
+    f32     mScale;
+    f32     mTimeMs;
+    Stats   mStats;
+};
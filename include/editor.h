@@ -8,6 +8,32 @@
 
 #include <nw/math.h>
 
+#include <string>
+#include <vector>
+
+#include <baked_cache.h>
+#include <dynamic_resolution.h>
+#include <emitter_culler.h>
+#include <endian_swap.h>
+#include <emitter_gizmo.h>
+#include <emitter_profiler.h>
+#include <file_watcher.h>
+#include <frame_capture.h>
+#include <geometry_cache.h>
+#include <gpu_fence.h>
+#include <idle_monitor.h>
+#include <live_edit.h>
+#include <overdraw_view.h>
+#include <ptcl_diff.h>
+#include <ptcl_optimizer.h>
+#include <ptcl_writer.h>
+#include <regression_runner.h>
+#include <render_queue.h>
+#include <stream_buffer.h>
+#include <texture_streamer.h>
+#include <thumbnail_cache.h>
+#include <undo_journal.h>
+
 class Editor : public rio::ITask, public rio::lyr::IDrawable
 {
 public:
@@ -17,17 +43,74 @@ public:
     void renderBackground(const rio::lyr::DrawInfo& drawInfo);
 
 private:
+    static constexpr s32 cRenderTargetBucketSize = 64;
+    static constexpr u32 cViewResizeSettleFrameNum = 8;
+    static constexpr u32 cRenderTargetPoolMax = 2;
+
+    struct RenderTarget
+    {
+        rio::Texture2D* color;
+        rio::Texture2D* depth;
+        s32             width;
+        s32             height;
+        GpuFence        fence;  // Last frame that drew into it
+    };
+
+    struct ReloadStats
+    {
+        u32     reload_num;
+        u32     field_num;          // Copied by the last reload, 0 if it re-entered the resource
+        u32     changed_set_num;
+        bool    structural;
+        u64     reload_ns;          // From the settled change to the updated resource
+    };
+
+    static s32 getRenderTargetBucketSize_(s32 size);
+
     void createRenderBuffer_(s32 width, s32 height);
+    void updateRenderBuffer_();
+    void retireRenderTarget_();
+    void releaseRenderTargetPool_(bool force);
     void resizeView_(s32 width, s32 height);
 
     void initEftSystem_();
+    void entryResource_();
+    void clearResource_();
+    bool restartEftSystem_(u32 set_index);
     void calcEftSystem_();
-    void drawEftSystem_(const nw::math::MTX44& proj, const nw::math::MTX34& view, const nw::math::VEC3& camPos, f32 zNear, f32 zFar);
+    void drawEftSystem_(const nw::math::MTX44& proj, const nw::math::MTX34& view, const nw::math::VEC3& camPos, f32 zNear, f32 zFar,
+                        const rio::Texture2D& color_texture, const rio::Texture2D& depth_texture, u8 group_id, bool instrumented);
     void changeEftEmitterSet_();
 
     void calcViewUi_();
     void drawUiEmitterSelection_();
     void drawUiEmitterEdit_();
+    void drawUiProfiler_();
+    void drawUiCapture_();
+    void drawUiRegression_();
+    void drawUiPtclDiff_();
+
+    bool startCapture_(const FrameCapture::Settings& settings, f32 view_width, f32 view_height);
+    void renderCapture_();
+
+    void startRegression_(bool update_golden);
+    void calcRegression_();
+    void cancelRegression_();
+    void resumeThumbnailCache_();
+
+    void renderThumbnail_();
+
+    void benchmarkEndianSwap_();
+
+    void loadBakedCache_();
+
+    void undoEdit_(bool redo);
+    void savePtcl_();
+    void reloadPtcl_();
+    void optimizePtcl_();
+
+    bool isViewBusy_() const;
+    void renderView_(const rio::lyr::DrawInfo& drawInfo);
 
     void bindViewRenderBuffer_();
     void unbindViewRenderBuffer_();
@@ -42,6 +125,8 @@ private:
     void calc_() override;
 
     u8*                     mPtclFile;
+    u32                     mPtclFileSize;
+    std::string             mPtclHash;          // MD5 of the file as read, before Eft touches it
     u32                     mPrevEmitterSet;
     u32                     mCurrentEmitterSet;
     bool                    mLoopEmitterSet;
@@ -53,7 +138,43 @@ private:
     bool                    mViewFocused;
     rio::Texture2D         *mpColorTexture,
                            *mpDepthTexture;
+    rio::BaseVec2i          mRenderTargetSize;  // Allocated size of the textures above
+    rio::BaseVec2i          mRenderSize;        // Sub-viewport drawn into this frame
+    u32                     mViewResizeFrame;   // Frames since the view size last changed
+    std::vector<RenderTarget> mRenderTargetPool;
     rio::RenderTargetColor  mColorTarget;
     rio::RenderTargetDepth  mDepthTarget;
     rio::RenderBuffer       mRenderBuffer;
+    EmitterProfiler         mEmitterProfiler;
+    OverdrawView            mOverdrawView;
+    RenderQueue             mRenderQueue;
+    EmitterCuller           mEmitterCuller;
+    StreamBuffer            mStreamBuffer;
+    GeometryCache           mGeometryCache;
+    GeometryCache::MeshHandle mSphereMesh;
+    EmitterGizmo            mEmitterGizmo;
+    FrameCapture            mFrameCapture;
+    FrameCapture::Settings  mCaptureSettings;
+    rio::OrthoProjection    mCaptureProjection;
+    ThumbnailCache          mThumbnailCache;
+    RegressionRunner        mRegressionRunner;
+    TextureStreamer         mTextureStreamer;
+    BakedCache              mBakedCache;
+    DynamicResolution       mDynamicResolution;
+    IdleMonitor             mIdleMonitor;
+    EndianSwapBenchmark     mEndianSwapBenchmark;
+    PtclWriter              mPtclWriter;
+    LiveEdit                mLiveEdit;
+    UndoJournal             mUndoJournal;
+    FileWatcher             mFileWatcher;
+    ReloadStats             mReloadStats;
+    bool                    mSaveConflict;      // The last save found the file changed on disk
+    std::string             mDiffPath;          // Compared against the edited PTCL
+    PtclDiffReport          mDiffReport;
+    std::string             mDiffError;
+    bool                    mDiffDone;
+    PtclOptimizeReport      mOptimizeReport;
+    std::string             mOptimizeError;
+    bool                    mOptimizeDone;
+    rio::BaseVec2i          mLastRenderSize;    // mRenderSize of the last frame that rendered the view
 };
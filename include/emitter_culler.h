@@ -0,0 +1,58 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <nw/math.h>
+
+#include <unordered_map>
+
+namespace nw { namespace eft {
+
+struct EmitterInstance;
+
+} }
+
+// Keeps world-space bounds of every live emitter's particles, refreshed in
+// the calc phase right after CalcParticle, and decides which emitters can
+// skip RenderEmitter because they are outside the view or fully transparent.
+class EmitterCuller
+{
+public:
+    struct Stats
+    {
+        u32 emitter_num;
+        u32 culled_empty_num;
+        u32 culled_frustum_num;
+        u32 culled_alpha_num;
+    };
+
+public:
+    EmitterCuller();
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+
+    // Call after CalcParticle
+    void update(nw::eft::EmitterInstance* head);
+
+    // Call once per render before querying visibility
+    void beginCull(const nw::math::MTX44& proj, const nw::math::MTX34& view);
+    bool isVisible(const nw::eft::EmitterInstance* emitter);
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    struct Bounds
+    {
+        f32     min[3];
+        f32     max[3];
+        u32     particle_num;
+        bool    cullable;       // Only plain particle emitters have reliable bounds
+        bool    visible_alpha;
+    };
+
+    std::unordered_map<const nw::eft::EmitterInstance*, Bounds> mBounds;
+    f32     mViewProj[4][4];
+    bool    mEnabled;
+    Stats   mStats;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <geometry_cache.h>
+
+namespace nw { namespace eft {
+
+struct EmitterInstance;
+
+} }
+
+// Wireframe overlay of every live emitter's spawn volume and local axes.
+// Each volume type maps to one retained unit mesh that is scaled by
+// volumeRadius and placed with the emitter's world SRT, so all emitters of
+// a type end up in a single instanced draw of the geometry cache.
+class EmitterGizmo
+{
+public:
+    struct Stats
+    {
+        u32 emitter_num;
+        u32 instance_num;
+    };
+
+public:
+    EmitterGizmo();
+
+    void initialize(GeometryCache* geometry_cache);
+    void finalize();
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled && mpGeometryCache; }
+
+    void draw(nw::eft::EmitterInstance* head, const rio::Matrix44f& proj, const rio::Matrix34f& view);
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    enum MeshType
+    {
+        MESH_TYPE_CROSS,
+        MESH_TYPE_CIRCLE,
+        MESH_TYPE_SPHERE,
+        MESH_TYPE_CYLINDER,
+        MESH_TYPE_BOX,
+        MESH_TYPE_LINE,
+        MESH_TYPE_RECTANGLE,
+        MESH_TYPE_AXIS,
+        MESH_TYPE_NUM
+    };
+
+    void drawVolume_(const nw::eft::EmitterInstance* emitter, const rio::Matrix34f& world, const rio::Color4f& color);
+    void drawAxes_(const rio::Matrix34f& world, f32 length);
+    void drawMesh_(MeshType type, const rio::Matrix34f& world, const f32* scale, const f32* trans, const rio::Color4f& color, f32 arc_start = 0.0f, f32 arc_length = 1.0f);
+
+    GeometryCache*              mpGeometryCache;
+    GeometryCache::MeshHandle   mMesh[MESH_TYPE_NUM];
+    bool                        mEnabled;
+    Stats                       mStats;
+};
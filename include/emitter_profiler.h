@@ -0,0 +1,78 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <vector>
+
+namespace nw { namespace eft {
+
+struct EmitterInstance;
+
+} }
+
+// Measures the GPU time of every RenderEmitter call with asynchronous timer
+// queries. Results are read back cFrameLatency frames later so that the
+// CPU never waits on the GPU.
+class EmitterProfiler
+{
+public:
+    static constexpr u32 cFrameLatency = 4;
+    static constexpr u32 cQueryNumPerFrame = 256;   // Matches Config::SetEmitterNum()
+
+    struct Sample
+    {
+        const char* name;
+        u32         particle_num;
+        u32         blend_type;
+        f32         gpu_time_us;
+    };
+
+public:
+    EmitterProfiler();
+    ~EmitterProfiler();
+
+    EmitterProfiler(const EmitterProfiler&) = delete;
+    EmitterProfiler& operator=(const EmitterProfiler&) = delete;
+
+    static bool isSupported();
+
+    void initialize();
+    void finalize();
+
+    // Drops pending frames and samples, which point at emitter names in the
+    // resource. Call before the resource is freed.
+    void reset();
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+
+    void beginFrame();
+    void endFrame();
+
+    void beginEmitter(const nw::eft::EmitterInstance* emitter);
+    void endEmitter();
+
+    // Samples of the latest frame whose queries completed, most expensive first
+    const std::vector<Sample>& getSamples() const { return mSamples; }
+    f32 getTotalTimeUs() const { return mTotalTimeUs; }
+
+private:
+    struct Frame
+    {
+        u32     query[cQueryNumPerFrame];
+        Sample  sample[cQueryNumPerFrame];
+        u32     query_num;
+        bool    pending;
+    };
+
+    void collect_(Frame& frame);
+
+    Frame*              mFrame;
+    u32                 mFrameIndex;
+    bool                mInitialized;
+    bool                mEnabled;
+    bool                mRecording;
+    bool                mQueryActive;
+    std::vector<Sample> mSamples;
+    f32                 mTotalTimeUs;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <vector>
+
+// Bulk conversion of big-endian data, as stored in PTCL and GX2 files, to
+// host order.
+//
+// The layout of a record type is described once in an EndianSchema, where
+// adjacent fields of the same width are merged into runs. An EndianSwapPlan
+// places schemas and plain arrays over a buffer, flattens them into spans
+// sorted by offset and swaps the buffer in a single sweep. Each span is a
+// contiguous array, swapped 16 or 32 bytes at a time with SSE2 or AVX2.
+//
+// A plan is guarded by a tag: a 32-bit word of the buffer whose host-order
+// value is known, such as the file magic. The buffer is only swapped while the
+// tag still reads byte-reversed, and the tag is swapped along with it, so
+// applying a plan a second time leaves the buffer untouched. On big-endian
+// hosts the tag already reads in host order and nothing is ever swapped.
+
+// Swaps count elements in place. data needs no particular alignment.
+void SwapEndian16(void* data, u32 count);
+void SwapEndian32(void* data, u32 count);
+void SwapEndian64(void* data, u32 count);
+
+class EndianSchema
+{
+public:
+    struct Run
+    {
+        u32 offset;     // Bytes from the start of the record
+        u32 width;      // 2, 4 or 8 bytes per element
+        u32 count;
+    };
+
+public:
+    explicit EndianSchema(u32 size);
+
+    // Fields may be added in any order but must not overlap. Byte-sized
+    // fields need no entry.
+    EndianSchema& field(u32 offset, u32 width, u32 count = 1);
+
+    u32 getSize() const { return mSize; }
+    const std::vector<Run>& getRuns() const { return mRuns; }
+
+private:
+    u32              mSize;
+    std::vector<Run> mRuns;     // Sorted and merged
+};
+
+class EndianSwapPlan
+{
+public:
+    enum Result
+    {
+        RESULT_SWAPPED,
+        RESULT_ALREADY_HOST,    // Tag reads in host order
+        RESULT_INVALID          // Tag matches neither order, or a span is out of the buffer
+    };
+
+public:
+    EndianSwapPlan();
+
+    // host_value must differ from its byte-reversed self
+    void setTag(u32 offset, u32 host_value);
+
+    // record_num consecutive records laid out by schema
+    void addRecords(u32 offset, const EndianSchema& schema, u32 record_num = 1);
+    void addArray(u32 offset, u32 width, u32 count);
+
+    // Sorts and merges the spans, once everything was added. Spans must not
+    // overlap each other or the tag.
+    void finalize();
+
+    Result apply(void* data, u32 size) const;
+
+    // Element by element, for reference
+    Result applyScalar(void* data, u32 size) const;
+
+    u32 getSpanNum() const;
+    u32 getByteNum() const;     // Swapped per apply
+
+private:
+    struct Span
+    {
+        u32 offset;
+        u32 width;
+        u32 count;
+    };
+
+    typedef void (*SwapFunc)(void* data, u32 count);
+
+    Result apply_(void* data, u32 size, SwapFunc swap16, SwapFunc swap32, SwapFunc swap64) const;
+
+    u32                 mTagOffset;
+    u32                 mTagValue;
+    std::vector<Span>   mSpans;
+    bool                mFinalized;
+};
+
+struct EndianSwapBenchmark
+{
+    u64  byte_num;
+    u32  span_num;
+    u64  scalar_ns;
+    u64  simd_ns;
+    bool matched;       // Both paths gave the same bytes
+    bool idempotent;    // A second apply left the buffer untouched
+};
+
+// Applies the plan to two copies of data, through both paths
+bool BenchmarkEndianSwap(const EndianSwapPlan& plan, const void* data, u32 size, EndianSwapBenchmark* out);
+
+// Megabytes per second
+inline f32 GetEndianSwapRate(u64 byte_num, u64 ns)
+{
+    return ns > 0 ? f32(byte_num * 1000.0 / ns) : 0.0f;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <string>
+#include <vector>
+
+// Helpers shared by the tools that read and write files outside of rio's
+// file devices: the PTCL diff and optimizer, the PTCL writer and the
+// regression reports.
+
+// Big-endian, as stored in PTCL files
+inline u32 Load32(const u8* data)
+{
+    return u32(data[0]) << 24 | u32(data[1]) << 16 | u32(data[2]) << 8 | u32(data[3]);
+}
+
+// Big-endian integer of 1 to 4 bytes, for members whose width varies
+inline u32 LoadBe(const u8* data, u32 size)
+{
+    u32 value = 0;
+    for (u32 i = 0; i < size; i++)
+        value = value << 8 | data[i];
+    return value;
+}
+
+inline void Store32(u8* data, u32 value)
+{
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+}
+
+// Whether [offset, offset + size) lies within file_size, without overflow
+inline bool InRange(u64 offset, u64 size, u64 file_size)
+{
+    return offset <= file_size && size <= file_size - offset;
+}
+
+inline u64 HashMix(u64 hash, u64 value)
+{
+    hash = (hash ^ value) * 0x9E3779B97F4A7C15;
+    return hash ^ (hash >> 32);
+}
+
+// Not cryptographic, only for telling data apart
+u64 HashBytes(const u8* data, u32 size);
+
+bool ReadWholeFile(const std::string& path, std::vector<u8>* data);
+
+// Through a temporary file renamed over the target, creating its directory
+bool WriteFileAtomic(const std::string& path, const u8* data, u32 size);
+
+std::string EscapeJson(const std::string& str);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Watches one file for changes made by other programs.
+//
+// A worker thread blocks on the directory of the file, on ReadDirectoryChangesW
+// on Windows and inotify on Linux, and notes the time of the last event that
+// names the file. Each event also wakes the main loop from an idle wait.
+// Tools usually write a file in several steps, so poll() reports a change
+// once no event has been seen for cSettleTime.
+class FileWatcher
+{
+public:
+    static constexpr u64 cSettleTime = 30000000;   // Nanoseconds
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    static bool isSupported();
+
+    bool start(const std::string& path);
+    void stop();
+
+    bool isWatching() const { return mThread.joinable(); }
+
+    // A change was seen and has not settled yet
+    bool isPending() const { return mChangeTime.load() != 0; }
+
+    // Main thread, once per frame. True once per settled change.
+    bool poll();
+
+    u32 getEventNum() const { return mEventNum.load(); }
+
+private:
+    void workerMain_();
+    void notify_();
+
+    std::string         mDirectory;
+    std::string         mFileName;
+    std::thread         mThread;
+    std::atomic<u64>    mChangeTime;    // Of the last event, 0 when none is pending
+    std::atomic<u32>    mEventNum;
+    std::atomic<bool>   mExit;
+    void*               mpDirectory;    // Directory handle on Windows
+    void*               mpStopEvent;
+    s32                 mNotifyFd;      // inotify instance on Linux
+};
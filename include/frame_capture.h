@@ -0,0 +1,111 @@
+#pragma once
+
+#include <gfx/rio_Color.h>
+#include <gpu/rio_RenderBuffer.h>
+#include <gpu/rio_RenderTarget.h>
+#include <gpu/rio_Texture.h>
+
+#include <thread_pool.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Renders frames offscreen at a fixed size, independent of the window and
+// the view, and writes them out as an image sequence.
+//
+// Each captured frame is read back with glReadPixels into one of a ring of
+// pixel buffer objects, fenced, and only mapped cReadbackNum - 1 frames
+// later when the copy is done, so the main thread never waits for the GPU
+// in the common case. Mapped pixels are copied out and encoded and written
+// by a thread pool.
+class FrameCapture
+{
+public:
+    static constexpr u32 cReadbackNum = 4;
+    static constexpr u32 cPendingJobMax = 32;   // Frames held in memory awaiting encoding
+
+    enum Format
+    {
+        FORMAT_PNG,
+        FORMAT_RAW,     // Tightly packed RGBA8, one file per frame
+        FORMAT_SINK     // Handed to Settings::sink instead of written
+    };
+
+    // Called on a worker thread with the tightly packed RGBA8 pixels of a
+    // frame. Returns false on failure.
+    typedef std::function<bool(u32 frame, const u8* rgba, s32 width, s32 height)> Sink;
+
+    struct Settings
+    {
+        s32         width;
+        s32         height;
+        u32         frame_num;      // 0 captures until stop()
+        Format      format;
+        std::string directory;
+        bool        encode_video;   // Run ffmpeg over the sequence once done (Win)
+        Sink        sink;           // FORMAT_SINK only
+    };
+
+    struct Stats
+    {
+        u32 captured_num;
+        u32 written_num;
+        u32 failed_num;
+        u32 readback_stall_num;     // Frames that had to wait for a PBO
+        u32 encode_stall_num;       // Frames that had to wait for the workers
+    };
+
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    static bool isSupported();
+
+    bool start(const Settings& settings);
+    void stop();
+
+    bool isCapturing() const { return mCapturing; }
+    bool isComplete() const { return mSettings.frame_num != 0 && mStats.captured_num >= mSettings.frame_num; }
+
+    // Binds and clears the capture target for the current frame
+    void beginFrame(const rio::Color4f& clear_color);
+    // Queues the readback of the frame drawn since beginFrame()
+    void endFrame();
+
+    const rio::Texture2D& getColorTexture() const { return *mpColorTexture; }
+    const rio::Texture2D& getDepthTexture() const { return *mpDepthTexture; }
+
+    const Settings& getSettings() const { return mSettings; }
+    Stats getStats() const;
+
+private:
+    struct Readback
+    {
+        u32     buffer;
+        void*   fence;
+        u32     frame;
+    };
+
+    void collect_(bool wait);
+    void encode_(u32 frame, std::unique_ptr<u8[]> pixels);
+    std::string getFramePath_(u32 frame) const;
+
+    Settings                    mSettings;
+    bool                        mCapturing;
+    rio::Texture2D*             mpColorTexture;
+    rio::Texture2D*             mpDepthTexture;
+    rio::RenderTargetColor      mColorTarget;
+    rio::RenderTargetDepth      mDepthTarget;
+    rio::RenderBuffer           mRenderBuffer;
+    Readback                    mReadback[cReadbackNum];
+    u32                         mReadbackIndex;
+    std::unique_ptr<ThreadPool> mpThreadPool;
+    std::atomic<u32>            mWrittenNum;
+    std::atomic<u32>            mFailedNum;
+    Stats                       mStats;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <math/rio_Matrix.h>
+#include <gfx/rio_Color.h>
+
+#include <vector>
+
+class StreamBuffer;
+
+// Retained-mode drawing for editor gizmos and reference geometry.
+//
+// Meshes are uploaded once and live in their own vertex and index buffers.
+// Each draw() premultiplies the view-projection matrix with the model matrix
+// on the CPU and queues one instance; end() writes all instances of the
+// frame into the stream buffer and issues one instanced draw per mesh. The
+// vertex shader then only does four dot products per vertex.
+//
+// Cafe has no instanced shader for this here; callers keep using
+// rio::PrimitiveRenderer there (see isSupported()).
+class GeometryCache
+{
+public:
+    typedef u32 MeshHandle;
+    static constexpr MeshHandle cInvalidMesh = MeshHandle(-1);
+
+    struct Vertex
+    {
+        f32 pos[3];
+        f32 color_rate;     // 0 takes color0 of the instance, 1 takes color1
+        f32 arc;            // Position along the mesh's sweep in [0, 1], negative if always drawn
+    };
+
+    enum PrimitiveType
+    {
+        PRIMITIVE_TYPE_TRIANGLES,
+        PRIMITIVE_TYPE_LINES
+    };
+
+    struct Stats
+    {
+        u32 mesh_num;
+        u32 instance_num;   // Last begin()/end() batch
+        u32 draw_num;       // Last begin()/end() batch
+    };
+
+public:
+    GeometryCache();
+    ~GeometryCache();
+
+    GeometryCache(const GeometryCache&) = delete;
+    GeometryCache& operator=(const GeometryCache&) = delete;
+
+    static bool isSupported();
+
+    void initialize(StreamBuffer* stream_buffer);
+    void finalize();
+
+    bool isInitialized() const { return mProgram != 0; }
+
+    MeshHandle addMesh(PrimitiveType type, const Vertex* vertices, u32 vertex_num, const u16* indices, u32 index_num);
+
+    // Unit sphere with 8 latitude and 16 longitude divisions, shaded from
+    // color0 at the top to color1 at the bottom like
+    // rio::PrimitiveRenderer::drawSphere8x16
+    MeshHandle addSphere8x16();
+
+    void begin(const rio::Matrix44f& proj, const rio::Matrix34f& view);
+    // Vertices whose arc falls outside [arc_start, arc_start + arc_length)
+    // (wrapping around 1) are not drawn
+    void draw(MeshHandle mesh, const rio::Matrix34f& model, const rio::Color4f& color0, const rio::Color4f& color1, f32 arc_start = 0.0f, f32 arc_length = 1.0f);
+    void end();
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    struct Mesh
+    {
+        u32 vertex_buffer;
+        u32 index_buffer;
+        u32 index_num;
+        u32 mode;
+    };
+
+    struct Instance
+    {
+        f32 wvp[4][4];      // Rows of proj * view * model
+        f32 color0[4];
+        f32 color1[4];
+        f32 arc[4];         // Start, length, unused, unused
+    };
+
+    struct Queued
+    {
+        MeshHandle  mesh;
+        u32         order;
+        Instance    instance;
+    };
+
+    StreamBuffer*       mpStreamBuffer;
+    u32                 mProgram;
+    u32                 mVertexArray;
+    std::vector<Mesh>   mMeshes;
+    std::vector<Queued> mQueue;
+    f32                 mViewProj[4][4];
+    bool                mDrawing;
+    Stats               mStats;
+};
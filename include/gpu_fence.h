@@ -0,0 +1,110 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#if RIO_IS_CAFE
+    #include <cafe/gx2.h>
+#elif RIO_IS_WIN
+    #include <misc/gl/rio_GL.h>
+#endif
+
+// Marks a point in the GPU command stream so CPU-side resources used by the
+// commands before it can be released or reused without a full pipeline flush.
+class GpuFence
+{
+public:
+    GpuFence()
+        : mSync(nullptr)
+        , mTimeStamp(0)
+    {
+    }
+
+    ~GpuFence()
+    {
+        reset();
+    }
+
+    GpuFence(const GpuFence&) = delete;
+    GpuFence& operator=(const GpuFence&) = delete;
+
+    GpuFence(GpuFence&& other)
+        : mSync(other.mSync)
+        , mTimeStamp(other.mTimeStamp)
+    {
+        other.mSync = nullptr;
+        other.mTimeStamp = 0;
+    }
+
+    GpuFence& operator=(GpuFence&& other)
+    {
+        if (this != &other)
+        {
+            reset();
+            mSync = other.mSync;
+            mTimeStamp = other.mTimeStamp;
+            other.mSync = nullptr;
+            other.mTimeStamp = 0;
+        }
+        return *this;
+    }
+
+    void insert()
+    {
+        reset();
+#if RIO_IS_CAFE
+        // Commands queued now are part of the next submission
+        mTimeStamp = GX2GetLastSubmittedTimeStamp() + 1;
+#elif RIO_IS_WIN
+        mSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+    }
+
+    bool isPending() const
+    {
+        return mSync != nullptr || mTimeStamp != 0;
+    }
+
+    bool isSignaled() const
+    {
+#if RIO_IS_CAFE
+        return mTimeStamp == 0 || GX2GetRetiredTimeStamp() >= mTimeStamp;
+#elif RIO_IS_WIN
+        if (!mSync)
+            return true;
+
+        const GLenum status = glClientWaitSync(static_cast<GLsync>(mSync), 0, 0);
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+#else
+        return true;
+#endif
+    }
+
+    void wait() const
+    {
+#if RIO_IS_CAFE
+        if (mTimeStamp != 0)
+            GX2WaitTimeStamp(mTimeStamp);
+#elif RIO_IS_WIN
+        if (mSync)
+        {
+            while (glClientWaitSync(static_cast<GLsync>(mSync), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+        }
+#endif
+    }
+
+    void reset()
+    {
+#if RIO_IS_WIN
+        if (mSync)
+            glDeleteSync(static_cast<GLsync>(mSync));
+#endif
+        mSync = nullptr;
+        mTimeStamp = 0;
+    }
+
+private:
+    void*   mSync;
+    u64     mTimeStamp;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <vector>
+
+// CPU access to GX2 surfaces as stored in PTCL resources, so they can be
+// shown without the Cafe GPU. Only the first mip level of the first slice of
+// single-sampled 2D surfaces is handled. Elements are texels for plain
+// formats and 4x4 blocks for BC1-BC5.
+struct Gx2SurfaceInfo
+{
+    u32         format;     // GX2SurfaceFormat
+    u32         width;      // Texels
+    u32         height;
+    u32         pitch;      // Elements
+    u32         tile_mode;  // GX2TileMode
+    u32         swizzle;
+    const u8*   image;
+    u32         image_size;
+};
+
+bool IsGx2FormatSupported(u32 format);
+bool IsGx2FormatCompressed(u32 format);
+bool IsGx2FormatSigned(u32 format);
+
+// 1 to 5 for BC1 to BC5, 0 for uncompressed formats
+u32 GetGx2BcIndex(u32 format);
+
+// Bits per element
+u32 GetGx2FormatBpp(u32 format);
+
+// Size of the surface in elements
+u32 GetGx2ElementWidth(const Gx2SurfaceInfo& info);
+u32 GetGx2ElementHeight(const Gx2SurfaceInfo& info);
+
+// Byte offset of element (x, y) in the tiled image
+u32 ComputeGx2ElementOffset(const Gx2SurfaceInfo& info, u32 x, u32 y);
+
+// Copies the elements into out in row-major order, tightly packed. out must
+// hold GetGx2ElementWidth() * GetGx2ElementHeight() * bpp / 8 bytes. BC1-BC5
+// blocks are copied untouched. Full 8x8 micro tiles are copied a row run at a
+// time with SSE2 where available.
+bool DetileGx2Surface(const Gx2SurfaceInfo& info, u8* out);
+
+// Converts linear elements, as returned by DetileGx2Surface(), to RGBA8
+// texels. out_rgba must hold width * height * 4 bytes. Packed formats of up
+// to 16 bits per texel are expanded with SSE2, or AVX2 if the CPU has it.
+bool ConvertGx2ToRgba8(u32 format, const u8* elements, u32 width, u32 height, u8* out_rgba);
+
+// One element at a time. The vectorized paths above must match these bit for
+// bit, which is asserted on every decode in non-release builds.
+bool DetileGx2SurfaceScalar(const Gx2SurfaceInfo& info, u8* out);
+bool ConvertGx2ToRgba8Scalar(u32 format, const u8* elements, u32 width, u32 height, u8* out_rgba);
+
+// Both of the above. Safe to call from worker threads.
+bool DecodeGx2Surface(const Gx2SurfaceInfo& info, std::vector<u8>* out_rgba);
+
+// Accumulated timings of the scalar and vectorized paths
+struct Gx2DecodeBenchmark
+{
+    u32 surface_num;
+    u64 texel_num;
+    u64 detile_scalar_ns;
+    u64 detile_simd_ns;
+    u64 convert_scalar_ns;
+    u64 convert_simd_ns;
+    u32 mismatch_num;       // Surfaces where the paths disagreed
+};
+
+// Decodes the surface through both paths and adds the timings to inout.
+// Returns false if the surface cannot be decoded.
+bool BenchmarkGx2Surface(const Gx2SurfaceInfo& info, Gx2DecodeBenchmark* inout);
+
+// Megapixels per second
+inline f32 GetGx2BenchmarkRate(u64 texel_num, u64 ns)
+{
+    return ns > 0 ? f32(texel_num * 1000.0 / ns) : 0.0f;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+// Decides per frame whether the editor has anything to do. A frame is idle
+// when the caller reports nothing busy and no input has been seen for
+// cWakeFrameNum frames (ImGui needs a couple of frames to settle hover and
+// popup state after the last event). On an idle frame the caller skips
+// simulation and the view render, and the next frame starts by sleeping
+// until an input event arrives or cWaitTimeout elapses.
+class IdleMonitor
+{
+public:
+    static constexpr u32 cWakeFrameNum = 3;
+    static constexpr f64 cWaitTimeout = 0.25;   // Seconds
+
+    struct Stats
+    {
+        f32 duty_cycle;     // Share of wall time not spent sleeping
+        f32 frame_rate;     // Frames per second, idle or not
+        f32 render_rate;    // Frames per second that rendered the view
+    };
+
+public:
+    IdleMonitor();
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+
+    // Sleeps if the previous frame was idle. Call at the start of the frame,
+    // before input is processed.
+    void wait();
+
+    // Forces the next cWakeFrameNum frames to run, e.g. from window callbacks
+    void wake() { mWakeFrame = cWakeFrameNum; }
+
+    void update(bool busy);
+    bool isIdle() const { return mIdle; }
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    bool    mEnabled;
+    bool    mIdle;
+    u32     mWakeFrame;
+    u64     mWindowBegin;
+    u64     mWaitTime;
+    u32     mFrameNum;
+    u32     mRenderNum;
+    Stats   mStats;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <vector>
+
+// Reads back PNGs written by WritePng(): 8-bit RGBA, non-interlaced, with
+// stored deflate blocks. Filters are undone, but compressed blocks are not
+// supported and make the read fail, so this is only meant for files the
+// editor wrote itself (thumbnail cache, golden images). Safe to call from
+// worker threads.
+bool ReadPng(const char* filename, std::vector<u8>* out_rgba, u32* out_width, u32* out_height);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+// Minimal image file writers, safe to call from worker threads.
+//
+// PNGs are 8-bit RGBA with no filtering and stored (uncompressed) deflate
+// blocks: larger files than a real encoder produces, but encoding is a
+// memcpy plus two checksums, so it keeps up with capture.
+bool WritePng(const char* filename, const u8* rgba, u32 width, u32 height, u32 stride);
+
+// Raw bytes, e.g. tightly packed RGBA8 frames for ffmpeg's rawvideo input
+bool WriteRawImage(const char* filename, const u8* data, u32 size);
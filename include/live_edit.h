@@ -0,0 +1,67 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <vector>
+
+namespace nw { namespace eft {
+
+struct EmitterInstance;
+struct SimpleEmitterData;
+
+} }
+
+// Carries edits of the resource's emitter data over to the live emitters.
+//
+// Emitter instances point at the resource's records, so fields Eft reads as
+// it calculates, such as the emission rate, take effect on the next frame as
+// they are written. What Eft derives from a record when an emitter is
+// created (animation tables, the static uniform block, texture sampling) is
+// refreshed with UpdateResInfo(), once per frame and only for the instances
+// of the edited records. Eft has no narrower call, so all of that state is
+// recalculated whichever part of it an edit touched. Fields that select
+// shaders or meshes are only read when a set is created, so editing them asks
+// for the set to be recreated.
+class LiveEdit
+{
+public:
+    enum Derived
+    {
+        DERIVED_NONE    = 0,        // Read every frame
+        DERIVED_UPDATE  = 1 << 0,   // Derived when the emitter is created, refreshed by UpdateResInfo()
+        DERIVED_CREATE  = 1 << 1    // Only read when the emitter is created, such as the shader
+    };
+
+    struct Stats
+    {
+        u32 edit_num;
+        u32 instance_update_num;    // UpdateResInfo() calls
+        u32 recreate_num;
+    };
+
+public:
+    LiveEdit();
+
+    void markEdited(const nw::eft::SimpleEmitterData* data, u32 derived);
+
+    bool hasPending() const { return !mPending.empty(); }
+
+    // Drops pending edits, e.g. when the resource is entered again
+    void clear() { mPending.clear(); }
+
+    // Between Calc calls. Returns true if the edited set must be recreated
+    // instead.
+    bool apply(nw::eft::EmitterInstance* head);
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    struct Pending
+    {
+        const nw::eft::SimpleEmitterData*   data;
+        u32                                 derived;
+    };
+
+    std::vector<Pending>    mPending;
+    Stats                   mStats;
+};
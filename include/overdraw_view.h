@@ -0,0 +1,100 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+namespace nw { namespace eft {
+
+struct EmitterInstance;
+
+} }
+
+// Debug view mode that counts fragment writes per pixel in the stencil buffer
+// while the effect is drawn, then resolves the counts into a heatmap in the
+// view's color texture. Per-pixel statistics are read back through a ring of
+// pixel buffer objects and per-emitter fragment counts through occlusion
+// queries, both collected frames later so the viewport never stalls.
+class OverdrawView
+{
+public:
+    static constexpr u32 cLevelNum = 8;         // The last level also covers everything above it
+    static constexpr u32 cReadbackNum = 3;
+    static constexpr u32 cQueryNumPerFrame = 256;
+
+    struct Stats
+    {
+        f32         average_overdraw;   // Fragments per covered pixel
+        f32         total_overdraw;     // Fragments per view pixel
+        u32         max_overdraw;
+        f32         covered_ratio;
+        u32         histogram[cLevelNum + 1];
+        const char* worst_emitter_name;
+        u64         worst_emitter_fragments;
+        u32         width;
+        u32         height;
+    };
+
+public:
+    OverdrawView();
+    ~OverdrawView();
+
+    OverdrawView(const OverdrawView&) = delete;
+    OverdrawView& operator=(const OverdrawView&) = delete;
+
+    static bool isSupported();
+
+    void initialize();
+    void finalize();
+
+    // Drops pending readbacks and statistics, which point at emitter names in
+    // the resource. Call before the resource is freed.
+    void reset();
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled && mInitialized; }
+
+    // Wraps the effect draw. target is the native handle of the texture the
+    // heatmap is resolved into; only its top-left width x height is drawn.
+    void begin(uintptr target, s32 target_width, s32 target_height, s32 width, s32 height);
+    void end();
+
+    void beginEmitter(const nw::eft::EmitterInstance* emitter);
+    void endEmitter();
+
+    const Stats& getStats() const { return mStats; }
+
+    static void getLevelColor(u32 level, f32* rgba);
+
+private:
+    void resize_(s32 width, s32 height);
+    void resolve_();
+    void readback_();
+    void collect_();
+
+    struct Readback
+    {
+        u32     buffer;
+        void*   fence;
+        u32     width;
+        u32     height;
+        u32     query_num;
+        u32     query[cQueryNumPerFrame];
+        const char* query_name[cQueryNumPerFrame];
+    };
+
+    bool        mInitialized;
+    bool        mEnabled;
+    bool        mDrawing;
+    bool        mQueryActive;
+    u32         mFramebuffer;
+    u32         mDepthStencil;
+    u32         mVertexArray;
+    u32         mProgram;
+    s32         mColorLocation;
+    s32         mStorageWidth;
+    s32         mStorageHeight;
+    s32         mWidth;
+    s32         mHeight;
+    Readback    mReadback[cReadbackNum];
+    u32         mReadbackIndex;
+    Stats       mStats;
+};
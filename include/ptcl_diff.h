@@ -0,0 +1,70 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Structural comparison of two PTCL files as stored on disk.
+//
+// Neither file is entered into Eft, both are read big-endian through the
+// layout of Eft's resource structures. Emitter sets are matched by name,
+// then the emitters of a matched set by name, in order for repeated names.
+// Matched emitters are compared field by field with the fields PtclWriter
+// knows. The original and native data of every texture slot, including the
+// child texture of complex emitters, is hashed, so changed pixels are found
+// even where the emitter records match. The shader and primitive tables are
+// hashed whole, since the editor does not see their layout.
+//
+// Each set and emitter is hashed without its positions in the file, and
+// ones whose hashes match are skipped without looking at their fields.
+// Hashing and the per-set comparison run on a thread pool.
+enum PtclDiffStatus
+{
+    PTCL_DIFF_SAME,
+    PTCL_DIFF_CHANGED,
+    PTCL_DIFF_ADDED,        // Only in the second file
+    PTCL_DIFF_REMOVED       // Only in the first file
+};
+
+struct PtclEmitterDiff
+{
+    std::string                 name;
+    PtclDiffStatus              status;
+    std::vector<std::string>    fields;             // Changed, named as in PtclWriter::getFieldTable()
+    u32                         texture_mask;       // Slots whose texture changed, the last one the child's
+    u32                         other_byte_num;     // Changed bytes outside the known fields
+};
+
+struct PtclSetDiff
+{
+    std::string                     name;
+    PtclDiffStatus                  status;
+    std::vector<PtclEmitterDiff>    emitters;       // Only the ones that changed
+};
+
+struct PtclDiffReport
+{
+    std::string                 path[2];
+    u32                         set_num[2];
+    u32                         emitter_num[2];
+    u32                         texture_num[2];     // Distinct texture data
+    u32                         same_set_num;       // Skipped by hash
+    bool                        shader_table_changed;
+    bool                        primitive_table_changed;
+    std::vector<PtclSetDiff>    sets;               // Only the ones that changed, in the order of the first file
+    u64                         diff_ns;
+
+    bool isIdentical() const { return sets.empty() && !shader_table_changed && !primitive_table_changed; }
+};
+
+// Returns false if either file cannot be read as a PTCL, with the reason in error
+bool DiffPtcl(const u8* a, u32 a_size, const u8* b, u32 b_size, PtclDiffReport* report, std::string* error);
+bool DiffPtclFiles(const std::string& a, const std::string& b, PtclDiffReport* report, std::string* error);
+bool DiffPtclFile(const u8* a, u32 a_size, const std::string& b, PtclDiffReport* report, std::string* error);
+
+void WritePtclDiffText(const PtclDiffReport& report, std::FILE* file);
+void WritePtclDiffJson(const PtclDiffReport& report, std::FILE* file);
+
+const char* GetPtclDiffStatusName(PtclDiffStatus status);
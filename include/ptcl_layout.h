@@ -0,0 +1,80 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <type_traits>
+#include <vector>
+
+#include <nw/eft/eft_ResData.h>
+
+// Where a big-endian PTCL, as stored on disk, keeps the texture data, shader
+// programs and primitives of its emitters. Shared by the PTCL diff and
+// optimizer, so that what one moves the other checks.
+//
+// Every emitter has the texture slots of CommonEmitterData::texRes. Complex
+// emitters with an enabled child also have the child's texture, in the
+// ChildData found childDataOffset bytes after the record. Each slot points at
+// two blobs of the texture table, the original and the native data.
+//
+// Shader programs and primitives are referred to by index. Their tables
+// start with an image information header, followed by one information entry
+// per program or primitive, which locates its data relative to the data
+// offset of the header.
+
+typedef std::remove_extent_t<decltype(nw::eft::CommonEmitterData::texRes)> PtclTextureRes;
+
+static constexpr u32 cPtclChildTextureSlot = nw::eft::EFT_TEXTURE_SLOT_BIN_MAX;
+static constexpr u32 cPtclTextureSlotNum = cPtclChildTextureSlot + 1;
+
+enum PtclTextureData
+{
+    PTCL_TEXTURE_ORIGINAL,
+    PTCL_TEXTURE_NATIVE,
+    PTCL_TEXTURE_DATA_NUM
+};
+
+// File position of the TextureRes of slot in the record at record, or 0 if the
+// emitter does not use the slot. record must lie within the file, at least
+// sizeof(CommonEmitterData) bytes of it. Returns false if the slot lies
+// outside the file.
+bool GetPtclTextureRes(const u8* data, u32 size, u32 record, u32 slot, u32* texture_res);
+
+// Offsets in a TextureRes of the members that locate a blob, relative to the
+// texture table
+u32 GetPtclTextureDataPos(PtclTextureData kind);
+u32 GetPtclTextureDataSize(PtclTextureData kind);
+
+enum PtclTable
+{
+    PTCL_TABLE_SHADER,
+    PTCL_TABLE_PRIMITIVE,
+    PTCL_TABLE_NUM
+};
+
+// Position, normal, color, texture coordinate and index data of a primitive
+static constexpr u32 cPtclTableEntryRangeMax = 5;
+
+// A shader program, one range, or a primitive
+struct PtclTableEntry
+{
+    u32 range_num;
+    u32 offset[cPtclTableEntryRangeMax];    // In the table
+    u32 size[cPtclTableEntryRangeMax];
+};
+
+struct PtclTableLayout
+{
+    u32                         position;       // In the file
+    u32                         size;
+    u32                         info_size;      // Header and information entries
+    std::vector<PtclTableEntry> entries;
+};
+
+// Returns false if the table or the data of one of its entries lies outside
+// the file
+bool GetPtclTableLayout(const u8* data, u32 size, PtclTable table, PtclTableLayout* layout);
+
+// Appends the indices into table that the record at record and its child
+// use. Indices past the end of the table stand for none, such as unset user
+// shaders. Returns false if the record or its child lies outside the file.
+bool GetPtclTableRefs(const u8* data, u32 size, u32 record, PtclTable table, std::vector<u32>* indices);
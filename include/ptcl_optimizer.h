@@ -0,0 +1,60 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Writes a smaller copy of a PTCL.
+//
+// The texture data that emitters and their children point at, native and
+// original, is hashed and compared. Identical blobs are stored once and every
+// slot pointing at a copy is pointed at the one that is kept. Bytes of the
+// texture table that no slot points at are dropped. Kept blobs keep the
+// alignment of their old positions in the file, and the tables after the
+// texture table move down by a multiple of the alignment of its old end.
+//
+// Shader programs and primitives are hashed and compared the same way, and
+// the programs and primitives that are duplicates of an earlier one or that
+// no emitter or child uses are reported, but their tables are copied
+// unchanged. Emitters refer to their entries by index, so merging them would
+// mean renumbering the shader and primitive indices of every emitter and
+// child, which DiffPtcl() does not compare and so could not check.
+//
+// The result is read back and compared with the input through DiffPtcl(),
+// which sees the same texture slots, and is not returned unless the two are
+// identical.
+struct PtclOptimizeReport
+{
+    enum Category
+    {
+        CATEGORY_TEXTURE,
+        CATEGORY_SHADER,
+        CATEGORY_PRIMITIVE,
+        CATEGORY_NUM
+    };
+
+    struct Saving
+    {
+        u32     table_size;         // Before
+        u32     entry_num;          // Distinct blobs pointed at, or programs or primitives in the table
+        u32     unreferenced_num;   // Programs or primitives no emitter uses
+        u32     duplicate_num;      // Of those used
+        u32     duplicate_byte_num;
+        u32     unused_byte_num;    // Not used by any emitter, including old padding
+        s32     saved_byte_num;     // Net, after the new padding
+    };
+
+    std::string path[2];
+    u32         size[2];
+    Saving      saving[CATEGORY_NUM];
+    u64         optimize_ns;
+};
+
+// Returns false if the data cannot be read as a PTCL or the result fails the
+// comparison, with the reason in error
+bool OptimizePtcl(const u8* data, u32 size, std::vector<u8>* out, PtclOptimizeReport* report, std::string* error);
+bool OptimizePtclFile(const std::string& in, const std::string& out, PtclOptimizeReport* report, std::string* error);
+
+void WritePtclOptimizeText(const PtclOptimizeReport& report, std::FILE* file);
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <endian_swap.h>
+
+namespace nw { namespace eft {
+
+class Resource;
+
+} }
+
+// Writes edits of an entered PTCL resource back to a big-endian PTCL file.
+//
+// Eft swaps and relocates the resource in the buffer it is given, so the
+// emitter records it hands out are the records of the file, at the same
+// offsets. The writer keeps the file as read and, for every emitter record,
+// the scalar fields of CommonEmitterData and SimpleEmitterData it knows. A
+// save compares each field in host order against the kept file and swaps the
+// changed ones back to big-endian into it. The whole kept file is then
+// written through a temporary file renamed over the target, so a failed or
+// interrupted save leaves either the old file or the new one, never a mix.
+// Rewriting only the changed bytes in place would be cheaper but could not
+// promise that.
+// The comparison reads the kept file through a copy with every record swapped
+// to host order at once by an EndianSwapPlan built from the field table.
+//
+// Fields are checked against the file once tracked. Any that Eft rewrites
+// when entering the resource, such as pointers, are not written back.
+// Changes to the structure of the resource, such as added emitters, cannot
+// be represented.
+//
+// The other way around, a newer version of the file written by another tool
+// is compared against the kept file. If it only differs in tracked fields,
+// those are copied into the entered resource in host order and the resource
+// stays entered; otherwise the caller has to enter the new file.
+class PtclWriter
+{
+public:
+    enum Result
+    {
+        RESULT_UNCHANGED,   // No field differs from the file
+        RESULT_WRITTEN,     // Whole file written and renamed over the target
+        RESULT_FAILED,
+        RESULT_CONFLICT     // The file changed on disk since it was read or saved, nothing written
+    };
+
+    enum Delta
+    {
+        DELTA_UNCHANGED,
+        DELTA_FIELDS,       // Only tracked fields differ
+        DELTA_STRUCTURAL    // Anything else differs, or the size
+    };
+
+    struct Field
+    {
+        u32         offset;     // Bytes from the start of the record
+        u32         size;
+        u32         width;      // Of each element, 1 if nothing is swapped
+        std::string name;       // Member path, such as textureData[0].uvScroll
+    };
+
+    struct Stats
+    {
+        u32     record_num;
+        u32     field_num;              // Per record
+        u32     dropped_field_num;      // Not matching the file when tracked
+        u32     patched_field_num;      // By the last save
+        u32     patched_byte_num;
+        u64     save_ns;
+        Result  result;
+        u32     reloaded_field_num;     // By the last applyDelta()
+    };
+
+public:
+    PtclWriter();
+
+    PtclWriter(const PtclWriter&) = delete;
+    PtclWriter& operator=(const PtclWriter&) = delete;
+
+    static bool isSupported();
+
+    // Every field the writer knows, sorted by offset, before tracking drops any
+    static const std::vector<Field>& getFieldTable();
+
+    // The field table as an endian schema of one emitter record
+    static const EndianSchema& getRecordSchema();
+
+    // Copies the file as read from path, before it is entered
+    void setSource(const u8* data, u32 size, const std::string& path);
+
+    // buffer is the one the resource was entered from
+    void track(const nw::eft::Resource* resource, u8* buffer);
+
+    void reset();
+
+    bool isTracking() const { return mpBuffer != nullptr; }
+
+    // Only when the source file is unchanged on disk. Otherwise the caller
+    // decides between reloading it and saveAs().
+    Result save();
+
+    // Always a whole file write, replacing whatever is at path
+    Result saveAs(const std::string& path);
+
+    // data is a newer version of the file, as read. Fields found to differ
+    // are kept for applyDelta().
+    Delta compareDelta(const u8* data, u32 size);
+
+    // Copies the fields found by compareDelta() from data into the kept file
+    // and the entered resource. Appends the file offsets of the records they
+    // belong to, sorted.
+    void applyDelta(const u8* data, std::vector<u32>* changed_records);
+
+    // The file as read or last saved
+    const std::vector<u8>& getImage() const { return mImage; }
+
+    // The file as a save would write it now, including unsaved edits
+    void getEditedImage(std::vector<u8>* image) const;
+
+    // image is an edited image of the kept file, from getEditedImage() before
+    // the resource was entered again. Copies the tracked fields that differ
+    // into the entered resource, leaving them unsaved.
+    void restoreEdits(const u8* image);
+
+    const std::string& getPath() const { return mPath; }
+    const Stats& getStats() const { return mStats; }
+
+    // Swaps the records of the kept file to host order, tagged by its magic.
+    // Empty until tracking.
+    const EndianSwapPlan& getSwapPlan() const { return mSwapPlan; }
+
+private:
+    struct Patch
+    {
+        u32     record;     // File offset
+        Field   field;
+    };
+
+    // Into a copy of the kept file, which replaces it once written
+    void collectChanges_(std::vector<u8>* image);
+    const Field* findField_(u32 offset, u32* record) const;
+
+    void getHostImage_(std::vector<u8>* image) const;
+
+    bool isOnDisk_(const std::string& path) const;
+    bool write_(const std::string& path, std::vector<u8>* image);
+
+    Result finishSave_(Result result, u64 start);
+
+    std::vector<u8>                 mImage;         // Big-endian, as on disk after the last save
+    std::string                     mPath;
+    std::filesystem::file_time_type mWriteTime;     // Of mPath, when it matched mImage
+    u8*                             mpBuffer;
+    std::vector<u32>                mRecords;       // File offsets, sorted
+    std::vector<Field>              mFields;        // Sorted by offset
+    std::vector<Patch>              mDelta;         // Found by compareDelta(), in file order
+    EndianSwapPlan                  mSwapPlan;
+    Stats                           mStats;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <frame_capture.h>
+#include <thread_pool.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Renders every emitter set of the resource at fixed frames and compares the
+// result against golden images, so changes to the renderer or the simulation
+// can be checked for unchanged output.
+//
+// The editor simulates one set at a time in the view's Eft group and draws it
+// through a FrameCapture whose frames are handed to getSink(). Frames are
+// compared on a thread pool while the next set simulates. A frame passes if
+// at most cDiffRatioMax of its pixels differ perceptibly: the luma delta is
+// above cLumaTolerance and no pixel in the 3x3 neighbourhood of the golden
+// image is within it, which absorbs one pixel shifts in rasterization.
+//
+// Calc and render CPU times are recorded per set. Once done, a JSON and a
+// JUnit XML report are written to the report directory, along with the
+// actual and difference images of every failed frame.
+class RegressionRunner
+{
+public:
+    static constexpr s32 cSize = 256;
+    static constexpr f32 cViewExtent = 1024.0f;     // World units across the image
+    static constexpr u32 cCaptureFrameNum = 3;
+    static constexpr u32 cCaptureFrame[cCaptureFrameNum] = { 10, 30, 60 };
+    static constexpr s32 cLumaTolerance = 8;
+    static constexpr f32 cDiffRatioMax = 0.005f;
+
+    enum Status
+    {
+        STATUS_PASS,
+        STATUS_UPDATED,     // Golden image written
+        STATUS_MISSING,     // No golden image to compare against
+        STATUS_FAIL,
+        STATUS_ERROR        // Could not be read or written
+    };
+
+    struct Settings
+    {
+        std::string golden_dir;
+        std::string report_dir;
+        bool        update_golden;
+    };
+
+    struct FrameResult
+    {
+        u32     frame;
+        Status  status;
+        f32     diff_ratio;
+    };
+
+    struct SetResult
+    {
+        std::string name;
+        Status      status;
+        FrameResult frame[cCaptureFrameNum];
+        u32         frame_num;      // Simulated
+        f32         calc_ms;        // Total over frame_num
+        f32         render_ms;
+    };
+
+    struct Summary
+    {
+        u32 set_num;
+        u32 done_num;
+        u32 pass_num;
+        u32 fail_num;           // Includes errors
+        u32 missing_num;
+    };
+
+public:
+    RegressionRunner();
+    ~RegressionRunner();
+
+    RegressionRunner(const RegressionRunner&) = delete;
+    RegressionRunner& operator=(const RegressionRunner&) = delete;
+
+    bool start(const Settings& settings, const char* resource_name);
+    // Blocks until every pending comparison is done and writes the reports
+    void finish();
+    void cancel();
+
+    bool isRunning() const { return mRunning; }
+
+    // Returns false once every set was simulated
+    bool beginSet(u32* out_set_index);
+    void endSet();
+
+    // Frames to simulate per set
+    static u32 getFrameNum() { return cCaptureFrame[cCaptureFrameNum - 1] + 1; }
+
+    // For the FrameCapture of the current set
+    FrameCapture::Settings getCaptureSettings();
+
+    void addCalcTime(u64 ns);
+    void addRenderTime(u64 ns);
+
+    // True if every set passed or was updated
+    bool isPassed() const;
+
+    Summary getSummary() const;
+    std::vector<SetResult> getResults() const;
+    const Settings& getSettings() const { return mSettings; }
+
+private:
+    bool onFrame_(u32 set_index, u32 frame, const u8* rgba);
+    void compare_(u32 set_index, u32 frame_slot, std::vector<u8> rgba);
+    void setFrameResult_(u32 set_index, u32 frame_slot, Status status, f32 diff_ratio);
+
+    std::string getImagePath_(const std::string& directory, u32 set_index, u32 frame, const char* suffix) const;
+
+    bool writeJsonReport_() const;
+    bool writeJUnitReport_() const;
+
+    Settings                    mSettings;
+    std::string                 mResourceName;
+    bool                        mRunning;
+    u32                         mSetIndex;      // Set being simulated
+    u64                         mStartTime;
+    f32                         mTotalMs;
+    std::unique_ptr<ThreadPool> mpThreadPool;
+    mutable std::mutex          mMutex;         // Guards mResults
+    std::vector<SetResult>      mResults;
+};
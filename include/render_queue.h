@@ -0,0 +1,59 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <vector>
+
+class EmitterCuller;
+
+namespace nw { namespace eft {
+
+struct EmitterInstance;
+
+} }
+
+// Collects the live emitters of a group into draw packets and reorders them
+// to reduce render state changes between consecutive RenderEmitter calls.
+//
+// Only emitters whose blending is order-independent (additive/subtractive
+// without depth writes) are reordered, and only within a run of consecutive
+// emitters sharing that blend type, so the composited result is unchanged.
+// Everything else keeps its linked-list order. Emitters rejected by the
+// culler are left out of the queue entirely.
+class RenderQueue
+{
+public:
+    struct Packet
+    {
+        nw::eft::EmitterInstance*   emitter;
+        u64                         sort_key;
+        u32                         order;
+        u32                         run;
+    };
+
+    struct Stats
+    {
+        u32 emitter_num;
+        u32 draw_num;
+        u32 state_change_num_unsorted;
+        u32 state_change_num_sorted;
+    };
+
+public:
+    RenderQueue();
+
+    void setSortEnabled(bool enabled) { mSortEnabled = enabled; }
+    bool isSortEnabled() const { return mSortEnabled; }
+
+    void build(nw::eft::EmitterInstance* head, EmitterCuller* culler);
+
+    const std::vector<Packet>& getPackets() const { return mPackets; }
+    const Stats& getStats() const { return mStats; }
+
+private:
+    static u32 countStateChanges_(const std::vector<Packet>& packets);
+
+    std::vector<Packet> mPackets;
+    bool                mSortEnabled;
+    Stats               mStats;
+};
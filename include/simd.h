@@ -0,0 +1,33 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+// SSE2 is used wherever the compiler targets it. AVX2 kernels are compiled
+// per function with EDITOR_SIMD_TARGET_AVX2 and only called if
+// GetSimdLevel() reports the CPU has it, so no global compiler flag is needed.
+#if defined(__SSE2__)
+    #define EDITOR_SIMD_SSE2 1
+    #include <immintrin.h>
+#else
+    #define EDITOR_SIMD_SSE2 0
+#endif // __SSE2__
+
+#if EDITOR_SIMD_SSE2
+    #define EDITOR_SIMD_AVX2 1
+    #define EDITOR_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define EDITOR_SIMD_AVX2 0
+#endif // EDITOR_SIMD_SSE2
+
+enum SimdLevel
+{
+    SIMD_LEVEL_SCALAR,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX2
+};
+
+// Best level both the build and the CPU support, detected once
+SimdLevel GetSimdLevel();
+
+// "AVX2", "SSE2" or "Scalar"
+const char* GetSimdLevelName();
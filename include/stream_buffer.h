@@ -0,0 +1,75 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+// Ring-buffered, GPU-visible memory for geometry written by the CPU every
+// frame. The buffer is split into cRegionNum regions, one per frame in flight.
+// A region is only reused once the GPU has signalled that the frame that last
+// used it is done.
+//
+// On GL with ARB_buffer_storage the whole ring is persistently and coherently
+// mapped, so callers write straight into memory the GPU reads from. Without
+// it, writes go to a CPU staging copy that is uploaded with glBufferSubData by
+// flush(). On Cafe the memory is shared and only needs its CPU cache flushed,
+// also by flush(). Either way, callers flush() after writing and before issuing
+// the draws that read the data; endFrame() only fences the region.
+//
+// The editor's geometry cache is the only user. Eft allocates and uploads its
+// particle and stripe attributes itself.
+class StreamBuffer
+{
+public:
+    static constexpr u32 cRegionNum = 3;
+
+    struct Stats
+    {
+        u32 bytes_written;      // Last frame
+        u32 bytes_uploaded;     // Last frame, copied by the driver (staging fallback only)
+        f32 upload_time_us;     // Last frame, CPU time in fence waits, flushes and copies
+        u32 stall_num;          // Total frames that had to wait on the GPU
+        bool persistent;
+    };
+
+public:
+    StreamBuffer();
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    void initialize(u32 region_size);
+    void finalize();
+
+    bool isInitialized() const { return mRegionSize != 0; }
+
+    void beginFrame();
+    void endFrame();
+
+    // Returns nullptr if the frame's region is full. out_offset receives the
+    // byte offset to pass when binding getNativeHandle() as a vertex buffer.
+    void* allocate(u32 size, u32 alignment, u32* out_offset);
+
+    // Makes everything allocated so far visible to draws issued after this
+    // call. Must be called before drawing from newly written data.
+    void flush();
+
+    // GL buffer name on Win, base address of the ring on Cafe
+    uintptr getNativeHandle() const;
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    u8*     mpMapped;
+    u8*     mpStaging;
+    u32     mBuffer;
+    u32     mRegionSize;
+    u32     mRegionIndex;
+    u32     mRegionUsed;
+    u32     mRegionFlushed;
+    void*   mFence[cRegionNum];
+    u64     mTimeStamp[cRegionNum];
+    bool    mPersistent;
+    bool    mInFrame;
+    u64     mUploadTime;
+    Stats   mStats;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <gpu/rio_Texture.h>
+
+#include <cafe/gx2.h>
+
+#include <baked_cache.h>
+#include <gx2_surface.h>
+#include <thread_pool.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Editor-side GL copies of the GX2 textures in the resource, for previews.
+//
+// A texture is decoded the first time it is requested: a worker detiles it
+// and converts it to RGBA8 while get() keeps returning a checkerboard
+// placeholder. Finished decodes are uploaded on the main thread through a
+// pixel unpack buffer, at most cUploadBudget bytes per frame, so opening a
+// texture-heavy pack never blocks a frame on decoding or on uploads.
+//
+// Unsigned BC1-BC5 textures are only detiled and stay compressed on the GPU
+// as S3TC and RGTC, if the driver has them. The texture's component selection
+// is applied as GL swizzles either way.
+//
+// With a BakedCache set, textures found in it skip the workers and are
+// uploaded straight from the mapped file. bake() decodes every texture of the
+// resource in the background and writes such a cache for the next launch.
+class TextureStreamer
+{
+public:
+    static constexpr u32 cUploadBudget = 4 * 1024 * 1024;
+    static constexpr s32 cPlaceholderSize = 8;
+
+    struct Stats
+    {
+        u32 ready_num;
+        u32 pending_num;        // Decoding or waiting for upload
+        u32 failed_num;         // Unsupported format or tile mode
+        u32 compressed_num;     // Kept as BC1-BC5
+        u32 baked_num;          // Uploaded from the baked cache
+        u64 uploaded_bytes;
+        u64 texture_bytes;      // GPU memory of the ready textures
+        u64 rgba8_bytes;        // What they would take as RGBA8
+        f32 decode_ms;          // Total worker time
+    };
+
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    static bool isSupported();
+
+    void initialize();
+    void finalize();
+
+    bool isInitialized() const { return mpThreadPool != nullptr; }
+
+    // Forgets every texture and the baked cache, e.g. after the resource was
+    // reloaded
+    void reset();
+
+    // resource is the PTCL the textures' image data points into. The cache
+    // must stay open until reset() or finalize().
+    void setBakedCache(const BakedCache* cache, const void* resource, u32 resource_size);
+
+    // Decodes the textures on a worker and writes them to path as a baked
+    // cache of the resource. Textures outside of the resource are skipped.
+    void bake(const std::string& path, const std::string& source_hash, const std::vector<GX2Texture>& textures,
+              const void* resource, u32 resource_size);
+    bool isBaking() const { return mBaking; }
+
+    // Queues the texture for decoding if needed. Returns the placeholder
+    // until it is ready, or if it cannot be decoded.
+    const rio::Texture2D* get(const GX2Texture& texture);
+    bool isReady(const GX2Texture& texture) const;
+
+    // Main thread: uploads finished decodes
+    void calc();
+
+    bool isBusy() const { return mPendingNum > 0; }
+
+    Stats getStats() const;
+
+    // Decodes every requested texture through both the scalar and the
+    // vectorized paths, on the calling thread. Results are logged and kept
+    // until the next reset().
+    void runBenchmark();
+    const Gx2DecodeBenchmark& getBenchmark() const { return mBenchmark; }
+
+private:
+    enum State
+    {
+        STATE_DECODING,
+        STATE_READY,
+        STATE_FAILED
+    };
+
+    struct Entry
+    {
+        State           state;
+        rio::Texture2D* texture;
+        u32             comp_sel;
+        Gx2SurfaceInfo  info;
+    };
+
+    struct Decoded
+    {
+        const void*     key;
+        u32             generation;
+        u32             width;
+        u32             height;
+        u32             compressed_format;  // GX2 format of the blocks in data, 0 for RGBA8
+        std::vector<u8> data;               // Empty if decoding failed
+        const u8*       baked;              // Used instead of data if set
+        u32             baked_size;
+        u64             decode_time;
+
+        const u8* getData() const { return baked ? baked : data.data(); }
+        u32 getSize() const { return baked ? baked_size : data.size(); }
+    };
+
+    bool canKeepCompressed_(u32 format) const;
+    bool getBaked_(const Gx2SurfaceInfo& info, Decoded* out) const;
+    void upload_(Entry& entry, const Decoded& decoded);
+
+    std::unordered_map<const void*, Entry> mEntries;   // By image pointer
+    std::unique_ptr<ThreadPool> mpThreadPool;
+    std::mutex                  mDecodedMutex;
+    std::vector<Decoded>        mDecoded;
+    std::deque<Decoded>         mUploadQueue;
+    u32                         mGeneration;    // Bumped by reset() to drop stale decodes
+    u32                         mPendingNum;
+    rio::Texture2D*             mpPlaceholder;
+    u32                         mPixelBuffer;
+    const BakedCache*           mpBakedCache;
+    const u8*                   mpResource;
+    u32                         mResourceSize;
+    std::atomic<bool>           mBaking;
+    bool                        mS3tcSupported;
+    bool                        mRgtcSupported;
+    Stats                       mStats;
+    Gx2DecodeBenchmark          mBenchmark;
+};
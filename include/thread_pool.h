@@ -0,0 +1,50 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one FIFO job queue. Jobs must not
+// touch GL; anything that needs the context stays on the main thread.
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Job;
+
+public:
+    // thread_num 0 leaves one hardware thread for the main loop
+    explicit ThreadPool(u32 thread_num = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Job job);
+
+    // Blocks until every submitted job has finished
+    void wait();
+
+    // Blocks until at most pending_num jobs are queued or running
+    void waitPending(u32 pending_num);
+
+    // Jobs queued or running
+    u32 getPendingNum() const;
+
+    u32 getThreadNum() const { return mThreads.size(); }
+
+private:
+    void workerMain_();
+
+    std::vector<std::thread>    mThreads;
+    std::deque<Job>             mJobs;
+    mutable std::mutex          mMutex;
+    std::condition_variable     mJobAvailable;
+    std::condition_variable     mJobDone;
+    u32                         mActiveNum;
+    bool                        mExit;
+};
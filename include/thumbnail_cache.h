@@ -0,0 +1,150 @@
+#pragma once
+
+#include <gfx/rio_Projection.h>
+#include <gpu/rio_RenderBuffer.h>
+#include <gpu/rio_RenderTarget.h>
+#include <gpu/rio_Texture.h>
+
+#include <nw/eft/eft_Handle.h>
+#include <nw/math.h>
+
+#include <thread_pool.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Still thumbnails of every emitter set, taken at frame cCaptureFrame.
+//
+// Sets are only thumbnailed on request, most recent request first, so the
+// selection tree asks for the rows it currently shows. Each thumbnail is
+// keyed by an MD5 of the set's emitter data and stored as a PNG in the
+// cache directory; a cached file is read and decoded by a worker thread.
+// Missing ones are simulated in their own Eft group (cEftGroup), one set at
+// a time alongside the view's group, and rendered straight into their
+// texture when they reach cCaptureFrame. The pixels come back through a
+// fenced PBO and are written to the cache by a worker.
+class ThumbnailCache
+{
+public:
+    static constexpr s32 cSize = 96;
+    static constexpr u32 cCaptureFrame = 30;
+    static constexpr u8 cEftGroup = 1;
+    static constexpr f32 cViewExtent = 512.0f;  // World units across the thumbnail
+
+    struct Stats
+    {
+        u32 ready_num;
+        u32 queued_num;
+        u32 loaded_num;     // Read from the disk cache
+        u32 rendered_num;
+    };
+
+public:
+    ThumbnailCache();
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    static bool isSupported();
+
+    void initialize(const std::string& directory, const nw::math::MTX34& set_mtx);
+    void finalize();
+
+    bool isInitialized() const { return mpThreadPool != nullptr; }
+
+    // Forgets every thumbnail, e.g. after the resource was reloaded
+    void reset();
+
+    // Forgets the thumbnail of one set whose emitter data changed
+    void invalidate(u32 set_index);
+
+    void request(u32 set_index);
+
+    // Work left that needs frames to run: a set being simulated, files
+    // being loaded or readbacks in flight
+    bool isBusy() const { return mRenderSet >= 0 || !mQueue.empty() || mLoadingNum > 0 || !mReadbacks.empty(); }
+
+    // nullptr until the thumbnail is ready
+    const rio::Texture2D* getTexture(u32 set_index) const;
+
+    // Main thread, in the calc phase where emitter sets may be created and
+    // killed: uploads finished loads, collects readbacks and advances the
+    // set being simulated.
+    void calc();
+
+    // True on the frame the simulated set reaches cCaptureFrame. The caller
+    // then draws group cEftGroup between beginRender() and endRender().
+    bool isRenderPending() const { return mRenderPending; }
+    void beginRender();
+    void endRender();
+
+    const rio::OrthoProjection& getProjection() const { return mProjection; }
+    const rio::Texture2D& getRenderColorTexture() const;
+    const rio::Texture2D& getRenderDepthTexture() const { return *mpDepthTexture; }
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    enum State
+    {
+        STATE_NONE,
+        STATE_QUEUED,
+        STATE_LOADING,
+        STATE_RENDERING,
+        STATE_READY,
+        STATE_FAILED
+    };
+
+    struct Entry
+    {
+        State           state;
+        std::string     hash;
+        rio::Texture2D* texture;
+    };
+
+    struct Loaded
+    {
+        u32             set_index;
+        u32             generation;
+        std::vector<u8> rgba;       // Empty if the cached file is missing or unreadable
+    };
+
+    struct Readback
+    {
+        u32         buffer;
+        void*       fence;
+        std::string path;
+    };
+
+    void startNext_();
+    void finishRender_();
+    void uploadLoaded_();
+    void collectReadbacks_(bool wait);
+    void createTexture_(Entry& entry);
+    std::string getPath_(const Entry& entry) const;
+
+    std::string                 mDirectory;
+    nw::math::MTX34             mSetMtx;
+    std::vector<Entry>          mEntries;
+    std::deque<u32>             mQueue;
+    std::unique_ptr<ThreadPool> mpThreadPool;
+    std::mutex                  mLoadedMutex;
+    std::vector<Loaded>         mLoaded;
+    u32                         mGeneration;    // Bumped by reset() to drop stale loads
+    u32                         mLoadingNum;
+    std::vector<Readback>       mReadbacks;
+    s32                         mRenderSet;     // -1 when idle
+    u32                         mRenderFrame;
+    bool                        mRenderPending;
+    nw::eft::Handle             mHandle;        // The set being simulated
+    rio::Texture2D*             mpDepthTexture;
+    rio::RenderTargetColor      mColorTarget;
+    rio::RenderTargetDepth      mDepthTarget;
+    rio::RenderBuffer           mRenderBuffer;
+    rio::OrthoProjection        mProjection;
+    Stats                       mStats;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+// Scoped trace zones, recorded per thread and exported as Chrome trace JSON
+// (loadable in about:tracing and Perfetto).
+// Define EDITOR_TRACE_ENABLE to 0 to compile every zone out.
+#ifndef EDITOR_TRACE_ENABLE
+    #define EDITOR_TRACE_ENABLE 1
+#endif // EDITOR_TRACE_ENABLE
+
+class Trace
+{
+public:
+    // Events kept per thread before the oldest ones are overwritten
+    static constexpr u32 cEventNumPerThread = 0x10000;
+    static constexpr u32 cThreadNumMax = 32;
+
+    struct Event
+    {
+        const char* name;   // Must point to static storage
+        u64         begin;  // Nanoseconds since trace start
+        u64         end;
+    };
+
+public:
+    static u64 now();
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static void record(const char* name, u64 begin, u64 end);
+
+    // Writes every thread's ring buffer to filename. Safe to call while
+    // other threads keep recording.
+    static bool dump(const char* filename);
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : mName(name)
+        , mBegin(Trace::now())
+    {
+    }
+
+    ~TraceScope()
+    {
+        Trace::record(mName, mBegin, Trace::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* mName;
+    u64         mBegin;
+};
+
+#define EDITOR_TRACE_CONCAT_(a, b) a##b
+#define EDITOR_TRACE_CONCAT(a, b) EDITOR_TRACE_CONCAT_(a, b)
+
+#if EDITOR_TRACE_ENABLE
+    #define EDITOR_TRACE_SCOPE(name) TraceScope EDITOR_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+    #define EDITOR_TRACE_SCOPE(name) do { } while (0)
+#endif // EDITOR_TRACE_ENABLE
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <misc/rio_Types.h>
+
+#include <deque>
+#include <vector>
+
+// Undo and redo over a buffer edited in place, here the entered PTCL.
+//
+// Edits are recorded as entries of (offset, old bytes, new bytes), so both
+// memory and the time to undo or redo a step follow the bytes it changed,
+// not the size of the buffer. Consecutive records of the same field, such as
+// a value being dragged, are coalesced into one step until seal() is called.
+// The oldest steps are dropped once the history holds cStepNumMax steps or
+// cByteNumMax bytes.
+//
+// Bulk operations that touch unknown parts of the buffer are bracketed by
+// beginBulk() and endBulk(). On Windows the buffer's pages are made read-only
+// in between and a page is copied by the first write that faults on it, so
+// only the touched pages are ever copied. Elsewhere the whole buffer is
+// copied up front. Either way endBulk() compares the copies with the buffer
+// and keeps the changed bytes as one step.
+class UndoJournal
+{
+public:
+    static constexpr u32 cStepNumMax = 1024;
+    static constexpr u32 cByteNumMax = 32 * 1024 * 1024;
+    static constexpr u32 cNoOwner = 0xFFFFFFFF;
+
+    // Caller-defined owner and tag are handed back with each change, so the
+    // caller can refresh whatever depends on the bytes
+    struct Change
+    {
+        u32 offset;
+        u32 size;
+        u32 owner;
+        u32 tag;
+    };
+
+    struct Stats
+    {
+        u32 undo_num;
+        u32 redo_num;
+        u32 entry_num;
+        u64 byte_num;           // Entries and their old and new bytes
+        u32 coalesced_num;
+        u32 dropped_num;        // Steps dropped from the front of the history
+        u32 bulk_page_num;      // Pages copied by the last bulk operation
+    };
+
+public:
+    UndoJournal();
+    ~UndoJournal();
+
+    UndoJournal(const UndoJournal&) = delete;
+    UndoJournal& operator=(const UndoJournal&) = delete;
+
+    void attach(u8* base, u32 size);
+    void clear();
+
+    // old_bytes is the value before address was written
+    void record(const void* address, const void* old_bytes, u32 size, u32 owner, u32 tag);
+
+    // Ends coalescing of the last step
+    void seal();
+
+    // Records between these are undone as one step
+    void beginGroup();
+    void endGroup();
+
+    bool beginBulk();
+    void endBulk(u32 owner, u32 tag);
+    bool isInBulk() const { return mInBulk; }
+
+    bool canUndo() const { return mCursor > 0; }
+    bool canRedo() const { return mCursor < mSteps.size(); }
+
+    // Appends what was written to changes
+    bool undo(std::vector<Change>* changes);
+    bool redo(std::vector<Change>* changes);
+
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        u32 offset;
+        u32 size;
+        u32 data;       // Old bytes at data, new bytes right after
+        u32 owner;
+        u32 tag;
+    };
+
+    struct Step
+    {
+        std::vector<Entry>  entries;
+        std::vector<u8>     data;
+        bool                coalescable;
+    };
+
+    Step& pushStep_();
+    void addEntry_(Step& step, u32 offset, const void* old_bytes, const void* new_bytes, u32 size, u32 owner, u32 tag);
+    void trim_();
+
+    static u64 getStepByteNum_(const Step& step);
+
+    u8*                 mpBase;
+    u32                 mSize;
+    std::deque<Step>    mSteps;
+    u32                 mCursor;        // Steps before it are applied
+    u32                 mGroupDepth;
+    bool                mInBulk;
+    u64                 mByteNum;
+    u32                 mCoalescedNum;
+    u32                 mDroppedNum;
+    u32                 mBulkPageNum;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <types.h>
+
+// Compiles and links a GLSL program from two shader files relative to the
+// content directory. Returns 0 and logs the info log on failure.
+u32 CreateProgramFromContent(const char* vertex_fname, const char* fragment_fname);
+void DestroyProgram(u32 program);
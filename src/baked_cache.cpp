@@ -0,0 +1,220 @@
+#include <baked_cache.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if RIO_IS_WIN
+    #include <md5.hpp>
+    #include <windows.h>
+#endif // RIO_IS_WIN
+
+static inline u64 AlignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+BakedCache::BakedCache()
+    : mpBase(nullptr)
+    , mFileSize(0)
+    , mpTextures(nullptr)
+    , mTextureNum(0)
+{
+}
+
+BakedCache::~BakedCache()
+{
+    close();
+}
+
+bool BakedCache::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+std::string BakedCache::hashSource(const void* data, u32 size)
+{
+#if RIO_IS_WIN
+    MD5 md5;
+    md5.update(static_cast<const char*>(data), size);
+    return md5.finalize().hexdigest();
+#else
+    return std::string();
+#endif // RIO_IS_WIN
+}
+
+bool BakedCache::open(const std::string& path, const std::string& source_hash)
+{
+    close();
+
+#if RIO_IS_WIN
+    EDITOR_TRACE_SCOPE("OpenBakedCache");
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || u64(file_size.QuadPart) < sizeof(Header))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Copy-on-write, so the pointer fixup below stays private to the process
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    mpBase = static_cast<u8*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!mpBase)
+        return false;
+
+    mFileSize = file_size.QuadPart;
+#endif // RIO_IS_WIN
+
+    if (!mpBase)
+        return false;
+
+    const Header* header = reinterpret_cast<const Header*>(mpBase);
+    const bool valid = header->magic == cMagic &&
+                       header->version == cVersion &&
+                       header->byte_order == cByteOrder &&
+                       header->header_size == sizeof(Header) &&
+                       header->file_size == mFileSize &&
+                       source_hash.size() == sizeof(header->source_hash) &&
+                       std::memcmp(header->source_hash, source_hash.data(), sizeof(header->source_hash)) == 0 &&
+                       header->texture_table + u64(header->texture_num) * sizeof(TextureRecord) <= mFileSize;
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    mpTextures = reinterpret_cast<TextureRecord*>(mpBase + header->texture_table);
+    mTextureNum = header->texture_num;
+
+    for (u32 i = 0; i < mTextureNum; i++)
+    {
+        TextureRecord& record = mpTextures[i];
+        if (record.data + record.size > mFileSize)
+        {
+            close();
+            return false;
+        }
+
+        record.data = u64(uintptr_t(mpBase + record.data));
+    }
+
+    return true;
+}
+
+void BakedCache::close()
+{
+#if RIO_IS_WIN
+    if (mpBase)
+        UnmapViewOfFile(mpBase);
+#endif // RIO_IS_WIN
+
+    mpBase = nullptr;
+    mFileSize = 0;
+    mpTextures = nullptr;
+    mTextureNum = 0;
+}
+
+const BakedCache::TextureRecord* BakedCache::findTexture(u32 source_offset) const
+{
+    const TextureRecord* begin = mpTextures;
+    const TextureRecord* end = begin + mTextureNum;
+    const TextureRecord* it = std::lower_bound(begin, end, source_offset,
+                                               [](const TextureRecord& record, u32 value) { return record.source_offset < value; });
+
+    return it != end && it->source_offset == source_offset ? it : nullptr;
+}
+
+bool BakedCache::write(const std::string& path, const std::string& source_hash, std::vector<Texture> textures)
+{
+    EDITOR_TRACE_SCOPE("WriteBakedCache");
+
+    if (source_hash.size() != sizeof(Header::source_hash))
+        return false;
+
+    std::sort(textures.begin(), textures.end(), [](const Texture& a, const Texture& b) { return a.source_offset < b.source_offset; });
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = cMagic;
+    header.version = cVersion;
+    header.byte_order = cByteOrder;
+    header.header_size = sizeof(Header);
+    header.texture_num = textures.size();
+    header.texture_table = sizeof(Header);
+    std::memcpy(header.source_hash, source_hash.data(), sizeof(header.source_hash));
+
+    std::vector<TextureRecord> records(textures.size());
+
+    u64 offset = header.texture_table + records.size() * sizeof(TextureRecord);
+    for (u32 i = 0; i < textures.size(); i++)
+    {
+        offset = AlignUp(offset, cDataAlignment);
+
+        TextureRecord& record = records[i];
+        record.source_offset = textures[i].source_offset;
+        record.width = textures[i].width;
+        record.height = textures[i].height;
+        record.compressed_format = textures[i].compressed_format;
+        record.size = textures[i].data.size();
+        record.reserved = 0;
+        record.data = offset;
+
+        offset += record.size;
+    }
+    header.file_size = offset;
+
+    const std::filesystem::path final_path(path);
+    std::filesystem::path temp_path(final_path);
+    temp_path += ".tmp";
+
+    std::error_code error;
+    std::filesystem::create_directories(final_path.parent_path(), error);
+
+    {
+        std::ofstream out(temp_path, std::ofstream::binary | std::ofstream::trunc);
+        if (!out)
+            return false;
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TextureRecord));
+
+        static const char cPadding[cDataAlignment] = { };
+        for (u32 i = 0; i < textures.size(); i++)
+        {
+            out.write(cPadding, records[i].data - u64(out.tellp()));
+            out.write(reinterpret_cast<const char*>(textures[i].data.data()), textures[i].data.size());
+        }
+
+        if (!out)
+        {
+            out.close();
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, final_path, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
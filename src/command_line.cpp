@@ -0,0 +1,61 @@
+#include <command_line.h>
+
+#include <cstring>
+
+CommandLine g_CommandLine = {
+    false,
+    false,
+    std::string(),
+    std::string(),
+    { std::string(), std::string() },
+    false,
+    { std::string(), std::string() },
+    0
+};
+
+bool ParseCommandLine(int argc, char** argv)
+{
+    for (s32 i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if (std::strcmp(arg, "--regression") == 0)
+        {
+            g_CommandLine.regression = true;
+        }
+        else if (std::strcmp(arg, "--update-golden") == 0)
+        {
+            g_CommandLine.regression = true;
+            g_CommandLine.update_golden = true;
+        }
+        else if (std::strcmp(arg, "--golden-dir") == 0 && i + 1 < argc)
+        {
+            g_CommandLine.golden_dir = argv[++i];
+        }
+        else if (std::strcmp(arg, "--report-dir") == 0 && i + 1 < argc)
+        {
+            g_CommandLine.report_dir = argv[++i];
+        }
+        else if (std::strcmp(arg, "--diff") == 0 && i + 2 < argc)
+        {
+            g_CommandLine.diff_path[0] = argv[++i];
+            g_CommandLine.diff_path[1] = argv[++i];
+        }
+        else if (std::strcmp(arg, "--json") == 0)
+        {
+            g_CommandLine.diff_json = true;
+        }
+        else if (std::strcmp(arg, "--optimize") == 0 && i + 2 < argc)
+        {
+            g_CommandLine.optimize_path[0] = argv[++i];
+            g_CommandLine.optimize_path[1] = argv[++i];
+        }
+        else
+        {
+            RIO_LOG("Unknown or incomplete option: %s\n", arg);
+            return false;
+        }
+    }
+
+    return true;
+}
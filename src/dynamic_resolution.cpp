@@ -0,0 +1,158 @@
+#include <dynamic_resolution.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if RIO_IS_WIN
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+static constexpr f32 cMaxScale = 1.0f;
+static constexpr f32 cTimeSmoothing = 0.2f;     // Weight of the newest sample
+static constexpr f32 cMaxScaleStep = 0.05f;     // Per collected frame
+static constexpr f32 cScaleHysteresis = 0.02f;
+
+DynamicResolution::DynamicResolution()
+    : mFrameIndex(0)
+    , mInitialized(false)
+    , mEnabled(true)
+    , mRecording(false)
+    , mTargetTimeMs(12.0f)
+    , mMinScale(0.5f)
+    , mScale(1.0f)
+    , mTimeMs(0.0f)
+{
+    std::memset(mFrame, 0, sizeof(mFrame));
+    mStats.gpu_time_ms = 0.0f;
+    mStats.scale = 1.0f;
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    finalize();
+}
+
+bool DynamicResolution::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+void DynamicResolution::initialize()
+{
+    if (mInitialized || !isSupported())
+        return;
+
+    for (u32 i = 0; i < cFrameLatency; i++)
+    {
+#if RIO_IS_WIN
+        RIO_GL_CALL(glGenQueries(2, mFrame[i].query));
+#endif // RIO_IS_WIN
+        mFrame[i].pending = false;
+    }
+
+    mFrameIndex = 0;
+    mScale = 1.0f;
+    mTimeMs = 0.0f;
+    mInitialized = true;
+}
+
+void DynamicResolution::finalize()
+{
+    if (!mInitialized)
+        return;
+
+#if RIO_IS_WIN
+    for (u32 i = 0; i < cFrameLatency; i++)
+    {
+        RIO_GL_CALL(glDeleteQueries(2, mFrame[i].query));
+    }
+#endif // RIO_IS_WIN
+
+    mInitialized = false;
+}
+
+void DynamicResolution::setEnabled(bool enabled)
+{
+    if (mEnabled == enabled)
+        return;
+
+    mEnabled = enabled;
+
+    // Start from full resolution again rather than from a stale estimate
+    mScale = 1.0f;
+    mTimeMs = 0.0f;
+    mStats.scale = 1.0f;
+}
+
+void DynamicResolution::beginFrame()
+{
+    mRecording = false;
+
+    if (!mInitialized)
+        return;
+
+    Frame& frame = mFrame[mFrameIndex];
+    if (frame.pending)
+    {
+#if RIO_IS_WIN
+        GLuint available = GL_FALSE;
+        RIO_GL_CALL(glGetQueryObjectuiv(frame.query[1], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (available == GL_FALSE)
+            return; // Skip measuring this frame rather than stall
+
+        GLuint64 begin_ns = 0;
+        GLuint64 end_ns = 0;
+        RIO_GL_CALL(glGetQueryObjectui64v(frame.query[0], GL_QUERY_RESULT, &begin_ns));
+        RIO_GL_CALL(glGetQueryObjectui64v(frame.query[1], GL_QUERY_RESULT, &end_ns));
+
+        update_((end_ns - begin_ns) / 1000000.0f);
+#endif // RIO_IS_WIN
+
+        frame.pending = false;
+    }
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glQueryCounter(frame.query[0], GL_TIMESTAMP));
+#endif // RIO_IS_WIN
+    mRecording = true;
+}
+
+void DynamicResolution::endFrame()
+{
+    if (!mRecording)
+        return;
+
+    Frame& frame = mFrame[mFrameIndex];
+#if RIO_IS_WIN
+    RIO_GL_CALL(glQueryCounter(frame.query[1], GL_TIMESTAMP));
+#endif // RIO_IS_WIN
+    frame.pending = true;
+
+    mFrameIndex = (mFrameIndex + 1) % cFrameLatency;
+    mRecording = false;
+}
+
+void DynamicResolution::update_(f32 gpu_time_ms)
+{
+    mTimeMs = mTimeMs == 0.0f ? gpu_time_ms : mTimeMs + (gpu_time_ms - mTimeMs) * cTimeSmoothing;
+    mStats.gpu_time_ms = mTimeMs;
+
+    if (!mEnabled || mTimeMs <= 0.0f)
+        return;
+
+    // GPU time is roughly proportional to the pixel count, so the scale per
+    // axis goes with the square root of the time ratio
+    f32 scale = mScale * std::sqrt(mTargetTimeMs / mTimeMs);
+    scale = std::clamp(scale, mScale - cMaxScaleStep, mScale + cMaxScaleStep);
+    scale = std::clamp(scale, mMinScale, cMaxScale);
+
+    if (std::abs(scale - mScale) >= cScaleHysteresis || scale == mMinScale || scale == cMaxScale)
+        mScale = scale;
+
+    mStats.scale = mScale;
+}
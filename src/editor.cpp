@@ -1,9 +1,17 @@
+#include <command_line.h>
 #include <editor.h>
 #include <eft.h>
+#include <ptcl_layout.h>
+#include <simd.h>
+#include <trace.h>
 #include <ui/ImGuiUtil.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <new>
 #include <string>
+#include <type_traits>
 
 #include <nw/eft/eft_Config.h>
 #include <nw/eft/eft_Emitter.h>
@@ -24,6 +32,9 @@
 #if RIO_IS_WIN
     #include <file.hpp>
     #include <globals.hpp>
+    #include <misc/gl/rio_GL.h>
+
+    #include <GLFW/glfw3.h>
 #endif // RIO_IS_WIN
 
 #include <rio.h>
@@ -31,6 +42,14 @@
 #include <imgui_internal.h>
 
 static constexpr f32 cScale = 4.0f;
+static constexpr u32 cStreamBufferRegionSize = 1024 * 1024;
+
+static const rio::Color4f cViewClearColor = {
+    119 / 255.f,
+    136 / 255.f,
+    153 / 255.f,
+    1.0f
+};
 
 bool ReadContentFile(const char* filename, u8** out_data, u32* out_size);
 void FreeContentFile(const void* data);
@@ -55,6 +74,85 @@ static inline bool InitEftSystem()
     return true;
 }
 
+static inline std::string GetTraceFilePath()
+{
+#if RIO_IS_WIN
+    return g_CWD + "/trace.json";
+#else
+    return "trace.json";
+#endif // RIO_IS_WIN
+}
+
+static inline nw::math::MTX34 GetEmitterSetMtx()
+{
+    rio::Matrix34f mtx;
+    mtx.makeS({ cScale * 1.5f, cScale * 1.5f, cScale });
+    return reinterpret_cast<const nw::math::MTX34&>(mtx.a[0]);
+}
+
+static inline std::string GetThumbnailDirectory()
+{
+#if RIO_IS_WIN
+    return g_CafeCachePath + "/Thumbnails";
+#else
+    return "Thumbnails";
+#endif // RIO_IS_WIN
+}
+
+static inline std::string GetBakedCachePath(const std::string& source_hash)
+{
+#if RIO_IS_WIN
+    return g_CafeCachePath + "/Baked/" + source_hash + ".bake";
+#else
+    return "Baked/" + source_hash + ".bake";
+#endif // RIO_IS_WIN
+}
+
+static inline std::string GetContentFilePath(const char* filename)
+{
+#if RIO_IS_WIN
+    return g_CWD + "/fs/content/" + filename;
+#else
+    return filename;
+#endif // RIO_IS_WIN
+}
+
+static inline std::string GetCaptureDirectory()
+{
+#if RIO_IS_WIN
+    return g_CWD + "/capture";
+#else
+    return "capture";
+#endif // RIO_IS_WIN
+}
+
+static inline std::string GetRegressionDirectory()
+{
+#if RIO_IS_WIN
+    return g_CWD + "/regression";
+#else
+    return "regression";
+#endif // RIO_IS_WIN
+}
+
+static inline RegressionRunner::Settings GetRegressionSettings(bool update_golden)
+{
+    RegressionRunner::Settings settings;
+    settings.golden_dir = g_CommandLine.golden_dir.empty() ? GetRegressionDirectory() + "/golden" : g_CommandLine.golden_dir;
+    settings.report_dir = g_CommandLine.report_dir.empty() ? GetRegressionDirectory() + "/report" : g_CommandLine.report_dir;
+    settings.update_golden = update_golden;
+    return settings;
+}
+
+// Ends the main loop after the current frame
+static inline void RequestExit(s32 exit_code)
+{
+    g_CommandLine.exit_code = exit_code;
+#if RIO_IS_WIN
+    glfwSetWindowShouldClose(glfwGetCurrentContext(), GLFW_TRUE);
+#endif // RIO_IS_WIN
+}
+
 static inline bool DeInitEftSystem()
 {
     if (!g_EftSystem)
@@ -67,6 +165,115 @@ static inline bool DeInitEftSystem()
     return true;
 }
 
+static inline bool HasImGuiInput()
+{
+    const ImGuiIO& io = ImGui::GetIO();
+
+    if (io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f || io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f)
+        return true;
+
+    for (u32 i = 0; i < IM_ARRAYSIZE(io.MouseDown); i++)
+        if (io.MouseDown[i])
+            return true;
+
+    if (io.InputQueueCharacters.Size > 0)
+        return true;
+
+    for (s32 key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_NamedKey_END; key++)
+        if (ImGui::IsKeyDown(ImGuiKey(key)))
+            return true;
+
+    return ImGui::IsAnyItemActive();
+}
+
+// What the widgets of one emitter changed this frame
+struct EmitterEdit
+{
+    UndoJournal*    journal;
+    u32             owner;      // Offset of the emitter record
+    bool            edited;
+    u32             derived;    // LiveEdit::Derived
+
+    void record(const void* address, const void* old_value, u32 size, u32 derived_state)
+    {
+        journal->record(address, old_value, size, owner, derived_state);
+        edited = true;
+        derived |= derived_state;
+    }
+};
+
+template <typename T>
+static constexpr ImGuiDataType GetImGuiDataType()
+{
+    static_assert(std::is_integral_v<T>, "Not an integer type");
+
+    switch (sizeof(T))
+    {
+    case 1:     return std::is_signed_v<T> ? ImGuiDataType_S8  : ImGuiDataType_U8;
+    case 2:     return std::is_signed_v<T> ? ImGuiDataType_S16 : ImGuiDataType_U16;
+    case 4:     return std::is_signed_v<T> ? ImGuiDataType_S32 : ImGuiDataType_U32;
+    default:    return std::is_signed_v<T> ? ImGuiDataType_S64 : ImGuiDataType_U64;
+    }
+}
+
+template <typename T>
+static inline void EditScalar(EmitterEdit& edit, const char* label, T* value, u32 derived)
+{
+    const T old_value = *value;
+    bool changed;
+
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        changed = ImGui::DragFloat(label, value, 0.01f);
+    }
+    else
+    {
+        // Enums are edited as their underlying integer
+        typedef typename std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, std::common_type<T>>::type Integer;
+        changed = ImGui::InputScalar(label, GetImGuiDataType<Integer>(), value);
+    }
+
+    if (changed)
+        edit.record(value, &old_value, sizeof(T), derived);
+}
+
+template <typename T>
+static inline void EditFlag(EmitterEdit& edit, const char* label, T* value, u32 derived)
+{
+    const T old_value = *value;
+
+    bool flag = *value != 0;
+    if (!ImGui::Checkbox(label, &flag))
+        return;
+
+    *value = T(flag);
+    edit.record(value, &old_value, sizeof(T), derived);
+}
+
+template <typename T>
+static inline void EditVec2(EmitterEdit& edit, const char* label, T* value, u32 derived)
+{
+    const T old_value = *value;
+    if (ImGui::DragFloat2(label, &value->x, 0.01f))
+        edit.record(value, &old_value, sizeof(T), derived);
+}
+
+template <typename T>
+static inline void EditVec3(EmitterEdit& edit, const char* label, T* value, u32 derived)
+{
+    const T old_value = *value;
+    if (ImGui::DragFloat3(label, &value->x, 0.01f))
+        edit.record(value, &old_value, sizeof(T), derived);
+}
+
+template <typename T>
+static inline void EditColor(EmitterEdit& edit, const char* label, T* value, u32 derived)
+{
+    const T old_value = *value;
+    if (ImGui::ColorEdit4(label, &value->r, ImGuiColorEditFlags_Float | ImGuiColorEditFlags_HDR))
+        edit.record(value, &old_value, sizeof(T), derived);
+}
+
 Editor::Editor()
     : rio::ITask("NSMBU Editor")
     , mPrevEmitterSet(0)
@@ -78,7 +285,24 @@ Editor::Editor()
     , mViewFocused(false)
     , mpColorTexture(nullptr)
     , mpDepthTexture(nullptr)
+    , mRenderTargetSize{ 0, 0 }
+    , mRenderSize{ 0, 0 }
+    , mViewResizeFrame(0)
+    , mSphereMesh(GeometryCache::cInvalidMesh)
+    , mSaveConflict(false)
+    , mDiffDone(false)
+    , mOptimizeDone(false)
+    , mLastRenderSize{ 0, 0 }
 {
+    std::memset(&mEndianSwapBenchmark, 0, sizeof(mEndianSwapBenchmark));
+    std::memset(&mReloadStats, 0, sizeof(mReloadStats));
+
+    mCaptureSettings.width = 1280;
+    mCaptureSettings.height = 720;
+    mCaptureSettings.frame_num = 120;
+    mCaptureSettings.format = FrameCapture::FORMAT_PNG;
+    mCaptureSettings.directory = GetCaptureDirectory();
+    mCaptureSettings.encode_video = false;
 }
 
 void Editor::initEftSystem_()
@@ -87,48 +311,177 @@ void Editor::initEftSystem_()
     RIO_ASSERT(eft_system_initialized);
 
     mPtclFile = NULL;
-    u32 ptcl_file_len = 0;
+    mPtclFileSize = 0;
 
-    [[maybe_unused]] bool read = ReadContentFile("Eset_Cafe.ptcl", &mPtclFile, &ptcl_file_len);
-    RIO_ASSERT(read);
+    {
+        EDITOR_TRACE_SCOPE("LoadResource");
 
-    RIO_LOG("Ptcl file size: %u\n", ptcl_file_len);
-    RIO_LOG("Ptcl file magic: %c%c%c%c\n", mPtclFile[0], mPtclFile[1], mPtclFile[2], mPtclFile[3]);
+        [[maybe_unused]] bool read = ReadContentFile("Eset_Cafe.ptcl", &mPtclFile, &mPtclFileSize);
+        RIO_ASSERT(read);
+    }
+
+    entryResource_();
 
-    g_EftSystem->EntryResource(&g_EftRootHeap, mPtclFile, 0);
+    EDITOR_TRACE_SCOPE("CreateEmitterSet");
 
     [[maybe_unused]] bool created = g_EftSystem->CreateEmitterSetID(&g_EftHandle, nw::math::MTX34::Identity(), mCurrentEmitterSet);
     RIO_ASSERT(created);
 
-    rio::Matrix34f mtx;
-    mtx.makeS({ cScale * 1.5f, cScale * 1.5f, cScale });
-    g_EftHandle.GetEmitterSet()->SetMtx(reinterpret_cast<const nw::math::MTX34&>(mtx.a[0]));
+    g_EftHandle.GetEmitterSet()->SetMtx(GetEmitterSetMtx());
 
     RIO_LOG("Current EmitterSet: %s\n", g_EftSystem->GetResource(0)->GetEmitterSetName(mCurrentEmitterSet));
 }
 
+void Editor::entryResource_()
+{
+    mPtclHash = BakedCache::hashSource(mPtclFile, mPtclFileSize);
+
+    // Eft swaps the buffer in place, keep the file as read for saving
+    if (PtclWriter::isSupported())
+        mPtclWriter.setSource(mPtclFile, mPtclFileSize, GetContentFilePath("Eset_Cafe.ptcl"));
+
+    RIO_LOG("Ptcl file size: %u\n", mPtclFileSize);
+    RIO_LOG("Ptcl file magic: %c%c%c%c\n", mPtclFile[0], mPtclFile[1], mPtclFile[2], mPtclFile[3]);
+
+    {
+        EDITOR_TRACE_SCOPE("EntryResource");
+        g_EftSystem->EntryResource(&g_EftRootHeap, mPtclFile, 0);
+    }
+
+    if (PtclWriter::isSupported())
+        mPtclWriter.track(g_EftSystem->GetResource(0), mPtclFile);
+
+    mUndoJournal.attach(mPtclFile, mPtclFileSize);
+}
+
+// Eft enters and clears whole resources only, so everything that points into
+// the resource goes with it
+void Editor::clearResource_()
+{
+    if (g_EftHandle.IsValid())
+        g_EftHandle.GetEmitterSet()->Kill();
+
+    mThumbnailCache.reset();
+    mTextureStreamer.reset();
+    mBakedCache.close();
+    mPtclWriter.reset();
+    mUndoJournal.clear();
+    mLiveEdit.clear();
+    mEmitterProfiler.reset();
+    mOverdrawView.reset();
+    g_EftSystem->ClearResource(&g_EftRootHeap, 0);
+    FreeContentFile(mPtclFile);
+
+    mPtclFile = nullptr;
+    mPtclFileSize = 0;
+}
+
+// A new Eft system, with the random sequence of a freshly started one, and
+// the file entered again with the unsaved edits of tracked fields, showing
+// set_index. Returns false, leaving everything as it was, if the file
+// changed on disk since it was read or saved.
+bool Editor::restartEftSystem_(u32 set_index)
+{
+    EDITOR_TRACE_SCOPE("RestartEftSystem");
+
+    u8* data = nullptr;
+    u32 size = 0;
+    if (!ReadContentFile("Eset_Cafe.ptcl", &data, &size))
+        return false;
+
+    std::vector<u8> edited;
+    if (mPtclWriter.isTracking())
+    {
+        const std::vector<u8>& image = mPtclWriter.getImage();
+        if (image.size() != size || std::memcmp(image.data(), data, size) != 0)
+        {
+            FreeContentFile(data);
+            return false;
+        }
+
+        mPtclWriter.getEditedImage(&edited);
+    }
+
+    clearResource_();
+    DeInitEftSystem();
+
+    [[maybe_unused]] bool eft_system_initialized = InitEftSystem();
+    RIO_ASSERT(eft_system_initialized);
+
+    mPtclFile = data;
+    mPtclFileSize = size;
+    entryResource_();
+
+    // Still unsaved, the writer keeps the file as on disk
+    if (!edited.empty() && mPtclWriter.isTracking())
+        mPtclWriter.restoreEdits(edited.data());
+
+    mCurrentEmitterSet = set_index < g_EftSystem->GetResource(0)->GetNumEmitterSet() ? set_index : 0;
+    mPrevEmitterSet = mCurrentEmitterSet;
+
+    [[maybe_unused]] bool created = g_EftSystem->CreateEmitterSetID(&g_EftHandle, nw::math::MTX34::Identity(), mCurrentEmitterSet);
+    RIO_ASSERT(created);
+
+    g_EftHandle.GetEmitterSet()->SetMtx(GetEmitterSetMtx());
+
+    loadBakedCache_();
+    return true;
+}
+
 void Editor::calcEftSystem_()
 {
-    g_EftSystem->BeginFrame();
-    g_EftSystem->SwapDoubleBuffer();
+    EDITOR_TRACE_SCOPE("CalcEftSystem");
 
-    g_EftSystem->CalcEmitter(0);
-    g_EftSystem->CalcParticle(true);
+    {
+        EDITOR_TRACE_SCOPE("BeginFrame");
+        g_EftSystem->BeginFrame();
+    }
+    {
+        EDITOR_TRACE_SCOPE("SwapDoubleBuffer");
+        g_EftSystem->SwapDoubleBuffer();
+    }
+    {
+        EDITOR_TRACE_SCOPE("CalcEmitter");
+        g_EftSystem->CalcEmitter(0);
+        if (mThumbnailCache.isInitialized())
+            g_EftSystem->CalcEmitter(ThumbnailCache::cEftGroup);
+    }
+    {
+        EDITOR_TRACE_SCOPE("CalcParticle");
+        g_EftSystem->CalcParticle(true);
+    }
 
     // --------- All modifications happen here ---------
 
-    if (mLoopEmitterSet && !g_EftHandle.GetEmitterSet()->IsAlive())
+    // Regression sets run for a fixed frame count from their first frame
+    if (mLoopEmitterSet && !mRegressionRunner.isRunning() && !g_EftHandle.GetEmitterSet()->IsAlive())
+        changeEftEmitterSet_();
+
+    // Edits made in the UI since the last Calc
+    if (mLiveEdit.apply(g_EftSystem->GetEmitterHead(0)))
         changeEftEmitterSet_();
 
+    mThumbnailCache.calc();
+
     // -------------------------------------------------
 
-    g_EftSystem->Calc(true);
+    {
+        EDITOR_TRACE_SCOPE("Calc");
+        g_EftSystem->Calc(true);
+    }
+
+    // After all creation and killing so no stale instance keeps its bounds
+    EDITOR_TRACE_SCOPE("UpdateEmitterBounds");
+    mEmitterCuller.update(g_EftSystem->GetEmitterHead(0));
 }
 
-void Editor::drawEftSystem_(const nw::math::MTX44& proj, const nw::math::MTX34& view, const nw::math::VEC3& camPos, f32 zNear, f32 zFar)
+void Editor::drawEftSystem_(const nw::math::MTX44& proj, const nw::math::MTX34& view, const nw::math::VEC3& camPos, f32 zNear, f32 zFar,
+                            const rio::Texture2D& color_texture, const rio::Texture2D& depth_texture, u8 group_id, bool instrumented)
 {
-    g_EftSystem->GetRenderer()->SetFrameBufferTexture(mpColorTexture->getNativeTextureHandle());
-    g_EftSystem->GetRenderer()->SetDepthTexture(mpDepthTexture->getNativeTextureHandle());
+    EDITOR_TRACE_SCOPE("DrawEftSystem");
+
+    g_EftSystem->GetRenderer()->SetFrameBufferTexture(color_texture.getNativeTextureHandle());
+    g_EftSystem->GetRenderer()->SetDepthTexture(depth_texture.getNativeTextureHandle());
 
     rio::Shader::setShaderMode(rio::Shader::MODE_UNIFORM_BLOCK);
 
@@ -136,10 +489,34 @@ void Editor::drawEftSystem_(const nw::math::MTX44& proj, const nw::math::MTX34&
     GX2Invalidate(GX2_INVALIDATE_SHADER, 0, 0xFFFFFFFF);
 #endif // RIO_IS_CAFE
 
+    mEmitterCuller.beginCull(proj, view);
+    mRenderQueue.build(g_EftSystem->GetEmitterHead(group_id), &mEmitterCuller);
+
     g_EftSystem->BeginRender(proj, view, camPos, zNear, zFar);
 
-    for (nw::eft::EmitterInstance* emitter = g_EftSystem->GetEmitterHead(0); emitter != NULL; emitter = emitter->next)
-        g_EftSystem->RenderEmitter(emitter, true, NULL);
+    if (instrumented)
+    {
+        mEmitterProfiler.beginFrame();
+
+        for (const RenderQueue::Packet& packet : mRenderQueue.getPackets())
+        {
+            EDITOR_TRACE_SCOPE("RenderEmitter");
+
+            nw::eft::EmitterInstance* emitter = packet.emitter;
+            mEmitterProfiler.beginEmitter(emitter);
+            mOverdrawView.beginEmitter(emitter);
+            g_EftSystem->RenderEmitter(emitter, true, NULL);
+            mOverdrawView.endEmitter();
+            mEmitterProfiler.endEmitter();
+        }
+
+        mEmitterProfiler.endFrame();
+    }
+    else
+    {
+        for (const RenderQueue::Packet& packet : mRenderQueue.getPackets())
+            g_EftSystem->RenderEmitter(packet.emitter, true, NULL);
+    }
 
     g_EftSystem->EndRender();
 
@@ -148,14 +525,14 @@ void Editor::drawEftSystem_(const nw::math::MTX44& proj, const nw::math::MTX34&
 
 void Editor::changeEftEmitterSet_()
 {
+    EDITOR_TRACE_SCOPE("CreateEmitterSet");
+
     g_EftHandle.GetEmitterSet()->Kill();
 
     [[maybe_unused]] bool created = g_EftSystem->CreateEmitterSetID(&g_EftHandle, nw::math::MTX34::Identity(), mCurrentEmitterSet);
     RIO_ASSERT(created);
 
-    rio::Matrix34f mtx;
-    mtx.makeS({ cScale * 1.5f, cScale * 1.5f, cScale });
-    g_EftHandle.GetEmitterSet()->SetMtx(reinterpret_cast<const nw::math::MTX34&>(mtx.a[0]));
+    g_EftHandle.GetEmitterSet()->SetMtx(GetEmitterSetMtx());
 }
 
 void Editor::calcViewUi_()
@@ -194,7 +571,12 @@ void Editor::calcViewUi_()
         texture_id = (void*)(mpColorTexture->getNativeTextureHandle());
 #endif
 
-        ImGui::Image(texture_id, size);
+        // Only the top-left mRenderSize of the bucketed target holds the view
+        const ImVec2 uv1(
+            f32(mRenderSize.x) / f32(mRenderTargetSize.x),
+            f32(mRenderSize.y) / f32(mRenderTargetSize.y)
+        );
+        ImGui::Image(texture_id, size, ImVec2(0.0f, 0.0f), uv1);
 
         bool moved = false;
         if (mViewPos.x != pos.x || mViewPos.y != pos.y)
@@ -224,6 +606,14 @@ void Editor::drawUiEmitterSelection_()
         if (ImGui::Button("Play"))
             changeEftEmitterSet_();
 
+        if (mGeometryCache.isInitialized())
+        {
+            ImGui::SameLine();
+            bool show_volumes = mEmitterGizmo.isEnabled();
+            if (ImGui::Checkbox("Volumes", &show_volumes))
+                mEmitterGizmo.setEnabled(show_volumes);
+        }
+
         u32 emitter_set_num = resource->GetNumEmitterSet();
         for (u32 i = 0; i < emitter_set_num; i++)
         {
@@ -242,6 +632,27 @@ void Editor::drawUiEmitterSelection_()
                 // Display additional information or take action if the node is hovered or focused (optional)
             }
 
+            // Only rows on screen ask for their thumbnail
+            if (ImGui::IsItemVisible())
+            {
+                mThumbnailCache.request(i);
+
+                const rio::Texture2D* thumbnail = mThumbnailCache.getTexture(i);
+                if (thumbnail)
+                {
+                    const f32 icon_size = ImGui::GetTextLineHeight();
+                    ImGui::SameLine(ImGui::GetContentRegionMax().x - icon_size);
+                    ImGui::Image((void*)(thumbnail->getNativeTextureHandle()), { icon_size, icon_size });
+
+                    if (ImGui::IsItemHovered())
+                    {
+                        ImGui::BeginTooltip();
+                        ImGui::Image((void*)(thumbnail->getNativeTextureHandle()), { f32(ThumbnailCache::cSize), f32(ThumbnailCache::cSize) });
+                        ImGui::EndTooltip();
+                    }
+                }
+            }
+
             // Draw emitter tree if node is open
             if (node_open)
             {
@@ -277,53 +688,90 @@ void Editor::drawUiEmitterEdit_()
         u32 emitter_num = resource->GetNumEmitter(mCurrentEmitterSet);
 
         ImGui::Text("EmitterSet: %s", resource->GetEmitterSetName(mCurrentEmitterSet));
+
+        const ImGuiIO& io = ImGui::GetIO();
+        const bool shortcut = io.KeyCtrl && !io.WantTextInput;
+
+        ImGui::BeginDisabled(!mUndoJournal.canUndo());
+        if (ImGui::Button("Undo") || (shortcut && ImGui::IsKeyPressed(ImGuiKey_Z) && mUndoJournal.canUndo()))
+            undoEdit_(false);
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        ImGui::BeginDisabled(!mUndoJournal.canRedo());
+        if (ImGui::Button("Redo") || (shortcut && ImGui::IsKeyPressed(ImGuiKey_Y) && mUndoJournal.canRedo()))
+            undoEdit_(true);
+        ImGui::EndDisabled();
+
         for (u32 i = 0; i < emitter_num; i++)
         {
-            const nw::eft::CommonEmitterData* emitter = resource->GetEmitterData(mCurrentEmitterSet, i);
+            // The resource lives in mPtclFile, which the editor owns
+            nw::eft::CommonEmitterData* emitter = const_cast<nw::eft::CommonEmitterData*>(resource->GetEmitterData(mCurrentEmitterSet, i));
+            EmitterEdit edit = { &mUndoJournal, u32(reinterpret_cast<u8*>(emitter) - mPtclFile), false, LiveEdit::DERIVED_NONE };
+
+            ImGui::PushID(i);
 
             // TODO: Rest of CommonEmitterData info
-            ImGui::Text("Flg: %u", emitter->flg);
-            ImGui::Text("RandomSeed: %u", emitter->randomSeed);
-            ImGui::Text("UserData1: %u", emitter->userData);
-            ImGui::Text("UserData2: %u", emitter->userData2);
+            EditScalar(edit, "Flg", &emitter->flg, LiveEdit::DERIVED_CREATE);
+            EditScalar(edit, "RandomSeed", &emitter->randomSeed, LiveEdit::DERIVED_CREATE);
+            EditScalar(edit, "UserData1", &emitter->userData, LiveEdit::DERIVED_NONE);
+            EditScalar(edit, "UserData2", &emitter->userData2, LiveEdit::DERIVED_NONE);
 
             for (u32 i = 0; i < nw::eft::EFT_USER_DATA_PARAM_MAX; i++)
             {
-                ImGui::Text(("UserDataF" + std::to_string(i) + ": %f").c_str(), i);
+                EditScalar(edit, ("UserDataF" + std::to_string(i)).c_str(), &emitter->userDataF[i], LiveEdit::DERIVED_NONE);
             }
 
-            ImGui::Text("UserCallbackID: %d", emitter->userCallbackID);
+            EditScalar(edit, "UserCallbackID", &emitter->userCallbackID, LiveEdit::DERIVED_NONE);
             ImGui::Text("NamePos: %d", emitter->namePos);
             ImGui::Text("Name: %s", emitter->name);
 
             for (u32 i = 0; i < nw::eft::EFT_TEXTURE_SLOT_BIN_MAX; i++)
             {
+                const GX2Texture& texture = emitter->texRes[i].gx2Texture;
+                if (!texture.surface.imagePtr)
+                {
+                    ImGui::Text("Texture %u: None", i);
+                    continue;
+                }
+
+#if RIO_IS_WIN
+                ImGui::Text("Texture %u: %ux%u, format 0x%X, tile mode %u", i, texture.surface.width, texture.surface.height, u32(texture.surface.format), u32(texture.surface.tileMode));
+#endif // RIO_IS_WIN
+
+                // Placeholder until the texture is decoded and uploaded
+                const rio::Texture2D* preview = mTextureStreamer.get(texture);
+                if (preview)
+                {
+                    const f32 size = 96.0f;
+                    const f32 aspect = f32(preview->getWidth()) / std::max<u32>(1, preview->getHeight());
+                    ImGui::Image((void*)(preview->getNativeTextureHandle()), { aspect >= 1.0f ? size : size * aspect, aspect >= 1.0f ? size / aspect : size });
+                }
             }
 
             switch (emitter->type)
             {
                 case nw::eft::EFT_EMITTER_TYPE_SIMPLE:
                 {
-                    const nw::eft::SimpleEmitterData* simple_emitter = static_cast<const nw::eft::SimpleEmitterData*>(emitter);
-
-                    ImGui::Text("isPolygon: %1u", simple_emitter->isPolygon);
-                    ImGui::Text("isFollowAll: %1u", simple_emitter->isFollowAll);
-                    ImGui::Text("isEmitterBillboardMtx: %1u", simple_emitter->isEmitterBillboardMtx);
-                    ImGui::Text("isWorldGravity: %1u", simple_emitter->isWorldGravity);
-                    ImGui::Text("isDirectional: %1u", simple_emitter->isDirectional);
-                    ImGui::Text("isStopEmitInFade: %1u", simple_emitter->isStopEmitInFade);
-                    ImGui::Text("volumeTblIndex: %u", simple_emitter->volumeTblIndex);
-                    ImGui::Text("volumeSweepStartRandom: %u", simple_emitter->volumeSweepStartRandom);
-                    ImGui::Text("isDisplayParent: %1u", simple_emitter->isDisplayParent);
-                    ImGui::Text("emitDistEnabled: %1u", simple_emitter->emitDistEnabled);
-                    ImGui::Text("isVolumeLatitudeEnabled: %1u", simple_emitter->isVolumeLatitudeEnabled);
-                    ImGui::Text("ptclRotType: %u", simple_emitter->ptclRotType);
-                    ImGui::Text("ptclFollowType: %u", simple_emitter->ptclFollowType);
-                    ImGui::Text("colorCombinerType: %u", simple_emitter->colorCombinerType);
-                    ImGui::Text("alphaCombinerType: %u", simple_emitter->alphaCombinerType);
-                    ImGui::Text("drawPath: %d", simple_emitter->drawPath);
-                    ImGui::Text("displaySide: %u", simple_emitter->displaySide);
-                    ImGui::Text("dynamicsRandom: %f", simple_emitter->dynamicsRandom);
+                    nw::eft::SimpleEmitterData* simple_emitter = static_cast<nw::eft::SimpleEmitterData*>(emitter);
+
+                    EditFlag(edit, "isPolygon", &simple_emitter->isPolygon, LiveEdit::DERIVED_CREATE);
+                    EditFlag(edit, "isFollowAll", &simple_emitter->isFollowAll, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "isEmitterBillboardMtx", &simple_emitter->isEmitterBillboardMtx, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "isWorldGravity", &simple_emitter->isWorldGravity, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "isDirectional", &simple_emitter->isDirectional, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "isStopEmitInFade", &simple_emitter->isStopEmitInFade, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeTblIndex", &simple_emitter->volumeTblIndex, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeSweepStartRandom", &simple_emitter->volumeSweepStartRandom, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "isDisplayParent", &simple_emitter->isDisplayParent, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "emitDistEnabled", &simple_emitter->emitDistEnabled, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "isVolumeLatitudeEnabled", &simple_emitter->isVolumeLatitudeEnabled, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "ptclRotType", &simple_emitter->ptclRotType, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "ptclFollowType", &simple_emitter->ptclFollowType, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "colorCombinerType", &simple_emitter->colorCombinerType, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "alphaCombinerType", &simple_emitter->alphaCombinerType, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "drawPath", &simple_emitter->drawPath, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "displaySide", &simple_emitter->displaySide, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "dynamicsRandom", &simple_emitter->dynamicsRandom, LiveEdit::DERIVED_NONE);
                     ImGui::Text("transformSRT: %f, %f, %f", simple_emitter->transformSRT.m[0][0], simple_emitter->transformSRT.m[0][1], simple_emitter->transformSRT.m[0][2]);
                     ImGui::Text("transformSRT: %f, %f, %f", simple_emitter->transformSRT.m[1][0], simple_emitter->transformSRT.m[1][1], simple_emitter->transformSRT.m[1][2]);
                     ImGui::Text("transformSRT: %f, %f, %f", simple_emitter->transformSRT.m[2][0], simple_emitter->transformSRT.m[2][1], simple_emitter->transformSRT.m[2][2]);
@@ -337,118 +785,122 @@ void Editor::drawUiEmitterEdit_()
                     ImGui::Text("trans: %f, %f, %f", simple_emitter->trans.x, simple_emitter->trans.y, simple_emitter->trans.z);
                     ImGui::Text("rotRnd: %f, %f, %f", simple_emitter->rotRnd.x, simple_emitter->rotRnd.y, simple_emitter->rotRnd.z);
                     ImGui::Text("transRnd: %f, %f, %f", simple_emitter->transRnd.x, simple_emitter->transRnd.y, simple_emitter->transRnd.z);
-                    ImGui::Text("blendType: %u", simple_emitter->blendType);
-                    ImGui::Text("zBufATestType: %u", simple_emitter->zBufATestType);
-                    ImGui::Text("volumeType: %u", simple_emitter->volumeType);
-                    ImGui::Text("volumeRadius: %f, %f, %f", simple_emitter->volumeRadius.x, simple_emitter->volumeRadius.y, simple_emitter->volumeRadius.z);
-                    ImGui::Text("volumeSweepStart: %d", simple_emitter->volumeSweepStart);
-                    ImGui::Text("volumeSweepParam: %u", simple_emitter->volumeSweepParam);
-                    ImGui::Text("volumeCaliber: %f", simple_emitter->volumeCaliber);
-                    ImGui::Text("volumeLatitude: %f", simple_emitter->volumeLatitude);
-                    ImGui::Text("volumeLatitudeDir: %f, %f, %f", simple_emitter->volumeLatitudeDir.x, simple_emitter->volumeLatitudeDir.y, simple_emitter->volumeLatitudeDir.z);
-                    ImGui::Text("lineCenter: %f", simple_emitter->lineCenter);
-                    ImGui::Text("formScale: %f, %f, %f", simple_emitter->formScale.x, simple_emitter->formScale.y, simple_emitter->formScale.z);
-                    ImGui::Text("color0: %f, %f, %f, %f", simple_emitter->color0.r, simple_emitter->color0.g, simple_emitter->color0.b, simple_emitter->color0.a);
-                    ImGui::Text("color1: %f, %f, %f, %f", simple_emitter->color1.r, simple_emitter->color1.g, simple_emitter->color1.b, simple_emitter->color1.a);
-                    ImGui::Text("alpha: %f", simple_emitter->alpha);
-                    ImGui::Text("emitDistUnit: %f", simple_emitter->emitDistUnit);
-                    ImGui::Text("emitDistMax: %f", simple_emitter->emitDistMax);
-                    ImGui::Text("emitDistMin: %f", simple_emitter->emitDistMin);
-                    ImGui::Text("emitDistMargin: %f", simple_emitter->emitDistMargin);
-                    ImGui::Text("emitRate: %f", simple_emitter->emitRate);
-                    ImGui::Text("startFrame: %d", simple_emitter->startFrame);
-                    ImGui::Text("endFrame: %d", simple_emitter->endFrame);
-                    ImGui::Text("lifeStep: %d", simple_emitter->lifeStep);
-                    ImGui::Text("lifeStepRnd: %d", simple_emitter->lifeStepRnd);
-                    ImGui::Text("figureVel: %f", simple_emitter->figureVel);
-                    ImGui::Text("emitterVel: %f", simple_emitter->emitterVel);
-                    ImGui::Text("initVelRnd: %f", simple_emitter->initVelRnd);
-                    ImGui::Text("emitterVelDir: %f, %f, %f", simple_emitter->emitterVelDir.x, simple_emitter->emitterVelDir.y, simple_emitter->emitterVelDir.z);
-                    ImGui::Text("emitterVelDirAngle: %f", simple_emitter->emitterVelDirAngle);
-                    ImGui::Text("spreadVec: %f, %f, %f", simple_emitter->spreadVec.x, simple_emitter->spreadVec.y, simple_emitter->spreadVec.z);
-                    ImGui::Text("airRegist: %f", simple_emitter->airRegist);
-                    ImGui::Text("gravity: %f, %f, %f", simple_emitter->gravity.x, simple_emitter->gravity.y, simple_emitter->gravity.z);
-                    ImGui::Text("xzDiffusionVel: %f", simple_emitter->xzDiffusionVel);
-                    ImGui::Text("initPosRand: %f", simple_emitter->initPosRand);
-                    ImGui::Text("ptclLife: %d", simple_emitter->ptclLife);
-                    ImGui::Text("ptclLifeRnd: %d", simple_emitter->ptclLifeRnd);
-                    ImGui::Text("meshType: %u", simple_emitter->meshType);
-                    ImGui::Text("billboardType: %u", simple_emitter->billboardType);
-                    ImGui::Text("rotBasis: %f, %f", simple_emitter->rotBasis.x, simple_emitter->rotBasis.y);
-                    ImGui::Text("toCameraOffset: %f", simple_emitter->toCameraOffset);
+                    EditScalar(edit, "blendType", &simple_emitter->blendType, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "zBufATestType", &simple_emitter->zBufATestType, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeType", &simple_emitter->volumeType, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "volumeRadius", &simple_emitter->volumeRadius, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeSweepStart", &simple_emitter->volumeSweepStart, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeSweepParam", &simple_emitter->volumeSweepParam, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeCaliber", &simple_emitter->volumeCaliber, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "volumeLatitude", &simple_emitter->volumeLatitude, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "volumeLatitudeDir", &simple_emitter->volumeLatitudeDir, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "lineCenter", &simple_emitter->lineCenter, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "formScale", &simple_emitter->formScale, LiveEdit::DERIVED_NONE);
+                    EditColor(edit, "color0", &simple_emitter->color0, LiveEdit::DERIVED_UPDATE);
+                    EditColor(edit, "color1", &simple_emitter->color1, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "alpha", &simple_emitter->alpha, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "emitDistUnit", &simple_emitter->emitDistUnit, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "emitDistMax", &simple_emitter->emitDistMax, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "emitDistMin", &simple_emitter->emitDistMin, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "emitDistMargin", &simple_emitter->emitDistMargin, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "emitRate", &simple_emitter->emitRate, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "startFrame", &simple_emitter->startFrame, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "endFrame", &simple_emitter->endFrame, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "lifeStep", &simple_emitter->lifeStep, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "lifeStepRnd", &simple_emitter->lifeStepRnd, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "figureVel", &simple_emitter->figureVel, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "emitterVel", &simple_emitter->emitterVel, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "initVelRnd", &simple_emitter->initVelRnd, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "emitterVelDir", &simple_emitter->emitterVelDir, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "emitterVelDirAngle", &simple_emitter->emitterVelDirAngle, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "spreadVec", &simple_emitter->spreadVec, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "airRegist", &simple_emitter->airRegist, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "gravity", &simple_emitter->gravity, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "xzDiffusionVel", &simple_emitter->xzDiffusionVel, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "initPosRand", &simple_emitter->initPosRand, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "ptclLife", &simple_emitter->ptclLife, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "ptclLifeRnd", &simple_emitter->ptclLifeRnd, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "meshType", &simple_emitter->meshType, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "billboardType", &simple_emitter->billboardType, LiveEdit::DERIVED_CREATE);
+                    EditVec2(edit, "rotBasis", &simple_emitter->rotBasis, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "toCameraOffset", &simple_emitter->toCameraOffset, LiveEdit::DERIVED_UPDATE);
                     for (u32 i = 0; i < nw::eft::EFT_TEXTURE_SLOT_BIN_MAX; i++)
                     {
-                        const nw::eft::TextureEmitterData& texture_data = simple_emitter->textureData[i];
-
-                        ImGui::Text("isTexPatAnim: %1u", texture_data.isTexPatAnim);
-                        ImGui::Text("isTexPatAnimRand: %1u", texture_data.isTexPatAnimRand);
-                        ImGui::Text("isTexPatAnimClump: %1u", texture_data.isTexPatAnimClump);
-                        ImGui::Text("numTexDivX: %u", texture_data.numTexDivX);
-                        ImGui::Text("numTexDivY: %u", texture_data.numTexDivY);
-                        ImGui::Text("numTexPat: %u", texture_data.numTexPat);
-                        ImGui::Text("texPatFreq: %d", texture_data.texPatFreq);
-                        ImGui::Text("texPatTblUse: %d", texture_data.texPatTblUse);
+                        nw::eft::TextureEmitterData& texture_data = simple_emitter->textureData[i];
+
+                        ImGui::PushID(i);
+
+                        EditFlag(edit, "isTexPatAnim", &texture_data.isTexPatAnim, LiveEdit::DERIVED_UPDATE);
+                        EditFlag(edit, "isTexPatAnimRand", &texture_data.isTexPatAnimRand, LiveEdit::DERIVED_UPDATE);
+                        EditFlag(edit, "isTexPatAnimClump", &texture_data.isTexPatAnimClump, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "numTexDivX", &texture_data.numTexDivX, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "numTexDivY", &texture_data.numTexDivY, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "numTexPat", &texture_data.numTexPat, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "texPatFreq", &texture_data.texPatFreq, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "texPatTblUse", &texture_data.texPatTblUse, LiveEdit::DERIVED_UPDATE);
                         for (u32 i = 0; i < nw::eft::EFT_TEXTURE_PATTERN_NUM; i++)
                         {
-                            ImGui::Text("texPatTbl[%u]: %u", i, texture_data.texPatTbl[i]);
+                            EditScalar(edit, ("texPatTbl[" + std::to_string(i) + "]").c_str(), &texture_data.texPatTbl[i], LiveEdit::DERIVED_UPDATE);
                         }
-                        ImGui::Text("texAddressingMode: %u", texture_data.texAddressingMode);
-                        ImGui::Text("texUScale: %f", texture_data.texUScale);
-                        ImGui::Text("texVScale: %f", texture_data.texVScale);
-                        ImGui::Text("uvShiftAnimMode: %u", texture_data.uvShiftAnimMode);
-                        ImGui::Text("uvScroll: %f, %f", texture_data.uvScroll.x, texture_data.uvScroll.y);
-                        ImGui::Text("uvScrollInit: %f, %f", texture_data.uvScrollInit.x, texture_data.uvScrollInit.y);
-                        ImGui::Text("uvScrollInitRand: %f, %f", texture_data.uvScrollInitRand.x, texture_data.uvScrollInitRand.y);
-                        ImGui::Text("uvScale: %f, %f", texture_data.uvScale.x, texture_data.uvScale.y);
-                        ImGui::Text("uvScaleInit: %f, %f", texture_data.uvScaleInit.x, texture_data.uvScaleInit.y);
-                        ImGui::Text("uvScaleInitRand: %f, %f", texture_data.uvScaleInitRand.x, texture_data.uvScaleInitRand.y);
-                        ImGui::Text("uvRot: %f", texture_data.uvRot);
-                        ImGui::Text("uvRotInit: %f", texture_data.uvRotInit);
-                        ImGui::Text("uvRotInitRand: %f", texture_data.uvRotInitRand);
+                        EditScalar(edit, "texAddressingMode", &texture_data.texAddressingMode, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "texUScale", &texture_data.texUScale, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "texVScale", &texture_data.texVScale, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "uvShiftAnimMode", &texture_data.uvShiftAnimMode, LiveEdit::DERIVED_UPDATE);
+                        EditVec2(edit, "uvScroll", &texture_data.uvScroll, LiveEdit::DERIVED_UPDATE);
+                        EditVec2(edit, "uvScrollInit", &texture_data.uvScrollInit, LiveEdit::DERIVED_UPDATE);
+                        EditVec2(edit, "uvScrollInitRand", &texture_data.uvScrollInitRand, LiveEdit::DERIVED_UPDATE);
+                        EditVec2(edit, "uvScale", &texture_data.uvScale, LiveEdit::DERIVED_UPDATE);
+                        EditVec2(edit, "uvScaleInit", &texture_data.uvScaleInit, LiveEdit::DERIVED_UPDATE);
+                        EditVec2(edit, "uvScaleInitRand", &texture_data.uvScaleInitRand, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "uvRot", &texture_data.uvRot, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "uvRotInit", &texture_data.uvRotInit, LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, "uvRotInitRand", &texture_data.uvRotInitRand, LiveEdit::DERIVED_UPDATE);
+
+                        ImGui::PopID();
                     }
                     for (u32 i = 0; i < nw::eft::EFT_COLOR_KIND_MAX; i++)
                     {
-                        ImGui::Text("colorCalcType[%u]: %u", i, simple_emitter->colorCalcType[i]);
-                        ImGui::Text("color[%u][0]: %f, %f, %f, %f", i, simple_emitter->color[i][0].r, simple_emitter->color[i][0].g, simple_emitter->color[i][0].b, simple_emitter->color[i][0].a);
-                        ImGui::Text("color[%u][1]: %f, %f, %f, %f", i, simple_emitter->color[i][1].r, simple_emitter->color[i][1].g, simple_emitter->color[i][1].b, simple_emitter->color[i][1].a);
-                        ImGui::Text("color[%u][2]: %f, %f, %f, %f", i, simple_emitter->color[i][2].r, simple_emitter->color[i][2].g, simple_emitter->color[i][2].b, simple_emitter->color[i][2].a);
-                        ImGui::Text("colorSection1[%u]: %d", i, simple_emitter->colorSection1[i]);
-                        ImGui::Text("colorSection2[%u]: %d", i, simple_emitter->colorSection2[i]);
-                        ImGui::Text("colorSection3[%u]: %d", i, simple_emitter->colorSection3[i]);
-                        ImGui::Text("colorNumRepeat[%u]: %d", i, simple_emitter->colorNumRepeat[i]);
-                        ImGui::Text("colorRepeatStartRand[%u]: %d", i, simple_emitter->colorRepeatStartRand[i]);
+                        EditScalar(edit, ("colorCalcType[" + std::to_string(i) + "]").c_str(), &simple_emitter->colorCalcType[i], LiveEdit::DERIVED_UPDATE);
+                        EditColor(edit, ("color[" + std::to_string(i) + "][0]").c_str(), &simple_emitter->color[i][0], LiveEdit::DERIVED_UPDATE);
+                        EditColor(edit, ("color[" + std::to_string(i) + "][1]").c_str(), &simple_emitter->color[i][1], LiveEdit::DERIVED_UPDATE);
+                        EditColor(edit, ("color[" + std::to_string(i) + "][2]").c_str(), &simple_emitter->color[i][2], LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, ("colorSection1[" + std::to_string(i) + "]").c_str(), &simple_emitter->colorSection1[i], LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, ("colorSection2[" + std::to_string(i) + "]").c_str(), &simple_emitter->colorSection2[i], LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, ("colorSection3[" + std::to_string(i) + "]").c_str(), &simple_emitter->colorSection3[i], LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, ("colorNumRepeat[" + std::to_string(i) + "]").c_str(), &simple_emitter->colorNumRepeat[i], LiveEdit::DERIVED_UPDATE);
+                        EditScalar(edit, ("colorRepeatStartRand[" + std::to_string(i) + "]").c_str(), &simple_emitter->colorRepeatStartRand[i], LiveEdit::DERIVED_UPDATE);
                     }
-                    ImGui::Text("colorScale: %f", simple_emitter->colorScale);
-                    ImGui::Text("initAlpha: %f", simple_emitter->initAlpha);
-                    ImGui::Text("diffAlpha21: %f", simple_emitter->diffAlpha21);
-                    ImGui::Text("diffAlpha32: %f", simple_emitter->diffAlpha32);
-                    ImGui::Text("alphaSection1: %d", simple_emitter->alphaSection1);
-                    ImGui::Text("alphaSection2: %d", simple_emitter->alphaSection2);
-                    ImGui::Text("texture1ColorBlend: %u", simple_emitter->texture1ColorBlend);
-                    ImGui::Text("primitiveColorBlend: %u", simple_emitter->primitiveColorBlend);
-                    ImGui::Text("texture1AlphaBlend: %u", simple_emitter->texture1AlphaBlend);
-                    ImGui::Text("primitiveAlphaBlend: %u", simple_emitter->primitiveAlphaBlend);
-                    ImGui::Text("scaleSection1: %d", simple_emitter->scaleSection1);
-                    ImGui::Text("scaleSection2: %d", simple_emitter->scaleSection2);
-                    ImGui::Text("scaleRand: %f", simple_emitter->scaleRand);
-                    ImGui::Text("baseScale: %f, %f", simple_emitter->baseScale.x, simple_emitter->baseScale.y);
-                    ImGui::Text("initScale: %f, %f", simple_emitter->initScale.x, simple_emitter->initScale.y);
-                    ImGui::Text("diffScale21: %f, %f", simple_emitter->diffScale21.x, simple_emitter->diffScale21.y);
-                    ImGui::Text("diffScale32: %f, %f", simple_emitter->diffScale32.x, simple_emitter->diffScale32.y);
-                    ImGui::Text("initRot: %f, %f, %f", simple_emitter->initRot.x, simple_emitter->initRot.y, simple_emitter->initRot.z);
-                    ImGui::Text("initRotRand: %f, %f, %f", simple_emitter->initRotRand.x, simple_emitter->initRotRand.y, simple_emitter->initRotRand.z);
-                    ImGui::Text("rotVel: %f, %f, %f", simple_emitter->rotVel.x, simple_emitter->rotVel.y, simple_emitter->rotVel.z);
-                    ImGui::Text("rotVelRand: %f, %f, %f", simple_emitter->rotVelRand.x, simple_emitter->rotVelRand.y, simple_emitter->rotVelRand.z);
-                    ImGui::Text("rotRegist: %f", simple_emitter->rotRegist);
-                    ImGui::Text("alphaAddInFade: %f", simple_emitter->alphaAddInFade);
-                    ImGui::Text("shaderType: %1u", simple_emitter->shaderType);
-                    ImGui::Text("userShaderSetting: %1u", simple_emitter->userShaderSetting);
-                    ImGui::Text("shaderUseSoftEdge: %1u", simple_emitter->shaderUseSoftEdge);
-                    ImGui::Text("shaderApplyAlphaToRefract: %1u", simple_emitter->shaderApplyAlphaToRefract);
-                    ImGui::Text("shaderParam0: %f", simple_emitter->shaderParam0);
-                    ImGui::Text("shaderParam1: %f", simple_emitter->shaderParam1);
-                    ImGui::Text("softFadeDistance: %f", simple_emitter->softFadeDistance);
-                    ImGui::Text("softVolumeParam: %f", simple_emitter->softVolumeParam);
+                    EditScalar(edit, "colorScale", &simple_emitter->colorScale, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "initAlpha", &simple_emitter->initAlpha, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "diffAlpha21", &simple_emitter->diffAlpha21, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "diffAlpha32", &simple_emitter->diffAlpha32, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "alphaSection1", &simple_emitter->alphaSection1, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "alphaSection2", &simple_emitter->alphaSection2, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "texture1ColorBlend", &simple_emitter->texture1ColorBlend, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "primitiveColorBlend", &simple_emitter->primitiveColorBlend, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "texture1AlphaBlend", &simple_emitter->texture1AlphaBlend, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "primitiveAlphaBlend", &simple_emitter->primitiveAlphaBlend, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "scaleSection1", &simple_emitter->scaleSection1, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "scaleSection2", &simple_emitter->scaleSection2, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "scaleRand", &simple_emitter->scaleRand, LiveEdit::DERIVED_UPDATE);
+                    EditVec2(edit, "baseScale", &simple_emitter->baseScale, LiveEdit::DERIVED_UPDATE);
+                    EditVec2(edit, "initScale", &simple_emitter->initScale, LiveEdit::DERIVED_UPDATE);
+                    EditVec2(edit, "diffScale21", &simple_emitter->diffScale21, LiveEdit::DERIVED_UPDATE);
+                    EditVec2(edit, "diffScale32", &simple_emitter->diffScale32, LiveEdit::DERIVED_UPDATE);
+                    EditVec3(edit, "initRot", &simple_emitter->initRot, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "initRotRand", &simple_emitter->initRotRand, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "rotVel", &simple_emitter->rotVel, LiveEdit::DERIVED_NONE);
+                    EditVec3(edit, "rotVelRand", &simple_emitter->rotVelRand, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "rotRegist", &simple_emitter->rotRegist, LiveEdit::DERIVED_NONE);
+                    EditScalar(edit, "alphaAddInFade", &simple_emitter->alphaAddInFade, LiveEdit::DERIVED_NONE);
+                    EditFlag(edit, "shaderType", &simple_emitter->shaderType, LiveEdit::DERIVED_CREATE);
+                    EditFlag(edit, "userShaderSetting", &simple_emitter->userShaderSetting, LiveEdit::DERIVED_CREATE);
+                    EditFlag(edit, "shaderUseSoftEdge", &simple_emitter->shaderUseSoftEdge, LiveEdit::DERIVED_CREATE);
+                    EditFlag(edit, "shaderApplyAlphaToRefract", &simple_emitter->shaderApplyAlphaToRefract, LiveEdit::DERIVED_CREATE);
+                    EditScalar(edit, "shaderParam0", &simple_emitter->shaderParam0, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "shaderParam1", &simple_emitter->shaderParam1, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "softFadeDistance", &simple_emitter->softFadeDistance, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "softVolumeParam", &simple_emitter->softVolumeParam, LiveEdit::DERIVED_UPDATE);
                     for (u32 i = 0; i < 16; i++)
                     {
                         ImGui::Text("userShaderDefine1[%u]: %1u", i, simple_emitter->userShaderDefine1[i]);
@@ -457,86 +909,901 @@ void Editor::drawUiEmitterEdit_()
                     {
                         ImGui::Text("userShaderDefine2[%u]: %1u", i, simple_emitter->userShaderDefine2[i]);
                     }
-                    ImGui::Text("userShaderFlag: %u", simple_emitter->userShaderFlag);
-                    ImGui::Text("userShaderSwitchFlag: %u", simple_emitter->userShaderSwitchFlag);
+                    EditScalar(edit, "userShaderFlag", &simple_emitter->userShaderFlag, LiveEdit::DERIVED_UPDATE);
+                    EditScalar(edit, "userShaderSwitchFlag", &simple_emitter->userShaderSwitchFlag, LiveEdit::DERIVED_UPDATE);
                     for (u32 i = 0; i < 32; i++)
                     {
-                        ImGui::Text("userShaderParam[%u]: %f", i, simple_emitter->userShaderParam.param[i]);
+                        EditScalar(edit, ("userShaderParam[" + std::to_string(i) + "]").c_str(), &simple_emitter->userShaderParam.param[i], LiveEdit::DERIVED_UPDATE);
                     }
 
                     break;
                 }
             }
 
+            ImGui::PopID();
+
+            if (edit.edited)
+                mLiveEdit.markEdited(static_cast<const nw::eft::SimpleEmitterData*>(emitter), edit.derived);
+
             ImGui::Separator();
         }
+
+        // A drag is one undo step, until the widget is let go
+        if (!ImGui::IsAnyItemActive())
+            mUndoJournal.seal();
     }
     ImGui::End();
 }
 
-void Editor::resizeView_(s32 width, s32 height)
+void Editor::drawUiProfiler_()
 {
-#if RIO_IS_CAFE
-    GX2DrawDone();
-#elif RIO_IS_WIN
-    RIO_GL_CALL(glFinish());
-#endif
+    if (ImGui::Begin("Profiler"))
+    {
+        if (ImGui::CollapsingHeader("Render Queue", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            bool sort_enabled = mRenderQueue.isSortEnabled();
+            if (ImGui::Checkbox("Sort by render state", &sort_enabled))
+                mRenderQueue.setSortEnabled(sort_enabled);
 
-    const f32 w_half = width  * 0.5f;
-    const f32 h_half = height * 0.5f;
+            const RenderQueue::Stats& stats = mRenderQueue.getStats();
+            ImGui::Text("Draw calls: %u of %u emitters", stats.draw_num, stats.emitter_num);
+            ImGui::Text("State changes: %u unsorted, %u sorted", stats.state_change_num_unsorted, stats.state_change_num_sorted);
 
-    mProjection.setTBLR(
-         h_half,    // Top
-        -h_half,    // Bottom
-        -w_half,    // Left
-         w_half     // Right
-    );
+            ImGui::Separator();
 
-    createRenderBuffer_(width, height);
-}
+            bool cull_enabled = mEmitterCuller.isEnabled();
+            if (ImGui::Checkbox("Cull emitters", &cull_enabled))
+                mEmitterCuller.setEnabled(cull_enabled);
 
-void Editor::createRenderBuffer_(s32 width, s32 height)
-{
-    if (mpColorTexture)
-    {
-        delete mpColorTexture;
-        mpColorTexture = nullptr;
-    }
+            const EmitterCuller::Stats& cull_stats = mEmitterCuller.getStats();
+            ImGui::Text("Culled: %u (empty %u, outside view %u, transparent %u)",
+                        cull_stats.culled_empty_num + cull_stats.culled_frustum_num + cull_stats.culled_alpha_num,
+                        cull_stats.culled_empty_num, cull_stats.culled_frustum_num, cull_stats.culled_alpha_num);
+        }
 
-    if (mpDepthTexture)
-    {
-        delete mpDepthTexture;
-        mpDepthTexture = nullptr;
-    }
+        if (ImGui::CollapsingHeader("Emitter GPU Time", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            if (!EmitterProfiler::isSupported())
+            {
+                ImGui::TextDisabled("Timer queries are not available on this platform");
+            }
+            else
+            {
+                bool enabled = mEmitterProfiler.isEnabled();
+                if (ImGui::Checkbox("Enabled", &enabled))
+                    mEmitterProfiler.setEnabled(enabled);
 
-    mpColorTexture = new rio::Texture2D(rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM, width, height, 1);
-    mpDepthTexture = new rio::Texture2D(rio::DEPTH_TEXTURE_FORMAT_R32_FLOAT, width, height, 1);
+                if (enabled)
+                {
+                    static const char* const cBlendTypeName[] = { "Normal", "Add", "Sub", "Screen", "Mult" };
 
-    mRenderBuffer.setSize(width, height);
-    mColorTarget.linkTexture2D(*mpColorTexture);
-    mDepthTarget.linkTexture2D(*mpDepthTexture);
-    mRenderBuffer.clear(rio::RenderBuffer::CLEAR_FLAG_DEPTH);
-}
+                    const std::vector<EmitterProfiler::Sample>& samples = mEmitterProfiler.getSamples();
+                    ImGui::Text("Total: %.1f us (%u emitters, %u frames latency)", mEmitterProfiler.getTotalTimeUs(), u32(samples.size()), EmitterProfiler::cFrameLatency);
 
-#if RIO_IS_WIN
+                    const ImGuiTableFlags table_flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+                    if (ImGui::BeginTable("EmitterGpuTime", 4, table_flags, { 0.0f, ImGui::GetTextLineHeightWithSpacing() * 16 }))
+                    {
+                        ImGui::TableSetupScrollFreeze(0, 1);
+                        ImGui::TableSetupColumn("Emitter");
+                        ImGui::TableSetupColumn("GPU (us)");
+                        ImGui::TableSetupColumn("Particles");
+                        ImGui::TableSetupColumn("Blend");
+                        ImGui::TableHeadersRow();
+
+                        for (const EmitterProfiler::Sample& sample : samples)
+                        {
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(sample.name);
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.1f", sample.gpu_time_us);
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%u", sample.particle_num);
+                            ImGui::TableNextColumn();
+                            if (sample.blend_type < IM_ARRAYSIZE(cBlendTypeName))
+                                ImGui::TextUnformatted(cBlendTypeName[sample.blend_type]);
+                            else
+                                ImGui::Text("%u", sample.blend_type);
+                        }
 
-void Editor::resize_(s32 width, s32 height)
-{
-    ImGuiUtil::setDisplaySize(width, height);
-}
+                        ImGui::EndTable();
+                    }
+                }
+            }
+        }
 
-void Editor::onResizeCallback_(s32 width, s32 height)
-{
-    static_cast<Editor*>(rio::sRootTask)->resize_(width, height);
-}
+        if (ImGui::CollapsingHeader("Frame Loop", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            bool idle_enabled = mIdleMonitor.isEnabled();
+            if (ImGui::Checkbox("Sleep when idle", &idle_enabled))
+                mIdleMonitor.setEnabled(idle_enabled);
 
-#endif // RIO_IS_WIN
+            const IdleMonitor::Stats& stats = mIdleMonitor.getStats();
+            ImGui::Text("Duty cycle: %.1f%%", stats.duty_cycle * 100.0f);
+            ImGui::Text("Frames: %.1f/s, view rendered: %.1f/s", stats.frame_rate, stats.render_rate);
+        }
 
-void Editor::prepare_()
-{
-#if RIO_IS_WIN
-    RIO_LOG("My directory is %s\n", g_CWD.c_str());
-#endif // RIO_IS_WIN
+        if (ImGui::CollapsingHeader("Resolution", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Text("View: %dx%d, rendered at %dx%d (target %dx%d)",
+                        mViewSize.x, mViewSize.y, mRenderSize.x, mRenderSize.y, mRenderTargetSize.x, mRenderTargetSize.y);
+
+            if (!DynamicResolution::isSupported())
+            {
+                ImGui::TextDisabled("Dynamic resolution is not available on this platform");
+            }
+            else
+            {
+                bool exact = !mDynamicResolution.isEnabled();
+                if (ImGui::Checkbox("Exact resolution", &exact))
+                    mDynamicResolution.setEnabled(!exact);
+
+                f32 target_time_ms = mDynamicResolution.getTargetTimeMs();
+                if (ImGui::SliderFloat("GPU budget (ms)", &target_time_ms, 1.0f, 33.0f, "%.1f"))
+                    mDynamicResolution.setTargetTimeMs(target_time_ms);
+
+                f32 min_scale = mDynamicResolution.getMinScale();
+                if (ImGui::SliderFloat("Minimum scale", &min_scale, 0.25f, 1.0f, "%.2f"))
+                    mDynamicResolution.setMinScale(min_scale);
+
+                const DynamicResolution::Stats& stats = mDynamicResolution.getStats();
+                ImGui::Text("View GPU time: %.2f ms", stats.gpu_time_ms);
+                ImGui::Text("Scale: %.0f%%", mDynamicResolution.getScale() * 100.0f);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Editor Geometry Streaming", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            // Eft uploads particle and stripe attributes itself, they are not counted here
+            const StreamBuffer::Stats& stats = mStreamBuffer.getStats();
+            ImGui::Text("Mode: %s", stats.persistent ? "Persistently mapped" : "Staging copy");
+            ImGui::Text("Written: %u bytes/frame", stats.bytes_written);
+            ImGui::Text("Uploaded by copy: %u bytes/frame", stats.bytes_uploaded);
+            ImGui::Text("Upload CPU time: %.1f us/frame", stats.upload_time_us);
+            ImGui::Text("GPU stalls: %u", stats.stall_num);
+
+            if (mGeometryCache.isInitialized())
+            {
+                const GeometryCache::Stats& geometry_stats = mGeometryCache.getStats();
+                ImGui::Text("Retained meshes: %u", geometry_stats.mesh_num);
+                ImGui::Text("Instances: %u in %u draws (last batch)", geometry_stats.instance_num, geometry_stats.draw_num);
+
+                if (mEmitterGizmo.isEnabled())
+                {
+                    const EmitterGizmo::Stats& gizmo_stats = mEmitterGizmo.getStats();
+                    ImGui::Text("Volume gizmos: %u emitters, %u instances", gizmo_stats.emitter_num, gizmo_stats.instance_num);
+                }
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Textures", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            if (!TextureStreamer::isSupported())
+            {
+                ImGui::TextDisabled("Texture previews are not available on this platform");
+            }
+            else
+            {
+                const TextureStreamer::Stats stats = mTextureStreamer.getStats();
+                ImGui::Text("Ready: %u, pending: %u, failed: %u", stats.ready_num, stats.pending_num, stats.failed_num);
+                ImGui::Text("Uploaded: %.2f MB", stats.uploaded_bytes / (1024.0f * 1024.0f));
+                ImGui::Text("Kept compressed: %u", stats.compressed_num);
+                ImGui::Text("Texture memory: %.2f MB, %.2f MB saved over RGBA8",
+                            stats.texture_bytes / (1024.0f * 1024.0f), (stats.rgba8_bytes - stats.texture_bytes) / (1024.0f * 1024.0f));
+                ImGui::Text("Decode time: %.1f ms (workers)", stats.decode_ms);
+
+                if (ImGui::Button("Benchmark decoding"))
+                    mTextureStreamer.runBenchmark();
+
+                if (mBakedCache.isOpen())
+                    ImGui::Text("Baked cache: %u textures, %.2f MB mapped, %u uploaded from it",
+                                mBakedCache.getTextureNum(), mBakedCache.getFileSize() / (1024.0f * 1024.0f), stats.baked_num);
+                else
+                    ImGui::Text("Baked cache: %s", mTextureStreamer.isBaking() ? "baking for the next launch" : "none");
+
+                const Gx2DecodeBenchmark& benchmark = mTextureStreamer.getBenchmark();
+                if (benchmark.surface_num > 0)
+                {
+                    ImGui::Text("%s, %u surfaces, %.2f MP", GetSimdLevelName(), benchmark.surface_num, benchmark.texel_num / 1000000.0f);
+                    ImGui::Text("Detile: %.0f MP/s (scalar %.0f MP/s)",
+                                GetGx2BenchmarkRate(benchmark.texel_num, benchmark.detile_simd_ns),
+                                GetGx2BenchmarkRate(benchmark.texel_num, benchmark.detile_scalar_ns));
+                    ImGui::Text("Convert: %.0f MP/s (scalar %.0f MP/s)",
+                                GetGx2BenchmarkRate(benchmark.texel_num, benchmark.convert_simd_ns),
+                                GetGx2BenchmarkRate(benchmark.texel_num, benchmark.convert_scalar_ns));
+                    if (benchmark.mismatch_num > 0)
+                        ImGui::Text("Mismatches: %u surfaces differ from the scalar reference", benchmark.mismatch_num);
+                }
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Resource", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Text("Eset_Cafe.ptcl: %.2f MB", mPtclFileSize / (1024.0f * 1024.0f));
+
+            if (!PtclWriter::isSupported())
+            {
+                ImGui::TextDisabled("Saving is not available on this platform");
+            }
+            else if (!mPtclWriter.isTracking())
+            {
+                ImGui::TextDisabled("Saving is disabled, the emitter records were not found in the file");
+            }
+            else
+            {
+                if (ImGui::Button("Save"))
+                    savePtcl_();
+
+                const UndoJournal::Stats undo_stats = mUndoJournal.getStats();
+                ImGui::Text("Undo history: %u steps, %u to redo, %u entries, %.1f KB (%u coalesced, %u dropped)",
+                            undo_stats.undo_num, undo_stats.redo_num, undo_stats.entry_num, undo_stats.byte_num / 1024.0f,
+                            undo_stats.coalesced_num, undo_stats.dropped_num);
+                if (undo_stats.bulk_page_num > 0)
+                    ImGui::Text("Last bulk edit: %u pages copied", undo_stats.bulk_page_num);
+
+                const LiveEdit::Stats& live_stats = mLiveEdit.getStats();
+                ImGui::Text("Live edits: %u, %u emitter updates, %u set recreations",
+                            live_stats.edit_num, live_stats.instance_update_num, live_stats.recreate_num);
+
+                const PtclWriter::Stats& stats = mPtclWriter.getStats();
+                ImGui::Text("Writable: %u emitters, %u fields each", stats.record_num, stats.field_num);
+                if (stats.save_ns > 0)
+                {
+                    static const char* const cResultNames[] = { "unchanged", "written", "FAILED", "conflict" };
+                    ImGui::Text("Last save: %s, %u fields, %u bytes, %.2f ms", cResultNames[stats.result],
+                                stats.patched_field_num, stats.patched_byte_num, stats.save_ns / 1000000.0f);
+                }
+
+                if (mSaveConflict)
+                {
+                    ImGui::TextWrapped("Eset_Cafe.ptcl changed on disk since it was read, nothing was saved");
+
+                    if (ImGui::Button("Reload from disk"))
+                        reloadPtcl_();
+
+                    ImGui::SameLine();
+                    if (ImGui::Button("Overwrite"))
+                        mSaveConflict = mPtclWriter.saveAs(mPtclWriter.getPath()) == PtclWriter::RESULT_FAILED;
+                }
+
+                // Works on the file as saved, unsaved edits are not included
+                if (ImGui::Button("Write optimized copy"))
+                    optimizePtcl_();
+
+                if (!mOptimizeError.empty())
+                {
+                    ImGui::TextWrapped("Optimizing failed: %s", mOptimizeError.c_str());
+                }
+                else if (mOptimizeDone)
+                {
+                    const PtclOptimizeReport::Saving& texture = mOptimizeReport.saving[PtclOptimizeReport::CATEGORY_TEXTURE];
+                    ImGui::TextWrapped("%s: %.2f MB -> %.2f MB", mOptimizeReport.path[1].c_str(),
+                                       mOptimizeReport.size[0] / (1024.0f * 1024.0f), mOptimizeReport.size[1] / (1024.0f * 1024.0f));
+                    ImGui::Text("Textures: %u duplicates (%.1f KB), %.1f KB unused, %.1f KB saved", texture.duplicate_num,
+                                texture.duplicate_byte_num / 1024.0f, texture.unused_byte_num / 1024.0f, texture.saved_byte_num / 1024.0f);
+
+                    // Reported only, the tables are copied unchanged
+                    const PtclOptimizeReport::Saving& shader = mOptimizeReport.saving[PtclOptimizeReport::CATEGORY_SHADER];
+                    const PtclOptimizeReport::Saving& primitive = mOptimizeReport.saving[PtclOptimizeReport::CATEGORY_PRIMITIVE];
+                    ImGui::Text("Shaders: %u unreferenced, %u duplicates (%.1f KB), %.1f KB unused, copied unchanged", shader.unreferenced_num,
+                                shader.duplicate_num, shader.duplicate_byte_num / 1024.0f, shader.unused_byte_num / 1024.0f);
+                    ImGui::Text("Primitives: %u unreferenced, %u duplicates (%.1f KB), %.1f KB unused, copied unchanged", primitive.unreferenced_num,
+                                primitive.duplicate_num, primitive.duplicate_byte_num / 1024.0f, primitive.unused_byte_num / 1024.0f);
+                }
+            }
+
+            if (!FileWatcher::isSupported())
+            {
+                ImGui::TextDisabled("Hot reload is not available on this platform");
+            }
+            else if (mFileWatcher.isWatching())
+            {
+                ImGui::Text("Hot reload: watching, %u file events", mFileWatcher.getEventNum());
+                if (mReloadStats.reload_num > 0)
+                {
+                    if (mReloadStats.structural)
+                        ImGui::Text("Last reload: structure changed, resource re-entered in %.2f ms", mReloadStats.reload_ns / 1000000.0f);
+                    else
+                        ImGui::Text("Last reload: %u fields in %u sets, %.2f ms", mReloadStats.field_num, mReloadStats.changed_set_num,
+                                    mReloadStats.reload_ns / 1000000.0f);
+                }
+            }
+
+            // Through the writer's plan, which only exists while tracking
+            if (mPtclWriter.isTracking() && ImGui::Button("Benchmark endian swap"))
+                benchmarkEndianSwap_();
+
+            if (mEndianSwapBenchmark.byte_num > 0)
+            {
+                ImGui::Text("%s: %.0f MB/s (scalar %.0f MB/s), %u spans", GetSimdLevelName(),
+                            GetEndianSwapRate(mEndianSwapBenchmark.byte_num, mEndianSwapBenchmark.simd_ns),
+                            GetEndianSwapRate(mEndianSwapBenchmark.byte_num, mEndianSwapBenchmark.scalar_ns),
+                            mEndianSwapBenchmark.span_num);
+                ImGui::Text("Matches scalar: %s, idempotent: %s",
+                            mEndianSwapBenchmark.matched ? "yes" : "no", mEndianSwapBenchmark.idempotent ? "yes" : "no");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Overdraw", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            if (!OverdrawView::isSupported())
+            {
+                ImGui::TextDisabled("Overdraw view is not available on this platform");
+            }
+            else
+            {
+                bool enabled = mOverdrawView.isEnabled();
+                if (ImGui::Checkbox("Heatmap View", &enabled))
+                    mOverdrawView.setEnabled(enabled);
+
+                if (enabled)
+                {
+                    const OverdrawView::Stats& stats = mOverdrawView.getStats();
+
+                    ImGui::Text("Resolution: %ux%u", stats.width, stats.height);
+                    ImGui::Text("Total overdraw: %.2fx", stats.total_overdraw);
+                    ImGui::Text("Average overdraw (covered pixels): %.2fx", stats.average_overdraw);
+                    ImGui::Text("Max overdraw: %u", stats.max_overdraw);
+                    ImGui::Text("Covered: %.1f%%", stats.covered_ratio * 100.0f);
+                    if (stats.worst_emitter_name)
+                        ImGui::Text("Worst emitter: %s (%llu fragments)", stats.worst_emitter_name, (unsigned long long)stats.worst_emitter_fragments);
+
+                    const u32 pixel_num = std::max<u32>(1, stats.width * stats.height);
+                    for (u32 level = 1; level <= OverdrawView::cLevelNum; level++)
+                    {
+                        f32 color[4];
+                        OverdrawView::getLevelColor(level, color);
+
+                        ImGui::ColorButton(("##OverdrawLevel" + std::to_string(level)).c_str(), { color[0], color[1], color[2], color[3] }, ImGuiColorEditFlags_NoTooltip, { ImGui::GetTextLineHeight(), ImGui::GetTextLineHeight() });
+                        ImGui::SameLine();
+                        ImGui::Text("%s%u: %.1f%%", level < OverdrawView::cLevelNum ? "" : ">=", level, stats.histogram[level] * 100.0f / pixel_num);
+                    }
+                }
+            }
+        }
+    }
+    ImGui::End();
+}
+
+void Editor::drawUiCapture_()
+{
+    if (ImGui::Begin("Capture"))
+    {
+        if (!FrameCapture::isSupported())
+        {
+            ImGui::TextDisabled("Frame capture is not available on this platform");
+        }
+        else if (mRegressionRunner.isRunning())
+        {
+            ImGui::TextDisabled("In use by the regression run");
+        }
+        else if (mFrameCapture.isCapturing())
+        {
+            const FrameCapture::Settings& settings = mFrameCapture.getSettings();
+            const FrameCapture::Stats stats = mFrameCapture.getStats();
+
+            if (settings.frame_num != 0)
+                ImGui::ProgressBar(f32(stats.written_num) / settings.frame_num);
+
+            ImGui::Text("Captured: %u, written: %u, failed: %u", stats.captured_num, stats.written_num, stats.failed_num);
+            ImGui::Text("Readback stalls: %u, encoder stalls: %u", stats.readback_stall_num, stats.encode_stall_num);
+
+            if (ImGui::Button("Stop"))
+                mFrameCapture.stop();
+        }
+        else
+        {
+            ImGui::InputInt("Width", &mCaptureSettings.width);
+            ImGui::InputInt("Height", &mCaptureSettings.height);
+            mCaptureSettings.width = std::clamp<s32>(mCaptureSettings.width, 16, 8192);
+            mCaptureSettings.height = std::clamp<s32>(mCaptureSettings.height, 16, 8192);
+
+            s32 frame_num = mCaptureSettings.frame_num;
+            if (ImGui::InputInt("Frames (0: until the set ends)", &frame_num))
+                mCaptureSettings.frame_num = std::max<s32>(0, frame_num);
+
+            s32 format = mCaptureSettings.format;
+            if (ImGui::Combo("Format", &format, "PNG\0Raw RGBA8\0"))
+                mCaptureSettings.format = FrameCapture::Format(format);
+
+            char directory[512];
+            std::snprintf(directory, sizeof(directory), "%s", mCaptureSettings.directory.c_str());
+            if (ImGui::InputText("Directory", directory, sizeof(directory)))
+                mCaptureSettings.directory = directory;
+
+#if RIO_IS_WIN
+            if (mCaptureSettings.format == FrameCapture::FORMAT_PNG)
+                ImGui::Checkbox("Encode video with ffmpeg", &mCaptureSettings.encode_video);
+#endif // RIO_IS_WIN
+
+            // One pixel per world unit
+            if (ImGui::Button("Start") && startCapture_(mCaptureSettings, mCaptureSettings.width, mCaptureSettings.height))
+            {
+                // Frame 0 of the capture is the first frame of the set
+                changeEftEmitterSet_();
+            }
+        }
+    }
+    ImGui::End();
+}
+
+bool Editor::startCapture_(const FrameCapture::Settings& settings, f32 view_width, f32 view_height)
+{
+    if (!mFrameCapture.start(settings))
+        return false;
+
+    const f32 w_half = view_width  * 0.5f;
+    const f32 h_half = view_height * 0.5f;
+
+    mCaptureProjection.set(
+        -1000.0f,   // Near
+         1000.0f,   // Far
+         h_half,    // Top
+        -h_half,    // Bottom
+        -w_half,    // Left
+         w_half     // Right
+    );
+
+    return true;
+}
+
+void Editor::renderCapture_()
+{
+    EDITOR_TRACE_SCOPE("RenderCapture");
+
+    mFrameCapture.beginFrame(cViewClearColor);
+
+    rio::RenderState render_state;
+    render_state.setDepthTestEnable(false);
+    render_state.setDepthWriteEnable(false);
+    render_state.setBlendEnable(false);
+    render_state.apply();
+
+    drawEftSystem_(
+        reinterpret_cast<const nw::math::MTX44&>(mCaptureProjection.getMatrix()),
+        nw::math::MTX34::Identity(),
+        { 0.0f, 0.0f, 0.0f },
+        mCaptureProjection.getNear(),
+        mCaptureProjection.getFar(),
+        mFrameCapture.getColorTexture(),
+        mFrameCapture.getDepthTexture(),
+        0,
+        false
+    );
+
+    mFrameCapture.endFrame();
+}
+
+void Editor::drawUiRegression_()
+{
+    if (ImGui::Begin("Regression"))
+    {
+        const RegressionRunner::Summary summary = mRegressionRunner.getSummary();
+
+        if (!FrameCapture::isSupported())
+        {
+            ImGui::TextDisabled("Regression runs are not available on this platform");
+        }
+        else if (mRegressionRunner.isRunning())
+        {
+            if (summary.set_num != 0)
+                ImGui::ProgressBar(f32(summary.done_num) / summary.set_num);
+
+            if (ImGui::Button("Cancel"))
+                cancelRegression_();
+        }
+        else
+        {
+            ImGui::TextWrapped("Golden images: %s", GetRegressionSettings(false).golden_dir.c_str());
+
+            if (ImGui::Button("Run"))
+                startRegression_(false);
+
+            ImGui::SameLine();
+            if (ImGui::Button("Update golden images"))
+                startRegression_(true);
+        }
+
+        ImGui::Text("Passed: %u, failed: %u, missing: %u", summary.pass_num, summary.fail_num, summary.missing_num);
+
+        const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit;
+        if (summary.done_num != 0 && ImGui::BeginTable("RegressionResults", 5, flags))
+        {
+            static const char* const cStatusText[] = { "Pass", "Updated", "Missing", "FAIL", "Error" };
+
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Set", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Status");
+            ImGui::TableSetupColumn("Worst diff");
+            ImGui::TableSetupColumn("Calc ms/frame");
+            ImGui::TableSetupColumn("Render ms/frame");
+            ImGui::TableHeadersRow();
+
+            const std::vector<RegressionRunner::SetResult> results = mRegressionRunner.getResults();
+            for (u32 i = 0; i < summary.done_num && i < results.size(); i++)
+            {
+                const RegressionRunner::SetResult& result = results[i];
+                const u32 frame_num = std::max<u32>(result.frame_num, 1);
+
+                f32 worst_diff = 0.0f;
+                for (const RegressionRunner::FrameResult& frame : result.frame)
+                    worst_diff = std::max(worst_diff, frame.diff_ratio);
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(result.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(cStatusText[result.status]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f%%", worst_diff * 100.0f);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", result.calc_ms / frame_num);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", result.render_ms / frame_num);
+            }
+
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+void Editor::drawUiPtclDiff_()
+{
+    if (ImGui::Begin("Compare"))
+    {
+        if (!PtclWriter::isSupported())
+        {
+            ImGui::TextDisabled("Comparing is not available on this platform");
+        }
+        else if (!mPtclWriter.isTracking())
+        {
+            ImGui::TextDisabled("Comparing is disabled, the emitter records were not found in the file");
+        }
+        else
+        {
+            char path[512];
+            std::snprintf(path, sizeof(path), "%s", mDiffPath.c_str());
+            if (ImGui::InputText("PTCL", path, sizeof(path)))
+                mDiffPath = path;
+
+            // The edited image, including changes not saved yet
+            if (ImGui::Button("Compare with edited"))
+            {
+                EDITOR_TRACE_SCOPE("PtclDiff");
+
+                std::vector<u8> image;
+                mPtclWriter.getEditedImage(&image);
+
+                mDiffError.clear();
+                mDiffDone = DiffPtclFile(image.data(), image.size(), mDiffPath, &mDiffReport, &mDiffError);
+                if (mDiffDone)
+                    mDiffReport.path[0] = "(edited)";
+            }
+        }
+
+        if (!mDiffError.empty())
+        {
+            ImGui::TextWrapped("%s", mDiffError.c_str());
+        }
+        else if (mDiffDone)
+        {
+            const PtclDiffReport& report = mDiffReport;
+            ImGui::Text("Sets: %u -> %u, %u identical, %.2f ms", report.set_num[0], report.set_num[1], report.same_set_num,
+                        report.diff_ns / 1000000.0f);
+            ImGui::Text("Emitters: %u -> %u, textures: %u -> %u", report.emitter_num[0], report.emitter_num[1],
+                        report.texture_num[0], report.texture_num[1]);
+
+            if (report.isIdentical())
+                ImGui::TextUnformatted("Identical");
+            if (report.shader_table_changed)
+                ImGui::TextUnformatted("Shader table changed");
+            if (report.primitive_table_changed)
+                ImGui::TextUnformatted("Primitive table changed");
+
+            for (u32 i = 0; i < report.sets.size(); i++)
+            {
+                const PtclSetDiff& set = report.sets[i];
+                const ImGuiTreeNodeFlags set_flags = set.emitters.empty() ? ImGuiTreeNodeFlags_Leaf : 0;
+
+                ImGui::PushID(i);
+                if (ImGui::TreeNodeEx("Set", set_flags, "%s (%s)", set.name.c_str(), GetPtclDiffStatusName(set.status)))
+                {
+                    for (u32 j = 0; j < set.emitters.size(); j++)
+                    {
+                        const PtclEmitterDiff& emitter = set.emitters[j];
+
+                        ImGui::PushID(j);
+                        if (ImGui::TreeNode("Emitter", "%s (%s)", emitter.name.c_str(), GetPtclDiffStatusName(emitter.status)))
+                        {
+                            for (const std::string& field : emitter.fields)
+                                ImGui::BulletText("%s", field.c_str());
+
+                            for (u32 slot = 0; slot < cPtclTextureSlotNum; slot++)
+                            {
+                                if (!(emitter.texture_mask & (1u << slot)))
+                                    continue;
+
+                                if (slot == cPtclChildTextureSlot)
+                                    ImGui::BulletText("Child texture data");
+                                else
+                                    ImGui::BulletText("Texture %u data", slot);
+                            }
+
+                            if (emitter.other_byte_num > 0)
+                                ImGui::BulletText("%u other bytes", emitter.other_byte_num);
+
+                            ImGui::TreePop();
+                        }
+                        ImGui::PopID();
+                    }
+
+                    ImGui::TreePop();
+                }
+                ImGui::PopID();
+            }
+        }
+    }
+    ImGui::End();
+}
+
+void Editor::startRegression_(bool update_golden)
+{
+    if (mFrameCapture.isCapturing())
+        mFrameCapture.stop();
+
+    // Runs from the panel start from the state of a --regression process:
+    // no thumbnails in group 1, a fresh Eft system and the first set created
+    if (!g_CommandLine.regression)
+    {
+        mThumbnailCache.finalize();
+
+        if (!restartEftSystem_(0))
+        {
+            RIO_LOG("Regression: Eset_Cafe.ptcl could not be read or changed on disk, reload it first\n");
+            resumeThumbnailCache_();
+            return;
+        }
+    }
+
+    if (!mRegressionRunner.start(GetRegressionSettings(update_golden), "Eset_Cafe.ptcl"))
+    {
+        if (g_CommandLine.regression)
+            RequestExit(1);
+        else
+            resumeThumbnailCache_();
+    }
+}
+
+void Editor::calcRegression_()
+{
+    if (!mRegressionRunner.isRunning())
+        return;
+
+    // Each set is captured from its first frame for a fixed number of frames
+    if (mFrameCapture.isCapturing())
+    {
+        if (!mFrameCapture.isComplete())
+            return;
+
+        // Waits for the last readbacks, which hand their frames to the runner
+        mFrameCapture.stop();
+        mRegressionRunner.endSet();
+    }
+
+    u32 set_index;
+    if (!mRegressionRunner.beginSet(&set_index))
+    {
+        mRegressionRunner.finish();
+
+        if (g_CommandLine.regression)
+            RequestExit(mRegressionRunner.isPassed() ? 0 : 1);
+        else
+            resumeThumbnailCache_();
+
+        return;
+    }
+
+    const f32 extent = RegressionRunner::cViewExtent;
+    if (!startCapture_(mRegressionRunner.getCaptureSettings(), extent, extent))
+    {
+        mRegressionRunner.cancel();
+
+        if (g_CommandLine.regression)
+            RequestExit(1);
+        else
+            resumeThumbnailCache_();
+
+        return;
+    }
+
+    mCurrentEmitterSet = set_index;
+    changeEftEmitterSet_();
+}
+
+void Editor::cancelRegression_()
+{
+    // The capture's workers feed the runner, so they have to be done first
+    mFrameCapture.stop();
+    mRegressionRunner.cancel();
+
+    resumeThumbnailCache_();
+}
+
+// Thumbnails would share the view's simulation time and random sequence, so
+// regression runs go without them
+void Editor::resumeThumbnailCache_()
+{
+    if (!g_CommandLine.regression)
+        mThumbnailCache.initialize(GetThumbnailDirectory(), GetEmitterSetMtx());
+}
+
+void Editor::renderThumbnail_()
+{
+    mThumbnailCache.beginRender();
+
+    rio::RenderState render_state;
+    render_state.setDepthTestEnable(false);
+    render_state.setDepthWriteEnable(false);
+    render_state.setBlendEnable(false);
+    render_state.apply();
+
+    const rio::OrthoProjection& proj = mThumbnailCache.getProjection();
+
+    drawEftSystem_(
+        reinterpret_cast<const nw::math::MTX44&>(proj.getMatrix()),
+        nw::math::MTX34::Identity(),
+        { 0.0f, 0.0f, 0.0f },
+        proj.getNear(),
+        proj.getFar(),
+        mThumbnailCache.getRenderColorTexture(),
+        mThumbnailCache.getRenderDepthTexture(),
+        ThumbnailCache::cEftGroup,
+        false
+    );
+
+    mThumbnailCache.endRender();
+}
+
+void Editor::resizeView_(s32 width, s32 height)
+{
+    const f32 w_half = width  * 0.5f;
+    const f32 h_half = height * 0.5f;
+
+    mProjection.setTBLR(
+         h_half,    // Top
+        -h_half,    // Bottom
+        -w_half,    // Left
+         w_half     // Right
+    );
+
+    // The render targets follow in updateRenderBuffer_() once the size settles
+    mViewResizeFrame = 0;
+}
+
+s32 Editor::getRenderTargetBucketSize_(s32 size)
+{
+    return (size + cRenderTargetBucketSize - 1) / cRenderTargetBucketSize * cRenderTargetBucketSize;
+}
+
+void Editor::createRenderBuffer_(s32 width, s32 height)
+{
+    EDITOR_TRACE_SCOPE("CreateRenderBuffer");
+
+    retireRenderTarget_();
+
+    // Reuse a pooled target of the same size if the view is going back to it
+    for (auto it = mRenderTargetPool.begin(); it != mRenderTargetPool.end(); ++it)
+    {
+        if (it->width == width && it->height == height)
+        {
+            mpColorTexture = it->color;
+            mpDepthTexture = it->depth;
+            mRenderTargetPool.erase(it);
+            break;
+        }
+    }
+
+    if (!mpColorTexture)
+    {
+        mpColorTexture = new rio::Texture2D(rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM, width, height, 1);
+        mpDepthTexture = new rio::Texture2D(rio::DEPTH_TEXTURE_FORMAT_R32_FLOAT, width, height, 1);
+    }
+
+    mRenderTargetSize.x = width;
+    mRenderTargetSize.y = height;
+
+    mRenderBuffer.setSize(width, height);
+    mColorTarget.linkTexture2D(*mpColorTexture);
+    mDepthTarget.linkTexture2D(*mpDepthTexture);
+    mRenderBuffer.clear(rio::RenderBuffer::CLEAR_FLAG_DEPTH);
+}
+
+void Editor::updateRenderBuffer_()
+{
+    if (mViewResizeFrame < cViewResizeSettleFrameNum)
+        mViewResizeFrame++;
+
+    const s32 width = getRenderTargetBucketSize_(mViewSize.x);
+    const s32 height = getRenderTargetBucketSize_(mViewSize.y);
+
+    // Reallocate once the view has kept the same size for a few frames.
+    // Until then, draw into whatever part of the current target fits and let
+    // the view stretch it.
+    if ((width != mRenderTargetSize.x || height != mRenderTargetSize.y) &&
+        mViewResizeFrame >= cViewResizeSettleFrameNum)
+    {
+        createRenderBuffer_(width, height);
+    }
+
+    const f32 scale = mDynamicResolution.getScale();
+    const s32 scaled_width = std::max<s32>(1, s32(mViewSize.x * scale + 0.5f));
+    const s32 scaled_height = std::max<s32>(1, s32(mViewSize.y * scale + 0.5f));
+
+    mRenderSize.x = std::min(scaled_width, mRenderTargetSize.x);
+    mRenderSize.y = std::min(scaled_height, mRenderTargetSize.y);
+
+    releaseRenderTargetPool_(false);
+}
+
+void Editor::retireRenderTarget_()
+{
+    if (!mpColorTexture)
+        return;
+
+    // Anything queued so far may still read or write the old textures, so
+    // they are only freed once the GPU passes this point
+    RenderTarget target;
+    target.color = mpColorTexture;
+    target.depth = mpDepthTexture;
+    target.width = mRenderTargetSize.x;
+    target.height = mRenderTargetSize.y;
+    target.fence.insert();
+    mRenderTargetPool.push_back(std::move(target));
+
+    mpColorTexture = nullptr;
+    mpDepthTexture = nullptr;
+}
+
+void Editor::releaseRenderTargetPool_(bool force)
+{
+    // Oldest first; keep a few recent sizes around for splitter drags that
+    // go back and forth
+    while (!mRenderTargetPool.empty())
+    {
+        RenderTarget& target = mRenderTargetPool.front();
+
+        if (force)
+            target.fence.wait();
+        else if (mRenderTargetPool.size() <= cRenderTargetPoolMax || !target.fence.isSignaled())
+            break;
+
+        delete target.color;
+        delete target.depth;
+        mRenderTargetPool.erase(mRenderTargetPool.begin());
+    }
+}
+
+#if RIO_IS_WIN
+
+void Editor::resize_(s32 width, s32 height)
+{
+    ImGuiUtil::setDisplaySize(width, height);
+    mIdleMonitor.wake();
+}
+
+void Editor::onResizeCallback_(s32 width, s32 height)
+{
+    static_cast<Editor*>(rio::sRootTask)->resize_(width, height);
+}
+
+#endif // RIO_IS_WIN
+
+void Editor::prepare_()
+{
+#if RIO_IS_WIN
+    RIO_LOG("My directory is %s\n", g_CWD.c_str());
+#endif // RIO_IS_WIN
 
 #if RIO_IS_WIN
     rio::Window::instance()->setOnResizeCallback(&Editor::onResizeCallback_);
@@ -567,10 +1834,30 @@ void Editor::prepare_()
     mRenderBuffer.setRenderTargetColor(&mColorTarget);
     mRenderBuffer.setRenderTargetDepth(&mDepthTarget);
 
-    createRenderBuffer_(width, height);
+    createRenderBuffer_(getRenderTargetBucketSize_(width), getRenderTargetBucketSize_(height));
+    mRenderSize = mViewSize;
+    mViewResizeFrame = cViewResizeSettleFrameNum;
 
     initEftSystem_();
 
+    resumeThumbnailCache_();
+
+    mEmitterProfiler.initialize();
+    mOverdrawView.initialize();
+    mStreamBuffer.initialize(cStreamBufferRegionSize);
+    mTextureStreamer.initialize();
+    loadBakedCache_();
+
+    mDiffPath = GetContentFilePath("Eset_Cafe.ptcl");
+
+    // Regression runs compare against the resource they started with
+    if (FileWatcher::isSupported() && !g_CommandLine.regression)
+        mFileWatcher.start(GetContentFilePath("Eset_Cafe.ptcl"));
+    mGeometryCache.initialize(&mStreamBuffer);
+    mSphereMesh = mGeometryCache.addSphere8x16();
+    mEmitterGizmo.initialize(&mGeometryCache);
+    mDynamicResolution.initialize();
+
     // Foreground layer
     {
         rio::lyr::Layer* const layer = const_cast<rio::lyr::Layer*>(rio::lyr::Layer::peelIterator(rio::lyr::Renderer::instance()->addLayer("Foreground", 0)));
@@ -590,15 +1877,31 @@ void Editor::prepare_()
         layer->addDrawMethod(0, { this, &Editor::renderBackground });
         layer->setProjection(&mProjection);
     }
+
+    if (g_CommandLine.regression)
+        startRegression_(g_CommandLine.update_golden);
 }
 
 void Editor::calc_()
 {
+    mIdleMonitor.wait();
+
     ImGuiUtil::newFrame();
 
+    // Dump the trace collected so far on demand
+    if (ImGui::IsKeyPressed(ImGuiKey_F9, false))
+        Trace::dump(GetTraceFilePath().c_str());
+
     calcViewUi_();
     drawUiEmitterSelection_();
     drawUiEmitterEdit_();
+    drawUiProfiler_();
+    drawUiCapture_();
+    drawUiRegression_();
+    drawUiPtclDiff_();
+
+    // Textures decoded since the last frame show up in the next one
+    mTextureStreamer.calc();
 
     if (mViewResized)
     {
@@ -606,29 +1909,286 @@ void Editor::calc_()
         mViewResized = false;
     }
 
+    updateRenderBuffer_();
+
+    calcRegression_();
+
+    // Deferred while a capture or regression run depends on the resource
+    if (!mRegressionRunner.isRunning() && !mFrameCapture.isCapturing() && mFileWatcher.poll())
+        reloadPtcl_();
+
+    // Captures run until their frame count, or until the set dies
+    if (mFrameCapture.isCapturing() && !mRegressionRunner.isRunning())
+    {
+        const bool alive = g_EftHandle.IsValid() && g_EftHandle.GetEmitterSet()->IsAlive();
+        if (mFrameCapture.isComplete() || (mFrameCapture.getSettings().frame_num == 0 && !alive && !mLoopEmitterSet))
+            mFrameCapture.stop();
+    }
+
+    // Nothing alive and nothing changed: keep showing the last view frame
+    mIdleMonitor.update(isViewBusy_());
+    if (mIdleMonitor.isIdle())
+        return;
+
+    const u64 calc_start = Trace::now();
     calcEftSystem_();
+
+    if (mRegressionRunner.isRunning())
+        mRegressionRunner.addCalcTime(Trace::now() - calc_start);
+}
+
+void Editor::benchmarkEndianSwap_()
+{
+    // The plan the writer reads the file through when saving: every emitter
+    // record, laid out by the writer's field table
+    if (!mPtclWriter.isTracking())
+        return;
+
+    const EndianSwapPlan& plan = mPtclWriter.getSwapPlan();
+    const std::vector<u8>& image = mPtclWriter.getImage();
+
+    EDITOR_TRACE_SCOPE("BenchmarkEndianSwap");
+
+    BenchmarkEndianSwap(plan, image.data(), image.size(), &mEndianSwapBenchmark);
+
+    RIO_LOG("Endian swap benchmark (%s): %.2f MB, %.0f MB/s, scalar %.0f MB/s, %s, %s\n", GetSimdLevelName(),
+            mEndianSwapBenchmark.byte_num / (1024.0f * 1024.0f),
+            GetEndianSwapRate(mEndianSwapBenchmark.byte_num, mEndianSwapBenchmark.simd_ns),
+            GetEndianSwapRate(mEndianSwapBenchmark.byte_num, mEndianSwapBenchmark.scalar_ns),
+            mEndianSwapBenchmark.matched ? "matches scalar" : "DIFFERS FROM SCALAR",
+            mEndianSwapBenchmark.idempotent ? "idempotent" : "NOT IDEMPOTENT");
+}
+
+void Editor::loadBakedCache_()
+{
+    if (!BakedCache::isSupported() || !mTextureStreamer.isInitialized() || mPtclHash.empty())
+        return;
+
+    const std::string path = GetBakedCachePath(mPtclHash);
+    if (mBakedCache.open(path, mPtclHash))
+    {
+        mTextureStreamer.setBakedCache(&mBakedCache, mPtclFile, mPtclFileSize);
+        RIO_LOG("Baked cache: %u textures from %s\n", mBakedCache.getTextureNum(), path.c_str());
+        return;
+    }
+
+    // Every texture of the resource, for the next launch
+    const nw::eft::Resource* resource = g_EftSystem->GetResource(0);
+    std::vector<GX2Texture> textures;
+
+    const u32 set_num = resource->GetNumEmitterSet();
+    for (u32 i = 0; i < set_num; i++)
+    {
+        const u32 emitter_num = resource->GetNumEmitter(i);
+        for (u32 j = 0; j < emitter_num; j++)
+        {
+            const nw::eft::CommonEmitterData* emitter = resource->GetEmitterData(i, j);
+            for (u32 k = 0; k < nw::eft::EFT_TEXTURE_SLOT_BIN_MAX; k++)
+            {
+                if (emitter->texRes[k].gx2Texture.surface.imagePtr)
+                    textures.push_back(emitter->texRes[k].gx2Texture);
+            }
+        }
+    }
+
+    mTextureStreamer.bake(path, mPtclHash, textures, mPtclFile, mPtclFileSize);
+}
+
+void Editor::undoEdit_(bool redo)
+{
+    std::vector<UndoJournal::Change> changes;
+    if (!(redo ? mUndoJournal.redo(&changes) : mUndoJournal.undo(&changes)))
+        return;
+
+    for (const UndoJournal::Change& change : changes)
+    {
+        // Bulk edits may have touched anything
+        if (change.owner == UndoJournal::cNoOwner)
+            mLiveEdit.markEdited(nullptr, LiveEdit::DERIVED_CREATE);
+        else
+            mLiveEdit.markEdited(reinterpret_cast<const nw::eft::SimpleEmitterData*>(mPtclFile + change.owner), change.tag);
+    }
+}
+
+void Editor::savePtcl_()
+{
+    EDITOR_TRACE_SCOPE("SavePtcl");
+
+    const PtclWriter::Result result = mPtclWriter.save();
+    const PtclWriter::Stats& stats = mPtclWriter.getStats();
+
+    mSaveConflict = result == PtclWriter::RESULT_CONFLICT;
+
+    if (result != PtclWriter::RESULT_FAILED && result != PtclWriter::RESULT_CONFLICT)
+        RIO_LOG("Saved %s: %u fields changed, %u bytes, %.2f ms\n", mPtclWriter.getPath().c_str(),
+                stats.patched_field_num, stats.patched_byte_num, stats.save_ns / 1000000.0f);
+}
+
+void Editor::reloadPtcl_()
+{
+    EDITOR_TRACE_SCOPE("ReloadPtcl");
+
+    const u64 start = Trace::now();
+
+    u8* data = nullptr;
+    u32 size = 0;
+    if (!ReadContentFile("Eset_Cafe.ptcl", &data, &size))
+    {
+        RIO_LOG("Hot reload: failed to read Eset_Cafe.ptcl\n");
+        return;
+    }
+
+    // Either way the kept file matches the disk again
+    mSaveConflict = false;
+
+    // Saves from the editor itself come back here unchanged
+    const PtclWriter::Delta delta = mPtclWriter.isTracking() ? mPtclWriter.compareDelta(data, size) : PtclWriter::DELTA_STRUCTURAL;
+    if (delta == PtclWriter::DELTA_UNCHANGED)
+    {
+        FreeContentFile(data);
+        return;
+    }
+
+    mReloadStats.reload_num++;
+    mReloadStats.field_num = 0;
+    mReloadStats.changed_set_num = 0;
+    mReloadStats.structural = delta == PtclWriter::DELTA_STRUCTURAL;
+
+    if (delta == PtclWriter::DELTA_FIELDS)
+    {
+        std::vector<u32> changed_records;
+
+        // Undoing the reload brings back the values it replaced
+        const bool bulk = mUndoJournal.beginBulk();
+        mPtclWriter.applyDelta(data, &changed_records);
+        if (bulk)
+            mUndoJournal.endBulk(UndoJournal::cNoOwner, LiveEdit::DERIVED_CREATE);
+
+        FreeContentFile(data);
+
+        mReloadStats.field_num = mPtclWriter.getStats().reloaded_field_num;
+
+        // Sets that use none of the changed records keep their instances and thumbnails
+        const nw::eft::Resource* resource = g_EftSystem->GetResource(0);
+        const u32 set_num = resource->GetNumEmitterSet();
+        for (u32 i = 0; i < set_num; i++)
+        {
+            const nw::eft::SimpleEmitterData* changed = nullptr;
+
+            const u32 emitter_num = resource->GetNumEmitter(i);
+            for (u32 j = 0; j < emitter_num && !changed; j++)
+            {
+                const u8* record = reinterpret_cast<const u8*>(resource->GetEmitterData(i, j));
+                if (std::binary_search(changed_records.begin(), changed_records.end(), u32(record - mPtclFile)))
+                    changed = reinterpret_cast<const nw::eft::SimpleEmitterData*>(record);
+            }
+
+            if (!changed)
+                continue;
+
+            mReloadStats.changed_set_num++;
+            mThumbnailCache.invalidate(i);
+
+            // Which fields changed is not tracked per record, so the set restarts
+            if (i == mCurrentEmitterSet)
+                mLiveEdit.markEdited(changed, LiveEdit::DERIVED_CREATE);
+        }
+
+        // Textures are not fields, so the baked cache opened for the old file stays valid
+    }
+    else
+    {
+        EDITOR_TRACE_SCOPE("ReenterResource");
+
+        clearResource_();
+
+        mPtclFile = data;
+        mPtclFileSize = size;
+        entryResource_();
+
+        const u32 set_num = g_EftSystem->GetResource(0)->GetNumEmitterSet();
+        if (mCurrentEmitterSet >= set_num)
+            mCurrentEmitterSet = 0;
+        mPrevEmitterSet = mCurrentEmitterSet;
+        mReloadStats.changed_set_num = set_num;
+
+        [[maybe_unused]] bool created = g_EftSystem->CreateEmitterSetID(&g_EftHandle, nw::math::MTX34::Identity(), mCurrentEmitterSet);
+        RIO_ASSERT(created);
+
+        g_EftHandle.GetEmitterSet()->SetMtx(GetEmitterSetMtx());
+
+        loadBakedCache_();
+    }
+
+    mReloadStats.reload_ns = Trace::now() - start;
+    mIdleMonitor.wake();
+
+    if (mReloadStats.structural)
+        RIO_LOG("Hot reload: structure changed, resource re-entered in %.2f ms\n", mReloadStats.reload_ns / 1000000.0f);
+    else
+        RIO_LOG("Hot reload: %u fields in %u sets, %.2f ms\n", mReloadStats.field_num, mReloadStats.changed_set_num,
+                mReloadStats.reload_ns / 1000000.0f);
+}
+
+void Editor::optimizePtcl_()
+{
+    mOptimizeError.clear();
+    mOptimizeDone = OptimizePtclFile(GetContentFilePath("Eset_Cafe.ptcl"), GetContentFilePath("Eset_Cafe.optimized.ptcl"),
+                                     &mOptimizeReport, &mOptimizeError);
+    if (mOptimizeDone)
+        RIO_LOG("Optimized Eset_Cafe.ptcl: %u -> %u bytes\n", mOptimizeReport.size[0], mOptimizeReport.size[1]);
+}
+
+bool Editor::isViewBusy_() const
+{
+    if (HasImGuiInput())
+        return true;
+
+    // Waiting for the render target to be reallocated or the view to be redrawn at its new size
+    if (mViewResizeFrame < cViewResizeSettleFrameNum)
+        return true;
+
+    if (mRenderSize.x != mLastRenderSize.x || mRenderSize.y != mLastRenderSize.y)
+        return true;
+
+    if (mLoopEmitterSet || mFrameCapture.isCapturing() || mThumbnailCache.isBusy() || mTextureStreamer.isBusy())
+        return true;
+
+    // Keep polling until the file settles
+    if (mFileWatcher.isPending())
+        return true;
+
+    return g_EftHandle.IsValid() && g_EftHandle.GetEmitterSet()->IsAlive();
 }
 
 void Editor::exit_()
 {
+    Trace::dump(GetTraceFilePath().c_str());
+
+    mFileWatcher.stop();
+    mEmitterProfiler.finalize();
+    mOverdrawView.finalize();
+    cancelRegression_();
+    mEmitterGizmo.finalize();
+    mGeometryCache.finalize();
+    mStreamBuffer.finalize();
+    mDynamicResolution.finalize();
+    mTextureStreamer.finalize();
+    mBakedCache.close();
+
+    mThumbnailCache.finalize();
+
     if (g_EftHandle.IsValid())
         g_EftHandle.GetEmitterSet()->Kill();
 
+    mPtclWriter.reset();
+    mUndoJournal.clear();
     g_EftSystem->ClearResource(&g_EftRootHeap, 0);
     FreeContentFile(mPtclFile);
     DeInitEftSystem();
 
-    if (mpColorTexture)
-    {
-        delete mpColorTexture;
-        mpColorTexture = nullptr;
-    }
-
-    if (mpDepthTexture)
-    {
-        delete mpDepthTexture;
-        mpDepthTexture = nullptr;
-    }
+    retireRenderTarget_();
+    releaseRenderTargetPool_(true);
 
     ImGuiUtil::shutdown();
 
@@ -641,6 +2201,15 @@ void Editor::bindViewRenderBuffer_()
 {
     mpColorTexture->setCompMap(0x00010203);
     mRenderBuffer.bind();
+
+    // Restrict drawing to the part of the bucketed target the view shows
+#if RIO_IS_WIN
+    RIO_GL_CALL(glViewport(0, 0, mRenderSize.x, mRenderSize.y));
+    RIO_GL_CALL(glScissor(0, 0, mRenderSize.x, mRenderSize.y));
+#else
+    rio::Graphics::setViewport(0, 0, mRenderSize.x, mRenderSize.y);
+    rio::Graphics::setScissor(0, 0, mRenderSize.x, mRenderSize.y);
+#endif
 }
 
 void Editor::unbindViewRenderBuffer_()
@@ -658,6 +2227,26 @@ void Editor::unbindViewRenderBuffer_()
 }
 
 void Editor::renderForeground(const rio::lyr::DrawInfo& drawInfo)
+{
+    if (mFrameCapture.isCapturing())
+    {
+        const u64 render_start = Trace::now();
+        renderCapture_();
+
+        if (mRegressionRunner.isRunning())
+            mRegressionRunner.addRenderTime(Trace::now() - render_start);
+    }
+
+    if (mThumbnailCache.isRenderPending())
+        renderThumbnail_();
+
+    if (!mIdleMonitor.isIdle())
+        renderView_(drawInfo);
+
+    ImGuiUtil::render();
+}
+
+void Editor::renderView_(const rio::lyr::DrawInfo& drawInfo)
 {
     bindViewRenderBuffer_();
 
@@ -670,31 +2259,60 @@ void Editor::renderForeground(const rio::lyr::DrawInfo& drawInfo)
     const rio::lyr::Layer& layer = drawInfo.parent_layer;
     const rio::OrthoProjection* const proj = static_cast<const rio::OrthoProjection*>(layer.projection());
 
+    mOverdrawView.begin((uintptr)(mpColorTexture->getNativeTextureHandle()), mRenderTargetSize.x, mRenderTargetSize.y, mRenderSize.x, mRenderSize.y);
+
     drawEftSystem_(
         reinterpret_cast<const nw::math::MTX44&>(proj->getMatrix()),
         nw::math::MTX34::Identity(),
         { 0.0f, 0.0f, 0.0f },
         proj->getNear(),
-        proj->getFar()
+        proj->getFar(),
+        *mpColorTexture,
+        *mpDepthTexture,
+        0,
+        true
     );
 
+    mOverdrawView.end();
+
+    if (mEmitterGizmo.isEnabled())
+    {
+        // The overdraw view may have left its own framebuffer bound
+        bindViewRenderBuffer_();
+
+        rio::RenderState gizmo_render_state;
+        gizmo_render_state.setDepthTestEnable(false);
+        gizmo_render_state.setDepthWriteEnable(false);
+        gizmo_render_state.setBlendEnable(true);
+        gizmo_render_state.apply();
+
+        mEmitterGizmo.draw(
+            g_EftSystem->GetEmitterHead(0),
+            proj->getMatrix(),
+            reinterpret_cast<const rio::Matrix34f&>(nw::math::MTX34::Identity())
+        );
+    }
+
+    mStreamBuffer.endFrame();
+    mDynamicResolution.endFrame();
+
     unbindViewRenderBuffer_();
 
-    ImGuiUtil::render();
+    mLastRenderSize = mRenderSize;
 }
 
 void Editor::renderBackground(const rio::lyr::DrawInfo& drawInfo)
 {
+    // The last view frame is still in the render target
+    if (mIdleMonitor.isIdle())
+        return;
+
+    // The background is the first layer drawn each frame
+    mStreamBuffer.beginFrame();
+    mDynamicResolution.beginFrame();
+
     mpColorTexture->setCompMap(0x00010203);
-    mRenderBuffer.clear(
-        rio::RenderBuffer::CLEAR_FLAG_COLOR_DEPTH,
-        {
-            119 / 255.f,
-            136 / 255.f,
-            153 / 255.f,
-            1.0f
-        }
-    );
+    mRenderBuffer.clear(rio::RenderBuffer::CLEAR_FLAG_COLOR_DEPTH, cViewClearColor);
     bindViewRenderBuffer_();
 
     rio::RenderState render_state;
@@ -703,25 +2321,43 @@ void Editor::renderBackground(const rio::lyr::DrawInfo& drawInfo)
 
     const rio::lyr::Layer& layer = drawInfo.parent_layer;
 
-    rio::PrimitiveRenderer* const primitive_renderer = rio::PrimitiveRenderer::instance();
-    primitive_renderer->setCamera(*(layer.camera()));
-    primitive_renderer->setProjection(*(layer.projection()));
+    if (mGeometryCache.isInitialized())
+    {
+        rio::Matrix34f view_mtx;
+        layer.camera()->getMatrix(&view_mtx);
+
+        rio::Matrix34f mtx;
+        mtx.makeS({ 128.0f, 128.0f, 128.0f });
+        mtx.m[0][3] = -128.0f;
+        mtx.m[1][3] =   16.0f;
+        mtx.m[2][3] = -600.0f;
+
+        mGeometryCache.begin(layer.projection()->getMatrix(), view_mtx);
+        mGeometryCache.draw(mSphereMesh, mtx, rio::Color4f::cRed, rio::Color4f::cBlue);
+        mGeometryCache.end();
+    }
+    else
+    {
+        rio::PrimitiveRenderer* const primitive_renderer = rio::PrimitiveRenderer::instance();
+        primitive_renderer->setCamera(*(layer.camera()));
+        primitive_renderer->setProjection(*(layer.projection()));
 
-    rio::Matrix34f mtx;
-    mtx.makeT({ -128.0f, 16.0f, -600.0f });
+        rio::Matrix34f mtx;
+        mtx.makeT({ -128.0f, 16.0f, -600.0f });
 
-    primitive_renderer->setModelMatrix(mtx);
+        primitive_renderer->setModelMatrix(mtx);
 
-    primitive_renderer->begin();
-    {
-        primitive_renderer->drawSphere8x16(
-            {  },
-            128.0f,
-            rio::Color4f::cRed,
-            rio::Color4f::cBlue
-        );
+        primitive_renderer->begin();
+        {
+            primitive_renderer->drawSphere8x16(
+                {  },
+                128.0f,
+                rio::Color4f::cRed,
+                rio::Color4f::cBlue
+            );
+        }
+        primitive_renderer->end();
     }
-    primitive_renderer->end();
 
     unbindViewRenderBuffer_();
 }
@@ -0,0 +1,172 @@
+#include <emitter_culler.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <nw/eft/eft_Emitter.h>
+#include <nw/eft/eft_Particle.h>
+#include <nw/eft/eft_ResData.h>
+
+// Billboards may be rotated in any direction, so the bounding sphere of a
+// particle quad is used rather than its half-extents
+static constexpr f32 cParticleRadiusScale = 1.41421356f;
+
+static inline f32 GetMaxAxisScale(const nw::math::MTX34& mtx)
+{
+    f32 max_sq = 0.0f;
+    for (u32 i = 0; i < 3; i++)
+    {
+        const f32 sq = mtx.m[0][i] * mtx.m[0][i] +
+                       mtx.m[1][i] * mtx.m[1][i] +
+                       mtx.m[2][i] * mtx.m[2][i];
+        max_sq = std::max(max_sq, sq);
+    }
+    return std::sqrt(max_sq);
+}
+
+EmitterCuller::EmitterCuller()
+    : mEnabled(true)
+    , mStats{ 0, 0, 0, 0 }
+{
+}
+
+void EmitterCuller::update(nw::eft::EmitterInstance* head)
+{
+    // clear() keeps the buckets, so steady-state frames do not allocate
+    mBounds.clear();
+
+    if (!mEnabled)
+        return;
+
+    for (nw::eft::EmitterInstance* emitter = head; emitter != NULL; emitter = emitter->next)
+    {
+        const nw::eft::SimpleEmitterData* data = emitter->data;
+
+        Bounds& bounds = mBounds[emitter];
+        bounds.min[0] = bounds.min[1] = bounds.min[2] =  FLT_MAX;
+        bounds.max[0] = bounds.max[1] = bounds.max[2] = -FLT_MAX;
+        bounds.particle_num = 0;
+        bounds.visible_alpha = false;
+
+        // Complex emitters also draw child particles and stripes whose
+        // extents are not tracked here, so they are never culled
+        bounds.cullable = data->type == nw::eft::EFT_EMITTER_TYPE_SIMPLE;
+        if (!bounds.cullable)
+            continue;
+
+        const bool track_bounds = data->meshType == nw::eft::EFT_MESH_TYPE_PARTICLE;
+        const f32 base_scale = std::max(std::abs(data->baseScale.x), std::abs(data->baseScale.y)) * GetMaxAxisScale(emitter->matrixSRT) * cParticleRadiusScale;
+
+        for (const nw::eft::PtclInstance* ptcl = emitter->particleHead; ptcl != NULL; ptcl = ptcl->next)
+        {
+            bounds.particle_num++;
+
+            if (ptcl->alpha > 0.0f)
+                bounds.visible_alpha = true;
+
+            if (!track_bounds)
+                continue;
+
+            const f32 radius = std::max(std::abs(ptcl->scale.x), std::abs(ptcl->scale.y)) * base_scale;
+            const nw::math::VEC3& pos = ptcl->worldPos;
+
+            bounds.min[0] = std::min(bounds.min[0], pos.x - radius);
+            bounds.min[1] = std::min(bounds.min[1], pos.y - radius);
+            bounds.min[2] = std::min(bounds.min[2], pos.z - radius);
+            bounds.max[0] = std::max(bounds.max[0], pos.x + radius);
+            bounds.max[1] = std::max(bounds.max[1], pos.y + radius);
+            bounds.max[2] = std::max(bounds.max[2], pos.z + radius);
+        }
+
+        // Primitive meshes can extend arbitrarily far from the particle
+        // position, so only their alpha is used
+        if (!track_bounds)
+        {
+            bounds.min[0] = bounds.min[1] = bounds.min[2] = -FLT_MAX;
+            bounds.max[0] = bounds.max[1] = bounds.max[2] =  FLT_MAX;
+        }
+    }
+}
+
+void EmitterCuller::beginCull(const nw::math::MTX44& proj, const nw::math::MTX34& view)
+{
+    mStats.emitter_num = 0;
+    mStats.culled_empty_num = 0;
+    mStats.culled_frustum_num = 0;
+    mStats.culled_alpha_num = 0;
+
+    for (u32 i = 0; i < 4; i++)
+    {
+        for (u32 j = 0; j < 4; j++)
+        {
+            f32 value = 0.0f;
+            for (u32 k = 0; k < 3; k++)
+                value += proj.m[i][k] * view.m[k][j];
+
+            if (j == 3)
+                value += proj.m[i][3];
+
+            mViewProj[i][j] = value;
+        }
+    }
+}
+
+bool EmitterCuller::isVisible(const nw::eft::EmitterInstance* emitter)
+{
+    mStats.emitter_num++;
+
+    if (!mEnabled)
+        return true;
+
+    const auto it = mBounds.find(emitter);
+    if (it == mBounds.end())
+        return true;    // Created after the last update
+
+    const Bounds& bounds = it->second;
+    if (!bounds.cullable)
+        return true;
+
+    if (bounds.particle_num == 0)
+    {
+        mStats.culled_empty_num++;
+        return false;
+    }
+
+    if (!bounds.visible_alpha)
+    {
+        mStats.culled_alpha_num++;
+        return false;
+    }
+
+    if (bounds.min[0] == -FLT_MAX)
+        return true;
+
+    // Outside if all eight corners are beyond the same clip plane
+    u32 outside_mask = 0x3F;
+    for (u32 corner = 0; corner < 8; corner++)
+    {
+        const f32 x = (corner & 1) ? bounds.max[0] : bounds.min[0];
+        const f32 y = (corner & 2) ? bounds.max[1] : bounds.min[1];
+        const f32 z = (corner & 4) ? bounds.max[2] : bounds.min[2];
+
+        f32 clip[4];
+        for (u32 i = 0; i < 4; i++)
+            clip[i] = mViewProj[i][0] * x + mViewProj[i][1] * y + mViewProj[i][2] * z + mViewProj[i][3];
+
+        u32 mask = 0;
+        if (clip[0] < -clip[3]) mask |= 0x01;
+        if (clip[0] >  clip[3]) mask |= 0x02;
+        if (clip[1] < -clip[3]) mask |= 0x04;
+        if (clip[1] >  clip[3]) mask |= 0x08;
+        if (clip[2] < -clip[3]) mask |= 0x10;
+        if (clip[2] >  clip[3]) mask |= 0x20;
+
+        outside_mask &= mask;
+        if (outside_mask == 0)
+            return true;
+    }
+
+    mStats.culled_frustum_num++;
+    return false;
+}
@@ -0,0 +1,315 @@
+#include <emitter_gizmo.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <math/rio_Math.h>
+
+#include <nw/eft/eft_Emitter.h>
+#include <nw/eft/eft_ResData.h>
+
+typedef GeometryCache::Vertex Vertex;
+
+static constexpr u32 cRingSegmentNum = 64;
+static constexpr u32 cMeridianNum = 8;
+static constexpr u32 cLatitudeRingNum = 7;
+static constexpr f32 cPointSize = 0.25f;    // Cross size of point emitters, in emitter space
+
+struct LineMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<u16>    indices;
+
+    void addLine(f32 x0, f32 y0, f32 z0, f32 x1, f32 y1, f32 z1, f32 arc = -1.0f)
+    {
+        const u16 base = vertices.size();
+        vertices.push_back({ { x0, y0, z0 }, 0.0f, arc });
+        vertices.push_back({ { x1, y1, z1 }, 0.0f, arc });
+        indices.push_back(base);
+        indices.push_back(base + 1);
+    }
+
+    // Ring of the given radius in the XZ plane at height y; arc follows the angle
+    void addRing(f32 radius, f32 y)
+    {
+        const u16 base = vertices.size();
+        for (u32 i = 0; i <= cRingSegmentNum; i++)
+        {
+            const f32 arc = f32(i) / cRingSegmentNum;
+            const f32 angle = rio::Mathf::pi2() * arc;
+            vertices.push_back({ { radius * std::cos(angle), y, radius * std::sin(angle) }, 0.0f, arc });
+        }
+        for (u32 i = 0; i < cRingSegmentNum; i++)
+        {
+            indices.push_back(base + i);
+            indices.push_back(base + i + 1);
+        }
+    }
+
+    GeometryCache::MeshHandle upload(GeometryCache* cache) const
+    {
+        return cache->addMesh(GeometryCache::PRIMITIVE_TYPE_LINES, vertices.data(), vertices.size(), indices.data(), indices.size());
+    }
+};
+
+EmitterGizmo::EmitterGizmo()
+    : mpGeometryCache(nullptr)
+    , mEnabled(false)
+    , mStats{ 0, 0 }
+{
+    std::fill(mMesh, mMesh + MESH_TYPE_NUM, GeometryCache::cInvalidMesh);
+}
+
+void EmitterGizmo::initialize(GeometryCache* geometry_cache)
+{
+    if (!geometry_cache->isInitialized())
+        return;
+
+    mpGeometryCache = geometry_cache;
+
+    {
+        LineMesh mesh;
+        mesh.addLine(-1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+        mesh.addLine(0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+        mesh.addLine(0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f);
+        mMesh[MESH_TYPE_CROSS] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        mesh.addRing(1.0f, 0.0f);
+        mMesh[MESH_TYPE_CIRCLE] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        for (u32 i = 1; i <= cLatitudeRingNum; i++)
+        {
+            const f32 theta = rio::Mathf::pi() * i / (cLatitudeRingNum + 1);
+            mesh.addRing(std::sin(theta), std::cos(theta));
+        }
+        for (u32 i = 0; i < cMeridianNum; i++)
+        {
+            const f32 arc = f32(i) / cMeridianNum;
+            const f32 phi = rio::Mathf::pi2() * arc;
+            for (u32 j = 0; j < cRingSegmentNum / 2; j++)
+            {
+                const f32 theta0 = rio::Mathf::pi() * j / (cRingSegmentNum / 2);
+                const f32 theta1 = rio::Mathf::pi() * (j + 1) / (cRingSegmentNum / 2);
+                mesh.addLine(std::sin(theta0) * std::cos(phi), std::cos(theta0), std::sin(theta0) * std::sin(phi),
+                             std::sin(theta1) * std::cos(phi), std::cos(theta1), std::sin(theta1) * std::sin(phi), arc);
+            }
+        }
+        mMesh[MESH_TYPE_SPHERE] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        mesh.addRing(1.0f,  1.0f);
+        mesh.addRing(1.0f, -1.0f);
+        for (u32 i = 0; i < cMeridianNum; i++)
+        {
+            const f32 arc = f32(i) / cMeridianNum;
+            const f32 phi = rio::Mathf::pi2() * arc;
+            mesh.addLine(std::cos(phi), -1.0f, std::sin(phi), std::cos(phi), 1.0f, std::sin(phi), arc);
+        }
+        mMesh[MESH_TYPE_CYLINDER] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        for (u32 i = 0; i < 4; i++)
+        {
+            const f32 a = (i & 1) ? 1.0f : -1.0f;
+            const f32 b = (i & 2) ? 1.0f : -1.0f;
+            mesh.addLine(-1.0f, a, b, 1.0f, a, b);
+            mesh.addLine(a, -1.0f, b, a, 1.0f, b);
+            mesh.addLine(a, b, -1.0f, a, b, 1.0f);
+        }
+        mMesh[MESH_TYPE_BOX] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        mesh.addLine(0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f);
+        mMesh[MESH_TYPE_LINE] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        mesh.addLine(-1.0f, 0.0f, -1.0f,  1.0f, 0.0f, -1.0f);
+        mesh.addLine( 1.0f, 0.0f, -1.0f,  1.0f, 0.0f,  1.0f);
+        mesh.addLine( 1.0f, 0.0f,  1.0f, -1.0f, 0.0f,  1.0f);
+        mesh.addLine(-1.0f, 0.0f,  1.0f, -1.0f, 0.0f, -1.0f);
+        mMesh[MESH_TYPE_RECTANGLE] = mesh.upload(geometry_cache);
+    }
+    {
+        LineMesh mesh;
+        mesh.addLine(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+        mMesh[MESH_TYPE_AXIS] = mesh.upload(geometry_cache);
+    }
+}
+
+void EmitterGizmo::finalize()
+{
+    // The meshes are owned by the geometry cache
+    std::fill(mMesh, mMesh + MESH_TYPE_NUM, GeometryCache::cInvalidMesh);
+    mpGeometryCache = nullptr;
+}
+
+void EmitterGizmo::draw(nw::eft::EmitterInstance* head, const rio::Matrix44f& proj, const rio::Matrix34f& view)
+{
+    mStats.emitter_num = 0;
+    mStats.instance_num = 0;
+
+    if (!isEnabled())
+        return;
+
+    EDITOR_TRACE_SCOPE("EmitterGizmo");
+
+    mpGeometryCache->begin(proj, view);
+
+    for (nw::eft::EmitterInstance* emitter = head; emitter != NULL; emitter = emitter->next)
+    {
+        const rio::Matrix34f& world = reinterpret_cast<const rio::Matrix34f&>(emitter->matrixSRT);
+
+        // Spread emitters around the hue wheel so neighbours stay distinguishable
+        const f32 hue = std::fmod(mStats.emitter_num * 0.618034f, 1.0f) * 6.0f;
+        const f32 x = 1.0f - std::abs(std::fmod(hue, 2.0f) - 1.0f);
+        rio::Color4f color;
+        switch (s32(hue))
+        {
+        case 0:  color = { 1.0f, x, 0.0f, 0.9f }; break;
+        case 1:  color = { x, 1.0f, 0.0f, 0.9f }; break;
+        case 2:  color = { 0.0f, 1.0f, x, 0.9f }; break;
+        case 3:  color = { 0.0f, x, 1.0f, 0.9f }; break;
+        case 4:  color = { x, 0.0f, 1.0f, 0.9f }; break;
+        default: color = { 1.0f, 0.0f, x, 0.9f }; break;
+        }
+
+        drawVolume_(emitter, world, color);
+
+        const nw::math::VEC3& radius = emitter->data->volumeRadius;
+        drawAxes_(world, std::max(std::max(radius.x, radius.y), std::max(radius.z, 1.0f)));
+
+        mStats.emitter_num++;
+    }
+
+    mpGeometryCache->end();
+    mStats.instance_num = mpGeometryCache->getStats().instance_num;
+}
+
+void EmitterGizmo::drawVolume_(const nw::eft::EmitterInstance* emitter, const rio::Matrix34f& world, const rio::Color4f& color)
+{
+    const nw::eft::SimpleEmitterData* data = emitter->data;
+
+    const f32 radius[3] = { data->volumeRadius.x, data->volumeRadius.y, data->volumeRadius.z };
+    const f32 flat[3] = { radius[0], 1.0f, radius[2] };
+
+    // Sweep angles are stored as 32-bit angle indices (0x100000000 is a full turn)
+    const f32 arc_start = data->volumeSweepStart / 4294967296.0f;
+    const f32 arc_length = data->volumeSweepParam == 0 ? 1.0f : data->volumeSweepParam / 4294967296.0f;
+
+    // Hollow volumes only emit between volumeCaliber * radius and radius
+    const f32 caliber = data->volumeCaliber;
+    const bool hollow = caliber > 0.0f && caliber < 1.0f;
+    const f32 inner[3] = { radius[0] * caliber, radius[1] * caliber, radius[2] * caliber };
+    const f32 inner_flat[3] = { inner[0], 1.0f, inner[2] };
+    const rio::Color4f inner_color = { color.r, color.g, color.b, color.a * 0.5f };
+
+    switch (data->volumeType)
+    {
+    case nw::eft::EFT_VOLUME_TYPE_POINT:
+    case nw::eft::EFT_VOLUME_TYPE_PRIMITIVE:
+        {
+            const f32 size[3] = { cPointSize, cPointSize, cPointSize };
+            drawMesh_(MESH_TYPE_CROSS, world, size, nullptr, color);
+        }
+        break;
+    case nw::eft::EFT_VOLUME_TYPE_CIRCLE:
+    case nw::eft::EFT_VOLUME_TYPE_CIRCLE_SAME_DIVIDE:
+    case nw::eft::EFT_VOLUME_TYPE_CIRCLE_FILL:
+        drawMesh_(MESH_TYPE_CIRCLE, world, flat, nullptr, color, arc_start, arc_length);
+        if (hollow && data->volumeType == nw::eft::EFT_VOLUME_TYPE_CIRCLE_FILL)
+            drawMesh_(MESH_TYPE_CIRCLE, world, inner_flat, nullptr, inner_color, arc_start, arc_length);
+        break;
+    case nw::eft::EFT_VOLUME_TYPE_SPHERE:
+    case nw::eft::EFT_VOLUME_TYPE_SPHERE_SAME_DIVIDE:
+    case nw::eft::EFT_VOLUME_TYPE_SPHERE_SAME_DIVIDE64:
+    case nw::eft::EFT_VOLUME_TYPE_SPHERE_FILL:
+        drawMesh_(MESH_TYPE_SPHERE, world, radius, nullptr, color, arc_start, arc_length);
+        if (hollow && data->volumeType == nw::eft::EFT_VOLUME_TYPE_SPHERE_FILL)
+            drawMesh_(MESH_TYPE_SPHERE, world, inner, nullptr, inner_color, arc_start, arc_length);
+
+        // Emission is limited to the cap above this latitude, given as a
+        // fraction of the way from the top pole to the bottom one
+        if (data->volumeLatitude > 0.0f && data->volumeLatitude < 1.0f)
+        {
+            const f32 theta = rio::Mathf::pi() * data->volumeLatitude;
+            const f32 ring[3] = { radius[0] * std::sin(theta), 1.0f, radius[2] * std::sin(theta) };
+            const f32 trans[3] = { 0.0f, radius[1] * std::cos(theta), 0.0f };
+            drawMesh_(MESH_TYPE_CIRCLE, world, ring, trans, rio::Color4f::cWhite, arc_start, arc_length);
+        }
+        break;
+    case nw::eft::EFT_VOLUME_TYPE_CYLINDER:
+    case nw::eft::EFT_VOLUME_TYPE_CYLINDER_FILL:
+        drawMesh_(MESH_TYPE_CYLINDER, world, radius, nullptr, color, arc_start, arc_length);
+        if (hollow && data->volumeType == nw::eft::EFT_VOLUME_TYPE_CYLINDER_FILL)
+        {
+            const f32 inner_cylinder[3] = { inner[0], radius[1], inner[2] };
+            drawMesh_(MESH_TYPE_CYLINDER, world, inner_cylinder, nullptr, inner_color, arc_start, arc_length);
+        }
+        break;
+    case nw::eft::EFT_VOLUME_TYPE_BOX:
+    case nw::eft::EFT_VOLUME_TYPE_BOX_FILL:
+        drawMesh_(MESH_TYPE_BOX, world, radius, nullptr, color);
+        if (hollow && data->volumeType == nw::eft::EFT_VOLUME_TYPE_BOX_FILL)
+            drawMesh_(MESH_TYPE_BOX, world, inner, nullptr, inner_color);
+        break;
+    case nw::eft::EFT_VOLUME_TYPE_LINE:
+    case nw::eft::EFT_VOLUME_TYPE_LINE_SAME_DIVIDE:
+        {
+            const f32 line[3] = { 1.0f, 1.0f, radius[2] };
+            drawMesh_(MESH_TYPE_LINE, world, line, nullptr, color);
+        }
+        break;
+    case nw::eft::EFT_VOLUME_TYPE_RECTANGLE:
+        drawMesh_(MESH_TYPE_RECTANGLE, world, flat, nullptr, color);
+        break;
+    default:
+        break;
+    }
+}
+
+void EmitterGizmo::drawAxes_(const rio::Matrix34f& world, f32 length)
+{
+    // The axis mesh points along +X; swizzle its columns for Y and Z
+    static const rio::Color4f cAxisColor[3] = { rio::Color4f::cRed, rio::Color4f::cGreen, rio::Color4f::cBlue };
+
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        rio::Matrix34f mtx;
+        for (u32 i = 0; i < 3; i++)
+        {
+            mtx.m[i][0] = world.m[i][axis] * length;
+            mtx.m[i][1] = world.m[i][(axis + 1) % 3];
+            mtx.m[i][2] = world.m[i][(axis + 2) % 3];
+            mtx.m[i][3] = world.m[i][3];
+        }
+
+        mpGeometryCache->draw(mMesh[MESH_TYPE_AXIS], mtx, cAxisColor[axis], cAxisColor[axis]);
+    }
+}
+
+void EmitterGizmo::drawMesh_(MeshType type, const rio::Matrix34f& world, const f32* scale, const f32* trans, const rio::Color4f& color, f32 arc_start, f32 arc_length)
+{
+    // world * T(trans) * S(scale)
+    rio::Matrix34f mtx;
+    for (u32 i = 0; i < 3; i++)
+    {
+        for (u32 j = 0; j < 3; j++)
+            mtx.m[i][j] = world.m[i][j] * scale[j];
+
+        mtx.m[i][3] = world.m[i][3];
+        if (trans)
+            mtx.m[i][3] += world.m[i][0] * trans[0] + world.m[i][1] * trans[1] + world.m[i][2] * trans[2];
+    }
+
+    mpGeometryCache->draw(mMesh[type], mtx, color, color, arc_start, arc_length);
+}
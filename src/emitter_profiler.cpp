@@ -0,0 +1,192 @@
+#include <emitter_profiler.h>
+
+#include <algorithm>
+
+#include <nw/eft/eft_Emitter.h>
+#include <nw/eft/eft_ResData.h>
+
+#if RIO_IS_WIN
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+EmitterProfiler::EmitterProfiler()
+    : mFrame(nullptr)
+    , mFrameIndex(0)
+    , mInitialized(false)
+    , mEnabled(false)
+    , mRecording(false)
+    , mQueryActive(false)
+    , mTotalTimeUs(0.0f)
+{
+}
+
+EmitterProfiler::~EmitterProfiler()
+{
+    finalize();
+}
+
+bool EmitterProfiler::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+void EmitterProfiler::initialize()
+{
+    if (mInitialized || !isSupported())
+        return;
+
+    mFrame = new Frame[cFrameLatency];
+
+    for (u32 i = 0; i < cFrameLatency; i++)
+    {
+        Frame& frame = mFrame[i];
+#if RIO_IS_WIN
+        RIO_GL_CALL(glGenQueries(cQueryNumPerFrame, frame.query));
+#endif // RIO_IS_WIN
+        frame.query_num = 0;
+        frame.pending = false;
+    }
+
+    mFrameIndex = 0;
+    mInitialized = true;
+}
+
+void EmitterProfiler::finalize()
+{
+    if (!mInitialized)
+        return;
+
+#if RIO_IS_WIN
+    for (u32 i = 0; i < cFrameLatency; i++)
+    {
+        RIO_GL_CALL(glDeleteQueries(cQueryNumPerFrame, mFrame[i].query));
+    }
+#endif // RIO_IS_WIN
+
+    delete[] mFrame;
+    mFrame = nullptr;
+
+    mSamples.clear();
+    mTotalTimeUs = 0.0f;
+    mInitialized = false;
+}
+
+void EmitterProfiler::reset()
+{
+    if (mInitialized)
+    {
+        // Results of queries still in flight are never read
+        for (u32 i = 0; i < cFrameLatency; i++)
+        {
+            mFrame[i].query_num = 0;
+            mFrame[i].pending = false;
+        }
+    }
+
+    mSamples.clear();
+    mTotalTimeUs = 0.0f;
+}
+
+void EmitterProfiler::beginFrame()
+{
+    mRecording = false;
+
+    if (!mInitialized || !mEnabled)
+        return;
+
+    Frame& frame = mFrame[mFrameIndex];
+    if (frame.pending)
+    {
+#if RIO_IS_WIN
+        // Queries complete in submission order, so the last one being
+        // available means all of them are
+        GLuint available = GL_FALSE;
+        RIO_GL_CALL(glGetQueryObjectuiv(frame.query[frame.query_num - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (available == GL_FALSE)
+            return; // Skip profiling this frame rather than stall
+#endif // RIO_IS_WIN
+
+        collect_(frame);
+    }
+
+    frame.query_num = 0;
+    mRecording = true;
+}
+
+void EmitterProfiler::endFrame()
+{
+    if (!mRecording)
+        return;
+
+    RIO_ASSERT(!mQueryActive);
+
+    Frame& frame = mFrame[mFrameIndex];
+    frame.pending = frame.query_num > 0;
+
+    mFrameIndex = (mFrameIndex + 1) % cFrameLatency;
+    mRecording = false;
+}
+
+void EmitterProfiler::beginEmitter(const nw::eft::EmitterInstance* emitter)
+{
+    if (!mRecording)
+        return;
+
+    Frame& frame = mFrame[mFrameIndex];
+    if (frame.query_num >= cQueryNumPerFrame)
+        return;
+
+    Sample& sample = frame.sample[frame.query_num];
+    sample.name = emitter->data->name;
+    sample.particle_num = emitter->numParticles;
+    sample.blend_type = emitter->data->blendType;
+    sample.gpu_time_us = 0.0f;
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glBeginQuery(GL_TIME_ELAPSED, frame.query[frame.query_num]));
+#endif // RIO_IS_WIN
+    mQueryActive = true;
+}
+
+void EmitterProfiler::endEmitter()
+{
+    if (!mQueryActive)
+        return;
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glEndQuery(GL_TIME_ELAPSED));
+#endif // RIO_IS_WIN
+
+    mFrame[mFrameIndex].query_num++;
+    mQueryActive = false;
+}
+
+void EmitterProfiler::collect_(Frame& frame)
+{
+    mSamples.clear();
+    mTotalTimeUs = 0.0f;
+
+    for (u32 i = 0; i < frame.query_num; i++)
+    {
+        Sample& sample = frame.sample[i];
+
+#if RIO_IS_WIN
+        GLuint64 time_ns = 0;
+        RIO_GL_CALL(glGetQueryObjectui64v(frame.query[i], GL_QUERY_RESULT, &time_ns));
+        sample.gpu_time_us = time_ns / 1000.0f;
+#endif // RIO_IS_WIN
+
+        mSamples.push_back(sample);
+        mTotalTimeUs += sample.gpu_time_us;
+    }
+
+    std::sort(mSamples.begin(), mSamples.end(), [](const Sample& a, const Sample& b) {
+        return a.gpu_time_us > b.gpu_time_us;
+    });
+
+    frame.pending = false;
+}
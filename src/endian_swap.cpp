@@ -0,0 +1,303 @@
+#include <endian_swap.h>
+#include <simd.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstring>
+
+template <typename T>
+static inline T SwapBytes(T value);
+
+template <> inline u16 SwapBytes(u16 value) { return __builtin_bswap16(value); }
+template <> inline u32 SwapBytes(u32 value) { return __builtin_bswap32(value); }
+template <> inline u64 SwapBytes(u64 value) { return __builtin_bswap64(value); }
+
+template <typename T>
+static void SwapEndianScalar(void* data, u32 count)
+{
+    u8* p = static_cast<u8*>(data);
+    for (u32 i = 0; i < count; i++, p += sizeof(T))
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        value = SwapBytes(value);
+        std::memcpy(p, &value, sizeof(T));
+    }
+}
+
+#if EDITOR_SIMD_SSE2
+
+// SSE2 has no byte shuffle: bytes are swapped within 16-bit lanes by shifts,
+// then the lanes are reordered within each element
+template <typename T>
+static inline __m128i SwapBytesSse2(__m128i value)
+{
+    value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+
+    if constexpr (sizeof(T) == 4)
+        value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, 0xB1), 0xB1);
+    else if constexpr (sizeof(T) == 8)
+        value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, 0x1B), 0x1B);
+
+    return value;
+}
+
+template <typename T>
+static void SwapEndianSse2(void* data, u32 count)
+{
+    constexpr u32 cStep = 16 / sizeof(T);
+
+    u8* p = static_cast<u8*>(data);
+    u32 i = 0;
+    for (; i + cStep <= count; i += cStep, p += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), SwapBytesSse2<T>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+
+    SwapEndianScalar<T>(p, count - i);
+}
+
+#endif // EDITOR_SIMD_SSE2
+
+#if EDITOR_SIMD_AVX2
+
+template <typename T>
+EDITOR_SIMD_TARGET_AVX2 static void SwapEndianAvx2(void* data, u32 count)
+{
+    constexpr u32 cStep = 32 / sizeof(T);
+
+    // Byte order within each 128-bit lane
+    const __m256i shuffle = sizeof(T) == 2 ? _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                                              1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+                          : sizeof(T) == 4 ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                              3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                                           : _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                                              7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+    u8* p = static_cast<u8*>(data);
+    u32 i = 0;
+    for (; i + cStep <= count; i += cStep, p += 32)
+    {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_shuffle_epi8(value, shuffle));
+    }
+
+    SwapEndianScalar<T>(p, count - i);
+}
+
+#endif // EDITOR_SIMD_AVX2
+
+template <typename T>
+static void SwapEndian(void* data, u32 count)
+{
+#if EDITOR_SIMD_AVX2
+    if (GetSimdLevel() == SIMD_LEVEL_AVX2)
+    {
+        SwapEndianAvx2<T>(data, count);
+        return;
+    }
+#endif // EDITOR_SIMD_AVX2
+#if EDITOR_SIMD_SSE2
+    SwapEndianSse2<T>(data, count);
+#else
+    SwapEndianScalar<T>(data, count);
+#endif // EDITOR_SIMD_SSE2
+}
+
+void SwapEndian16(void* data, u32 count) { SwapEndian<u16>(data, count); }
+void SwapEndian32(void* data, u32 count) { SwapEndian<u32>(data, count); }
+void SwapEndian64(void* data, u32 count) { SwapEndian<u64>(data, count); }
+
+static inline bool IsValidWidth(u32 width)
+{
+    return width == 2 || width == 4 || width == 8;
+}
+
+EndianSchema::EndianSchema(u32 size)
+    : mSize(size)
+{
+}
+
+EndianSchema& EndianSchema::field(u32 offset, u32 width, u32 count)
+{
+    RIO_ASSERT(IsValidWidth(width));
+    RIO_ASSERT(offset + width * count <= mSize);
+
+    auto it = std::lower_bound(mRuns.begin(), mRuns.end(), offset, [](const Run& run, u32 value) { return run.offset < value; });
+    RIO_ASSERT(it == mRuns.end() || offset + width * count <= it->offset);
+    RIO_ASSERT(it == mRuns.begin() || (it - 1)->offset + (it - 1)->width * (it - 1)->count <= offset);
+
+    it = mRuns.insert(it, Run{ offset, width, count });
+
+    // Merge with the neighbours
+    if (it + 1 != mRuns.end() && (it + 1)->width == width && (it + 1)->offset == offset + width * count)
+    {
+        it->count += (it + 1)->count;
+        mRuns.erase(it + 1);
+    }
+    if (it != mRuns.begin() && (it - 1)->width == width && (it - 1)->offset + width * (it - 1)->count == offset)
+    {
+        (it - 1)->count += it->count;
+        mRuns.erase(it);
+    }
+
+    return *this;
+}
+
+EndianSwapPlan::EndianSwapPlan()
+    : mTagOffset(0)
+    , mTagValue(0)
+    , mFinalized(false)
+{
+}
+
+void EndianSwapPlan::setTag(u32 offset, u32 host_value)
+{
+    RIO_ASSERT(SwapBytes(host_value) != host_value);
+
+    mTagOffset = offset;
+    mTagValue = host_value;
+}
+
+void EndianSwapPlan::addRecords(u32 offset, const EndianSchema& schema, u32 record_num)
+{
+    const std::vector<EndianSchema::Run>& runs = schema.getRuns();
+    mFinalized = false;
+
+    // A record made of a single run is a plain array
+    if (runs.size() == 1 && runs[0].offset == 0 && runs[0].width * runs[0].count == schema.getSize())
+    {
+        addArray(offset, runs[0].width, runs[0].count * record_num);
+        return;
+    }
+
+    for (u32 i = 0; i < record_num; i++)
+        for (const EndianSchema::Run& run : runs)
+            mSpans.push_back(Span{ offset + i * schema.getSize() + run.offset, run.width, run.count });
+}
+
+void EndianSwapPlan::addArray(u32 offset, u32 width, u32 count)
+{
+    RIO_ASSERT(IsValidWidth(width));
+
+    if (count > 0)
+        mSpans.push_back(Span{ offset, width, count });
+
+    mFinalized = false;
+}
+
+void EndianSwapPlan::finalize()
+{
+    std::sort(mSpans.begin(), mSpans.end(), [](const Span& a, const Span& b) { return a.offset < b.offset; });
+
+    std::vector<Span> merged;
+    merged.reserve(mSpans.size());
+
+    for (const Span& span : mSpans)
+    {
+        RIO_ASSERT(span.offset + span.width * span.count <= mTagOffset || span.offset >= mTagOffset + 4);
+
+        if (!merged.empty())
+        {
+            Span& last = merged.back();
+            const u32 last_end = last.offset + last.width * last.count;
+            RIO_ASSERT(last_end <= span.offset);
+
+            if (last.width == span.width && last_end == span.offset)
+            {
+                last.count += span.count;
+                continue;
+            }
+        }
+
+        merged.push_back(span);
+    }
+
+    mSpans.swap(merged);
+    mFinalized = true;
+}
+
+EndianSwapPlan::Result EndianSwapPlan::apply_(void* data, u32 size, SwapFunc swap16, SwapFunc swap32, SwapFunc swap64) const
+{
+    RIO_ASSERT(mFinalized);
+
+    if (mTagOffset + 4 > size)
+        return RESULT_INVALID;
+
+    u8* const bytes = static_cast<u8*>(data);
+
+    u32 tag;
+    std::memcpy(&tag, bytes + mTagOffset, sizeof(tag));
+
+    if (tag == mTagValue)
+        return RESULT_ALREADY_HOST;
+
+    if (tag != SwapBytes(mTagValue))
+        return RESULT_INVALID;
+
+    // Spans are sorted, checking the last one is enough
+    if (!mSpans.empty() && u64(mSpans.back().offset) + u64(mSpans.back().width) * mSpans.back().count > size)
+        return RESULT_INVALID;
+
+    for (const Span& span : mSpans)
+    {
+        switch (span.width)
+        {
+        case 2:     swap16(bytes + span.offset, span.count); break;
+        case 4:     swap32(bytes + span.offset, span.count); break;
+        default:    swap64(bytes + span.offset, span.count); break;
+        }
+    }
+
+    // Last, so a buffer is never left half swapped with its tag in host order
+    tag = mTagValue;
+    std::memcpy(bytes + mTagOffset, &tag, sizeof(tag));
+
+    return RESULT_SWAPPED;
+}
+
+EndianSwapPlan::Result EndianSwapPlan::apply(void* data, u32 size) const
+{
+    return apply_(data, size, &SwapEndian16, &SwapEndian32, &SwapEndian64);
+}
+
+EndianSwapPlan::Result EndianSwapPlan::applyScalar(void* data, u32 size) const
+{
+    return apply_(data, size, &SwapEndianScalar<u16>, &SwapEndianScalar<u32>, &SwapEndianScalar<u64>);
+}
+
+u32 EndianSwapPlan::getSpanNum() const
+{
+    return mSpans.size();
+}
+
+u32 EndianSwapPlan::getByteNum() const
+{
+    u32 byte_num = 4;   // Tag
+    for (const Span& span : mSpans)
+        byte_num += span.width * span.count;
+
+    return byte_num;
+}
+
+bool BenchmarkEndianSwap(const EndianSwapPlan& plan, const void* data, u32 size, EndianSwapBenchmark* out)
+{
+    std::vector<u8> scalar(static_cast<const u8*>(data), static_cast<const u8*>(data) + size);
+    std::vector<u8> simd(scalar);
+
+    out->byte_num = plan.getByteNum();
+    out->span_num = plan.getSpanNum();
+
+    u64 start = Trace::now();
+    const EndianSwapPlan::Result scalar_result = plan.applyScalar(scalar.data(), size);
+    out->scalar_ns = Trace::now() - start;
+
+    start = Trace::now();
+    const EndianSwapPlan::Result simd_result = plan.apply(simd.data(), size);
+    out->simd_ns = Trace::now() - start;
+
+    out->matched = scalar_result == simd_result && scalar == simd;
+
+    const std::vector<u8> swapped(simd);
+    out->idempotent = plan.apply(simd.data(), size) == EndianSwapPlan::RESULT_ALREADY_HOST && simd == swapped;
+
+    return simd_result == EndianSwapPlan::RESULT_SWAPPED;
+}
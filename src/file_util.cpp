@@ -0,0 +1,100 @@
+#include <file_util.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+u64 HashBytes(const u8* data, u32 size)
+{
+    u64 hash = HashMix(0, size);
+
+    u32 i = 0;
+    for (; i + sizeof(u64) <= size; i += sizeof(u64))
+    {
+        u64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = HashMix(hash, word);
+    }
+
+    if (i < size)
+    {
+        u64 word = 0;
+        std::memcpy(&word, data + i, size - i);
+        hash = HashMix(hash, word);
+    }
+
+    return hash;
+}
+
+bool ReadWholeFile(const std::string& path, std::vector<u8>* data)
+{
+    std::ifstream in(path, std::ifstream::binary | std::ifstream::ate);
+    if (!in)
+        return false;
+
+    data->resize(in.tellg());
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data->data()), data->size());
+
+    return bool(in);
+}
+
+bool WriteFileAtomic(const std::string& path, const u8* data, u32 size)
+{
+    const std::filesystem::path final_path(path);
+    std::filesystem::path temp_path(final_path);
+    temp_path += ".tmp";
+
+    std::error_code error;
+    if (final_path.has_parent_path())
+        std::filesystem::create_directories(final_path.parent_path(), error);
+
+    {
+        std::ofstream out(temp_path, std::ofstream::binary | std::ofstream::trunc);
+        if (!out)
+            return false;
+
+        out.write(reinterpret_cast<const char*>(data), size);
+
+        if (!out)
+        {
+            out.close();
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, final_path, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
+
+std::string EscapeJson(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (u8(c) < 0x20)
+        {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", u8(c));
+            escaped += code;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
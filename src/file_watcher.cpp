@@ -0,0 +1,235 @@
+#include <file_watcher.h>
+#include <trace.h>
+
+#include <filesystem>
+
+#if RIO_IS_WIN
+    #include <GLFW/glfw3.h>
+
+    #ifdef _WIN32
+        #include <windows.h>
+    #elif defined(__linux__)
+        #include <poll.h>
+        #include <sys/inotify.h>
+        #include <unistd.h>
+    #endif // _WIN32
+#endif // RIO_IS_WIN
+
+#if RIO_IS_WIN && (defined(_WIN32) || defined(__linux__))
+    #define FILE_WATCHER_SUPPORTED 1
+#else
+    #define FILE_WATCHER_SUPPORTED 0
+#endif // RIO_IS_WIN
+
+#if FILE_WATCHER_SUPPORTED
+static constexpr u32 cEventBufferSize = 16 * 1024;
+#endif // FILE_WATCHER_SUPPORTED
+
+#if RIO_IS_WIN && defined(__linux__)
+static constexpr s32 cPollTimeout = 100;    // Milliseconds between checks for stop()
+#endif // RIO_IS_WIN
+
+FileWatcher::FileWatcher()
+    : mChangeTime(0)
+    , mEventNum(0)
+    , mExit(false)
+    , mpDirectory(nullptr)
+    , mpStopEvent(nullptr)
+    , mNotifyFd(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::isSupported()
+{
+    return FILE_WATCHER_SUPPORTED;
+}
+
+bool FileWatcher::start(const std::string& path)
+{
+    stop();
+
+    const std::filesystem::path file_path(path);
+    mDirectory = file_path.has_parent_path() ? file_path.parent_path().string() : std::string(".");
+    mFileName = file_path.filename().string();
+
+#if RIO_IS_WIN
+    #ifdef _WIN32
+    HANDLE directory = CreateFileA(mDirectory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directory == INVALID_HANDLE_VALUE)
+        return false;
+
+    mpDirectory = directory;
+    mpStopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    #elif defined(__linux__)
+    mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mNotifyFd < 0)
+        return false;
+
+    // Whole-file replacements show up as IN_MOVED_TO or IN_CREATE
+    if (inotify_add_watch(mNotifyFd, mDirectory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        close(mNotifyFd);
+        mNotifyFd = -1;
+        return false;
+    }
+    #endif // _WIN32
+#endif // RIO_IS_WIN
+
+    if (!FILE_WATCHER_SUPPORTED)
+        return false;
+
+    mExit = false;
+    mThread = std::thread(&FileWatcher::workerMain_, this);
+
+    RIO_LOG("FileWatcher: watching %s\n", path.c_str());
+    return true;
+}
+
+void FileWatcher::stop()
+{
+    if (mThread.joinable())
+    {
+        mExit = true;
+
+#if RIO_IS_WIN && defined(_WIN32)
+        SetEvent(mpStopEvent);
+#endif // RIO_IS_WIN
+
+        mThread.join();
+    }
+
+#if RIO_IS_WIN
+    #ifdef _WIN32
+    if (mpDirectory)
+        CloseHandle(mpDirectory);
+    if (mpStopEvent)
+        CloseHandle(mpStopEvent);
+    #elif defined(__linux__)
+    if (mNotifyFd >= 0)
+        close(mNotifyFd);
+    #endif // _WIN32
+#endif // RIO_IS_WIN
+
+    mpDirectory = nullptr;
+    mpStopEvent = nullptr;
+    mNotifyFd = -1;
+    mChangeTime = 0;
+}
+
+bool FileWatcher::poll()
+{
+    u64 change_time = mChangeTime.load();
+    if (change_time == 0 || Trace::now() - change_time < cSettleTime)
+        return false;
+
+    // Fails if another event came in since the load, which restarts the wait
+    return mChangeTime.compare_exchange_strong(change_time, 0);
+}
+
+void FileWatcher::notify_()
+{
+    mChangeTime = Trace::now();
+    mEventNum++;
+
+#if RIO_IS_WIN
+    // Ends an idle glfwWaitEventsTimeout() on the main thread
+    glfwPostEmptyEvent();
+#endif // RIO_IS_WIN
+}
+
+void FileWatcher::workerMain_()
+{
+#if RIO_IS_WIN
+    #ifdef _WIN32
+    const std::wstring file_name = std::filesystem::path(mFileName).wstring();
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    alignas(DWORD) u8 buffer[cEventBufferSize];
+
+    while (!mExit)
+    {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(mpDirectory, buffer, sizeof(buffer), FALSE,
+                                   FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                   nullptr, &overlapped, nullptr))
+        {
+            RIO_LOG("FileWatcher: ReadDirectoryChangesW failed (%lu)\n", GetLastError());
+            break;
+        }
+
+        HANDLE handles[2] = { overlapped.hEvent, mpStopEvent };
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+        {
+            DWORD byte_num;
+            CancelIo(mpDirectory);
+            GetOverlappedResult(mpDirectory, &overlapped, &byte_num, TRUE);
+            break;
+        }
+
+        DWORD byte_num = 0;
+        if (!GetOverlappedResult(mpDirectory, &overlapped, &byte_num, FALSE))
+            break;
+
+        // The buffer overflowed and the events were lost, assume the file is among them
+        if (byte_num == 0)
+        {
+            notify_();
+            continue;
+        }
+
+        for (u32 offset = 0; ; )
+        {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+            const s32 name_length = info->FileNameLength / sizeof(WCHAR);
+
+            if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME &&
+                CompareStringOrdinal(info->FileName, name_length, file_name.c_str(), s32(file_name.size()), TRUE) == CSTR_EQUAL)
+            {
+                notify_();
+            }
+
+            if (info->NextEntryOffset == 0)
+                break;
+
+            offset += info->NextEntryOffset;
+        }
+    }
+
+    CloseHandle(overlapped.hEvent);
+    #elif defined(__linux__)
+    alignas(inotify_event) u8 buffer[cEventBufferSize];
+
+    while (!mExit)
+    {
+        pollfd fd = { mNotifyFd, POLLIN, 0 };
+        if (::poll(&fd, 1, cPollTimeout) <= 0)
+            continue;
+
+        for (;;)
+        {
+            const ssize_t size = read(mNotifyFd, buffer, sizeof(buffer));
+            if (size <= 0)
+                break;
+
+            for (ssize_t offset = 0; offset < size; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+
+                if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && mFileName == event->name))
+                    notify_();
+
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+    #endif // _WIN32
+#endif // RIO_IS_WIN
+}
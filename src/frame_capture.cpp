@@ -0,0 +1,278 @@
+#include <frame_capture.h>
+#include <image_writer.h>
+#include <trace.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#if RIO_IS_WIN
+    #include <globals.hpp>
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+FrameCapture::FrameCapture()
+    : mCapturing(false)
+    , mpColorTexture(nullptr)
+    , mpDepthTexture(nullptr)
+    , mReadbackIndex(0)
+    , mWrittenNum(0)
+    , mFailedNum(0)
+{
+    std::memset(mReadback, 0, sizeof(mReadback));
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+bool FrameCapture::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+bool FrameCapture::start(const Settings& settings)
+{
+    if (mCapturing || !isSupported())
+        return false;
+
+    if (settings.width <= 0 || settings.height <= 0)
+        return false;
+
+    if (settings.format == FORMAT_SINK)
+    {
+        if (!settings.sink)
+            return false;
+    }
+    else
+    {
+        std::error_code error;
+        std::filesystem::create_directories(settings.directory, error);
+        if (error)
+        {
+            RIO_LOG("FrameCapture: could not create %s\n", settings.directory.c_str());
+            return false;
+        }
+    }
+
+    mSettings = settings;
+
+    mpColorTexture = new rio::Texture2D(rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM, settings.width, settings.height, 1);
+    mpDepthTexture = new rio::Texture2D(rio::DEPTH_TEXTURE_FORMAT_R32_FLOAT, settings.width, settings.height, 1);
+
+    mRenderBuffer.setRenderTargetColor(&mColorTarget);
+    mRenderBuffer.setRenderTargetDepth(&mDepthTarget);
+    mRenderBuffer.setSize(settings.width, settings.height);
+    mColorTarget.linkTexture2D(*mpColorTexture);
+    mDepthTarget.linkTexture2D(*mpDepthTexture);
+
+#if RIO_IS_WIN
+    const u32 frame_size = settings.width * settings.height * 4;
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        Readback& readback = mReadback[i];
+        RIO_GL_CALL(glGenBuffers(1, &readback.buffer));
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+        RIO_GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ));
+        readback.fence = nullptr;
+    }
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+#endif // RIO_IS_WIN
+
+    mpThreadPool.reset(new ThreadPool());
+
+    mReadbackIndex = 0;
+    mWrittenNum = 0;
+    mFailedNum = 0;
+    std::memset(&mStats, 0, sizeof(mStats));
+    mCapturing = true;
+
+    RIO_LOG("FrameCapture: %dx%d to %s on %u threads\n", settings.width, settings.height, settings.directory.c_str(), mpThreadPool->getThreadNum());
+    return true;
+}
+
+void FrameCapture::stop()
+{
+    if (!mCapturing)
+        return;
+
+    EDITOR_TRACE_SCOPE("FrameCaptureStop");
+
+    collect_(true);
+    mpThreadPool->wait();
+    mpThreadPool.reset();
+
+#if RIO_IS_WIN
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        RIO_GL_CALL(glDeleteBuffers(1, &mReadback[i].buffer));
+        mReadback[i].buffer = 0;
+    }
+#endif // RIO_IS_WIN
+
+    delete mpColorTexture;
+    mpColorTexture = nullptr;
+    delete mpDepthTexture;
+    mpDepthTexture = nullptr;
+
+    mCapturing = false;
+
+    const Stats stats = getStats();
+    RIO_LOG("FrameCapture: %u frames captured, %u written, %u failed\n", stats.captured_num, stats.written_num, stats.failed_num);
+
+#if RIO_IS_WIN
+    if (mSettings.encode_video && mSettings.format == FORMAT_PNG && stats.written_num > 0)
+    {
+        const std::string cmd = "ffmpeg -y -framerate 60 -i \"" + mSettings.directory + "/frame_%05d.png\" -c:v libx264 -pix_fmt yuv420p \"" + mSettings.directory + "/capture.mp4\"";
+        RunCommand(cmd.c_str());
+    }
+#endif // RIO_IS_WIN
+}
+
+void FrameCapture::beginFrame(const rio::Color4f& clear_color)
+{
+    RIO_ASSERT(mCapturing);
+
+    mpColorTexture->setCompMap(0x00010203);
+    mRenderBuffer.clear(rio::RenderBuffer::CLEAR_FLAG_COLOR_DEPTH, clear_color);
+    mRenderBuffer.bind();
+}
+
+void FrameCapture::endFrame()
+{
+    RIO_ASSERT(mCapturing);
+
+    EDITOR_TRACE_SCOPE("FrameCaptureReadback");
+
+    // Hand finished readbacks to the workers first, which frees their slots
+    collect_(false);
+
+#if RIO_IS_WIN
+    Readback& readback = mReadback[mReadbackIndex];
+    if (readback.fence)
+    {
+        // The GPU is more than cReadbackNum frames behind
+        mStats.readback_stall_num++;
+        collect_(true);
+    }
+
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+    RIO_GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    RIO_GL_CALL(glReadPixels(0, 0, mSettings.width, mSettings.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.frame = mStats.captured_num;
+#endif // RIO_IS_WIN
+
+    mReadbackIndex = (mReadbackIndex + 1) % cReadbackNum;
+    mStats.captured_num++;
+}
+
+FrameCapture::Stats FrameCapture::getStats() const
+{
+    Stats stats = mStats;
+    stats.written_num = mWrittenNum;
+    stats.failed_num = mFailedNum;
+    return stats;
+}
+
+void FrameCapture::collect_(bool wait)
+{
+#if RIO_IS_WIN
+    const u32 frame_size = mSettings.width * mSettings.height * 4;
+
+    // Oldest first, so frames reach the workers in order
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        Readback& readback = mReadback[(mReadbackIndex + i) % cReadbackNum];
+        if (!readback.fence)
+            continue;
+
+        GLsync fence = static_cast<GLsync>(readback.fence);
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            if (!wait)
+                break;
+
+            do
+            {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            while (status == GL_TIMEOUT_EXPIRED);
+        }
+
+        RIO_GL_CALL(glDeleteSync(fence));
+        readback.fence = nullptr;
+
+        // Bound the memory held by frames waiting to be encoded
+        if (mpThreadPool->getPendingNum() >= cPendingJobMax)
+        {
+            mStats.encode_stall_num++;
+            mpThreadPool->waitPending(cPendingJobMax / 2 - 1);
+        }
+
+        std::unique_ptr<u8[]> pixels(new u8[frame_size]);
+
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_size, GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            std::memcpy(pixels.get(), mapped, frame_size);
+            RIO_GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        if (mapped)
+            encode_(readback.frame, std::move(pixels));
+        else
+            mFailedNum++;
+    }
+#endif // RIO_IS_WIN
+}
+
+void FrameCapture::encode_(u32 frame, std::unique_ptr<u8[]> pixels)
+{
+    const std::string path = mSettings.format == FORMAT_SINK ? std::string() : getFramePath_(frame);
+    const Format format = mSettings.format;
+    const s32 width = mSettings.width;
+    const s32 height = mSettings.height;
+    const Sink sink = mSettings.sink;
+
+    // std::function needs a copyable callable
+    u8* data = pixels.release();
+
+    mpThreadPool->submit([this, frame, path, format, width, height, sink, data]()
+    {
+        // Rows come back in texture order, which is also the order the view
+        // displays them top to bottom, so no flip is needed
+        bool written;
+        if (format == FORMAT_PNG)
+            written = WritePng(path.c_str(), data, width, height, width * 4);
+        else if (format == FORMAT_RAW)
+            written = WriteRawImage(path.c_str(), data, width * height * 4);
+        else
+            written = sink(frame, data, width, height);
+
+        delete[] data;
+
+        if (written)
+            mWrittenNum++;
+        else
+            mFailedNum++;
+    });
+}
+
+std::string FrameCapture::getFramePath_(u32 frame) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%05u.%s", frame, mSettings.format == FORMAT_PNG ? "png" : "rgba");
+    return mSettings.directory + "/" + name;
+}
@@ -0,0 +1,331 @@
+#include <geometry_cache.h>
+#include <stream_buffer.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include <math/rio_Math.h>
+
+#if RIO_IS_WIN
+    #include <gl_program.hpp>
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+// Attribute locations, must match geometry_cache.vert
+enum
+{
+    ATTRIB_VERTEX       = 0,
+    ATTRIB_COLOR_RATE   = 1,
+    ATTRIB_ARC_POS      = 2,
+    ATTRIB_WVP          = 3,    // Four rows
+    ATTRIB_COLOR0       = 7,
+    ATTRIB_COLOR1       = 8,
+    ATTRIB_ARC          = 9
+};
+
+#if RIO_IS_WIN
+
+// glVertexAttribPointer rather than separate attribute formats and bindings,
+// which would need GL 4.3
+static inline void SetAttribPointer(u32 attrib, s32 size, u32 stride, uintptr_t offset)
+{
+    RIO_GL_CALL(glVertexAttribPointer(attrib, size, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset)));
+}
+
+#endif // RIO_IS_WIN
+
+GeometryCache::GeometryCache()
+    : mpStreamBuffer(nullptr)
+    , mProgram(0)
+    , mVertexArray(0)
+    , mDrawing(false)
+    , mStats{ 0, 0, 0 }
+{
+    std::memset(mViewProj, 0, sizeof(mViewProj));
+}
+
+GeometryCache::~GeometryCache()
+{
+    finalize();
+}
+
+bool GeometryCache::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+void GeometryCache::initialize(StreamBuffer* stream_buffer)
+{
+    if (isInitialized() || !isSupported())
+        return;
+
+#if RIO_IS_WIN
+    mProgram = CreateProgramFromContent("shaders/geometry_cache.vert", "shaders/geometry_cache.frag");
+    if (!mProgram)
+        return;
+
+    RIO_GL_CALL(glGenVertexArrays(1, &mVertexArray));
+    RIO_GL_CALL(glBindVertexArray(mVertexArray));
+
+    for (u32 attrib = ATTRIB_VERTEX; attrib <= ATTRIB_ARC; attrib++)
+        RIO_GL_CALL(glEnableVertexAttribArray(attrib));
+
+    // Pointers are set per draw, since the instance range moves with each batch
+    for (u32 attrib = ATTRIB_WVP; attrib <= ATTRIB_ARC; attrib++)
+        RIO_GL_CALL(glVertexAttribDivisor(attrib, 1));
+
+    RIO_GL_CALL(glBindVertexArray(0));
+#endif // RIO_IS_WIN
+
+    mpStreamBuffer = stream_buffer;
+}
+
+void GeometryCache::finalize()
+{
+    if (!isInitialized())
+        return;
+
+#if RIO_IS_WIN
+    for (const Mesh& mesh : mMeshes)
+    {
+        RIO_GL_CALL(glDeleteBuffers(1, &mesh.vertex_buffer));
+        RIO_GL_CALL(glDeleteBuffers(1, &mesh.index_buffer));
+    }
+
+    RIO_GL_CALL(glDeleteVertexArrays(1, &mVertexArray));
+    DestroyProgram(mProgram);
+#endif // RIO_IS_WIN
+
+    mMeshes.clear();
+    mQueue.clear();
+    mVertexArray = 0;
+    mProgram = 0;
+    mpStreamBuffer = nullptr;
+    mStats.mesh_num = 0;
+}
+
+GeometryCache::MeshHandle GeometryCache::addMesh(PrimitiveType type, const Vertex* vertices, u32 vertex_num, const u16* indices, u32 index_num)
+{
+    if (!isInitialized())
+        return cInvalidMesh;
+
+    RIO_ASSERT(vertex_num <= 0x10000);
+
+    Mesh mesh;
+    mesh.index_num = index_num;
+    mesh.vertex_buffer = 0;
+    mesh.index_buffer = 0;
+    mesh.mode = 0;
+
+#if RIO_IS_WIN
+    mesh.mode = type == PRIMITIVE_TYPE_LINES ? GL_LINES : GL_TRIANGLES;
+
+    RIO_GL_CALL(glGenBuffers(1, &mesh.vertex_buffer));
+    RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer));
+    RIO_GL_CALL(glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertex_num, vertices, GL_STATIC_DRAW));
+    RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    RIO_GL_CALL(glGenBuffers(1, &mesh.index_buffer));
+    RIO_GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer));
+    RIO_GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u16) * index_num, indices, GL_STATIC_DRAW));
+    RIO_GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+#endif // RIO_IS_WIN
+
+    mMeshes.push_back(mesh);
+    mStats.mesh_num = mMeshes.size();
+
+    return mMeshes.size() - 1;
+}
+
+GeometryCache::MeshHandle GeometryCache::addSphere8x16()
+{
+    static constexpr u32 cLatNum = 8;
+    static constexpr u32 cLonNum = 16;
+
+    std::vector<Vertex> vertices;
+    std::vector<u16> indices;
+
+    for (u32 lat = 0; lat <= cLatNum; lat++)
+    {
+        const f32 theta = rio::Mathf::pi() * lat / cLatNum;
+        const f32 y = std::cos(theta);
+        const f32 r = std::sin(theta);
+
+        for (u32 lon = 0; lon <= cLonNum; lon++)
+        {
+            const f32 phi = rio::Mathf::pi2() * lon / cLonNum;
+
+            Vertex vertex;
+            vertex.pos[0] = r * std::cos(phi);
+            vertex.pos[1] = y;
+            vertex.pos[2] = r * std::sin(phi);
+            vertex.color_rate = (1.0f - y) * 0.5f;
+            vertex.arc = -1.0f;
+            vertices.push_back(vertex);
+        }
+    }
+
+    for (u32 lat = 0; lat < cLatNum; lat++)
+    {
+        for (u32 lon = 0; lon < cLonNum; lon++)
+        {
+            const u16 i0 = lat * (cLonNum + 1) + lon;
+            const u16 i1 = i0 + cLonNum + 1;
+
+            indices.push_back(i0);
+            indices.push_back(i1);
+            indices.push_back(i0 + 1);
+
+            indices.push_back(i0 + 1);
+            indices.push_back(i1);
+            indices.push_back(i1 + 1);
+        }
+    }
+
+    return addMesh(PRIMITIVE_TYPE_TRIANGLES, vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+void GeometryCache::begin(const rio::Matrix44f& proj, const rio::Matrix34f& view)
+{
+    RIO_ASSERT(!mDrawing);
+
+    // view is affine, its implicit last row is (0, 0, 0, 1)
+    for (u32 i = 0; i < 4; i++)
+    {
+        for (u32 j = 0; j < 4; j++)
+        {
+            f32 value = j == 3 ? proj.m[i][3] : 0.0f;
+            for (u32 k = 0; k < 3; k++)
+                value += proj.m[i][k] * view.m[k][j];
+
+            mViewProj[i][j] = value;
+        }
+    }
+
+    mQueue.clear();
+    mDrawing = true;
+}
+
+void GeometryCache::draw(MeshHandle mesh, const rio::Matrix34f& model, const rio::Color4f& color0, const rio::Color4f& color1, f32 arc_start, f32 arc_length)
+{
+    if (!mDrawing || mesh >= mMeshes.size())
+        return;
+
+    Queued queued;
+    queued.mesh = mesh;
+    queued.order = mQueue.size();
+
+    Instance& instance = queued.instance;
+    for (u32 i = 0; i < 4; i++)
+    {
+        for (u32 j = 0; j < 4; j++)
+        {
+            f32 value = j == 3 ? mViewProj[i][3] : 0.0f;
+            for (u32 k = 0; k < 3; k++)
+                value += mViewProj[i][k] * model.m[k][j];
+
+            instance.wvp[i][j] = value;
+        }
+    }
+
+    instance.color0[0] = color0.r;
+    instance.color0[1] = color0.g;
+    instance.color0[2] = color0.b;
+    instance.color0[3] = color0.a;
+    instance.color1[0] = color1.r;
+    instance.color1[1] = color1.g;
+    instance.color1[2] = color1.b;
+    instance.color1[3] = color1.a;
+    instance.arc[0] = arc_start;
+    instance.arc[1] = arc_length;
+    instance.arc[2] = 0.0f;
+    instance.arc[3] = 0.0f;
+
+    mQueue.push_back(queued);
+}
+
+void GeometryCache::end()
+{
+    RIO_ASSERT(mDrawing);
+    mDrawing = false;
+
+    mStats.instance_num = 0;
+    mStats.draw_num = 0;
+
+    if (mQueue.empty())
+        return;
+
+    EDITOR_TRACE_SCOPE("GeometryCache");
+
+    // Group instances of the same mesh, keeping submission order within a mesh
+    std::sort(mQueue.begin(), mQueue.end(), [](const Queued& a, const Queued& b) {
+        if (a.mesh != b.mesh)
+            return a.mesh < b.mesh;
+        return a.order < b.order;
+    });
+
+    u32 base_offset = 0;
+    Instance* instances = static_cast<Instance*>(mpStreamBuffer->allocate(sizeof(Instance) * mQueue.size(), 16, &base_offset));
+    if (!instances)
+    {
+        RIO_LOG("GeometryCache: stream buffer full, dropping %u instances\n", u32(mQueue.size()));
+        mQueue.clear();
+        return;
+    }
+
+    for (u32 i = 0; i < mQueue.size(); i++)
+        instances[i] = mQueue[i].instance;
+
+    mpStreamBuffer->flush();
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glUseProgram(mProgram));
+    RIO_GL_CALL(glBindVertexArray(mVertexArray));
+
+    u32 first = 0;
+    while (first < mQueue.size())
+    {
+        const MeshHandle handle = mQueue[first].mesh;
+
+        u32 count = 1;
+        while (first + count < mQueue.size() && mQueue[first + count].mesh == handle)
+            count++;
+
+        const Mesh& mesh = mMeshes[handle];
+
+        RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer));
+        SetAttribPointer(ATTRIB_VERTEX, 3, sizeof(Vertex), offsetof(Vertex, pos));
+        SetAttribPointer(ATTRIB_COLOR_RATE, 1, sizeof(Vertex), offsetof(Vertex, color_rate));
+        SetAttribPointer(ATTRIB_ARC_POS, 1, sizeof(Vertex), offsetof(Vertex, arc));
+
+        const uintptr_t instance_offset = base_offset + sizeof(Instance) * first;
+
+        RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, GLuint(mpStreamBuffer->getNativeHandle())));
+        for (u32 i = 0; i < 4; i++)
+            SetAttribPointer(ATTRIB_WVP + i, 4, sizeof(Instance), instance_offset + offsetof(Instance, wvp) + sizeof(f32) * 4 * i);
+        SetAttribPointer(ATTRIB_COLOR0, 4, sizeof(Instance), instance_offset + offsetof(Instance, color0));
+        SetAttribPointer(ATTRIB_COLOR1, 4, sizeof(Instance), instance_offset + offsetof(Instance, color1));
+        SetAttribPointer(ATTRIB_ARC, 2, sizeof(Instance), instance_offset + offsetof(Instance, arc));
+
+        RIO_GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer));
+        RIO_GL_CALL(glDrawElementsInstanced(mesh.mode, mesh.index_num, GL_UNSIGNED_SHORT, nullptr, count));
+
+        mStats.draw_num++;
+        first += count;
+    }
+
+    RIO_GL_CALL(glBindVertexArray(0));
+    RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    RIO_GL_CALL(glUseProgram(0));
+#endif // RIO_IS_WIN
+
+    mStats.instance_num = mQueue.size();
+    mQueue.clear();
+}
@@ -0,0 +1,965 @@
+#include <gx2_surface.h>
+#include <simd.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstring>
+
+// Wii U GPU configuration, as AddrLib sees it
+static constexpr u32 cPipeNum = 2;
+static constexpr u32 cBankNum = 4;
+static constexpr u32 cPipeBitNum = 1;
+static constexpr u32 cBankBitNum = 2;
+static constexpr u32 cGroupBitNum = 8;          // 256 byte pipe interleave
+static constexpr u32 cSwapSize = 256;
+static constexpr u32 cRowSize = 2048;
+
+// Low six bits of GX2SurfaceFormat
+enum FormatType
+{
+    FORMAT_TYPE_R8              = 0x01,
+    FORMAT_TYPE_R4_G4           = 0x02,
+    FORMAT_TYPE_R8_G8           = 0x07,
+    FORMAT_TYPE_R5_G6_B5        = 0x08,
+    FORMAT_TYPE_R5_G5_B5_A1     = 0x0A,
+    FORMAT_TYPE_R4_G4_B4_A4     = 0x0B,
+    FORMAT_TYPE_R10_G10_B10_A2  = 0x19,
+    FORMAT_TYPE_R8_G8_B8_A8     = 0x1A,
+    FORMAT_TYPE_BC1             = 0x31,
+    FORMAT_TYPE_BC2             = 0x32,
+    FORMAT_TYPE_BC3             = 0x33,
+    FORMAT_TYPE_BC4             = 0x34,
+    FORMAT_TYPE_BC5             = 0x35
+};
+
+static constexpr u32 cFormatTypeMask = 0x3F;
+static constexpr u32 cFormatSignedFlag = 0x200;
+
+enum TileMode
+{
+    TILE_MODE_DEFAULT           = 0,
+    TILE_MODE_LINEAR_ALIGNED    = 1,
+    TILE_MODE_1D_TILED_THIN1    = 2,
+    TILE_MODE_1D_TILED_THICK    = 3,
+    TILE_MODE_2D_TILED_THIN1    = 4,
+    TILE_MODE_2D_TILED_THIN2    = 5,
+    TILE_MODE_2D_TILED_THIN4    = 6,
+    TILE_MODE_2D_TILED_THICK    = 7,
+    TILE_MODE_2B_TILED_THIN1    = 8,
+    TILE_MODE_2B_TILED_THIN2    = 9,
+    TILE_MODE_2B_TILED_THIN4    = 10,
+    TILE_MODE_2B_TILED_THICK    = 11,
+    TILE_MODE_3D_TILED_THIN1    = 12,
+    TILE_MODE_3D_TILED_THICK    = 13,
+    TILE_MODE_3B_TILED_THIN1    = 14,
+    TILE_MODE_3B_TILED_THICK    = 15,
+    TILE_MODE_LINEAR_SPECIAL    = 16
+};
+
+static inline bool IsLinear(u32 tile_mode)
+{
+    return tile_mode == TILE_MODE_DEFAULT || tile_mode == TILE_MODE_LINEAR_ALIGNED || tile_mode == TILE_MODE_LINEAR_SPECIAL;
+}
+
+static inline bool IsThick(u32 tile_mode)
+{
+    return tile_mode == TILE_MODE_1D_TILED_THICK || tile_mode == TILE_MODE_2D_TILED_THICK || tile_mode == TILE_MODE_2B_TILED_THICK ||
+           tile_mode == TILE_MODE_3D_TILED_THICK || tile_mode == TILE_MODE_3B_TILED_THICK;
+}
+
+static inline bool IsBankSwapped(u32 tile_mode)
+{
+    return tile_mode == TILE_MODE_2B_TILED_THIN1 || tile_mode == TILE_MODE_2B_TILED_THIN2 || tile_mode == TILE_MODE_2B_TILED_THIN4 ||
+           tile_mode == TILE_MODE_3B_TILED_THIN1;
+}
+
+static inline u32 GetMacroTileAspectRatio(u32 tile_mode)
+{
+    switch (tile_mode)
+    {
+    case TILE_MODE_2D_TILED_THIN2:
+    case TILE_MODE_2B_TILED_THIN2:
+        return 2;
+    case TILE_MODE_2D_TILED_THIN4:
+    case TILE_MODE_2B_TILED_THIN4:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+// Index of element (x, y) within its 8x8 micro tile
+static inline u32 GetPixelIndexWithinMicroTile(u32 x, u32 y, u32 bpp)
+{
+    u32 b0, b1, b2, b3, b4, b5;
+
+    switch (bpp)
+    {
+    case 8:
+        b0 = x & 1; b1 = (x & 2) >> 1; b2 = (x & 4) >> 2;
+        b3 = (y & 2) >> 1; b4 = y & 1; b5 = (y & 4) >> 2;
+        break;
+    case 16:
+        b0 = x & 1; b1 = (x & 2) >> 1; b2 = (x & 4) >> 2;
+        b3 = y & 1; b4 = (y & 2) >> 1; b5 = (y & 4) >> 2;
+        break;
+    case 64:
+        b0 = x & 1; b1 = y & 1; b2 = (x & 2) >> 1;
+        b3 = (x & 4) >> 2; b4 = (y & 2) >> 1; b5 = (y & 4) >> 2;
+        break;
+    case 128:
+        b0 = y & 1; b1 = x & 1; b2 = (x & 2) >> 1;
+        b3 = (x & 4) >> 2; b4 = (y & 2) >> 1; b5 = (y & 4) >> 2;
+        break;
+    default:    // 32
+        b0 = x & 1; b1 = (x & 2) >> 1; b2 = y & 1;
+        b3 = (x & 4) >> 2; b4 = (y & 2) >> 1; b5 = (y & 4) >> 2;
+        break;
+    }
+
+    return b0 | b1 << 1 | b2 << 2 | b3 << 3 | b4 << 4 | b5 << 5;
+}
+
+static inline u32 GetBankSwappedWidth(u32 tile_mode, u32 bpp, u32 pitch)
+{
+    if (!IsBankSwapped(tile_mode))
+        return 0;
+
+    const u32 bytes_per_sample = 8 * bpp;
+    const u32 bytes_per_tile_slice = bytes_per_sample;
+
+    const u32 swap_tiles = std::max<u32>(1, (cSwapSize >> 1) / bpp);
+    const u32 swap_width = swap_tiles * 8 * cBankNum;
+    const u32 height_bytes = GetMacroTileAspectRatio(tile_mode) * cPipeNum * bpp;
+    const u32 swap_max = cPipeNum * cBankNum * cRowSize / height_bytes;
+    const u32 swap_min = (1 << cGroupBitNum) * 8 * cBankNum / bytes_per_tile_slice;
+
+    u32 bank_swap_width = std::min(swap_max, std::max(swap_min, swap_width));
+    while (bank_swap_width >= 2 * pitch)
+        bank_swap_width >>= 1;
+
+    return bank_swap_width;
+}
+
+static u32 ComputeMicroTiledOffset(u32 x, u32 y, u32 bpp, u32 pitch)
+{
+    const u32 micro_tile_bytes = 64 * bpp / 8;
+    const u32 micro_tile_offset = micro_tile_bytes * ((x >> 3) + (y >> 3) * (pitch >> 3));
+
+    return micro_tile_offset + bpp * GetPixelIndexWithinMicroTile(x, y, bpp) / 8;
+}
+
+static u32 ComputeMacroTiledOffset(u32 x, u32 y, u32 bpp, u32 pitch, u32 tile_mode, u32 swizzle)
+{
+    static const u32 cBankSwapOrder[] = { 0, 1, 3, 2 };
+
+    const u32 elem_offset = bpp * GetPixelIndexWithinMicroTile(x, y, bpp) / 8;
+
+    const u32 pipe_swizzle = (swizzle >> 8) & 1;
+    const u32 bank_swizzle = (swizzle >> 9) & 3;
+
+    const u32 pipe_wo_rotation = ((y >> 3) ^ (x >> 3)) & 1;
+    const u32 bank_wo_rotation = (((y / (16 * cPipeNum)) ^ (x >> 3)) & 1) |
+                                 (((y / (8 * cPipeNum)) ^ (x >> 4)) & 1) << 1;
+
+    u32 bank_pipe = pipe_wo_rotation + cPipeNum * bank_wo_rotation;
+    bank_pipe ^= pipe_swizzle + cPipeNum * bank_swizzle;
+    bank_pipe %= cPipeNum * cBankNum;
+
+    const u32 pipe = bank_pipe % cPipeNum;
+    u32 bank = bank_pipe / cPipeNum;
+
+    const u32 aspect_ratio = GetMacroTileAspectRatio(tile_mode);
+    const u32 macro_tile_pitch = 8 * cBankNum / aspect_ratio;
+    const u32 macro_tile_height = 8 * cPipeNum * aspect_ratio;
+    const u32 macro_tiles_per_row = pitch / macro_tile_pitch;
+    const u32 macro_tile_bytes = bpp * macro_tile_height * macro_tile_pitch / 8;
+    const u32 macro_tile_index_x = x / macro_tile_pitch;
+    const u32 macro_tile_index_y = y / macro_tile_height;
+    const u32 macro_tile_offset = (macro_tile_index_x + macro_tiles_per_row * macro_tile_index_y) * macro_tile_bytes;
+
+    if (IsBankSwapped(tile_mode))
+    {
+        const u32 bank_swap_width = GetBankSwappedWidth(tile_mode, bpp, pitch);
+        const u32 swap_index = macro_tile_pitch * macro_tile_index_x / bank_swap_width;
+        bank ^= cBankSwapOrder[swap_index & (cBankNum - 1)];
+    }
+
+    const u32 group_mask = (1 << cGroupBitNum) - 1;
+    const u32 swizzle_bit_num = cBankBitNum + cPipeBitNum;
+    const u32 total_offset = elem_offset + (macro_tile_offset >> swizzle_bit_num);
+
+    return (total_offset & ~group_mask) << swizzle_bit_num |
+           bank << (cPipeBitNum + cGroupBitNum) |
+           pipe << cGroupBitNum |
+           (total_offset & group_mask);
+}
+
+bool IsGx2FormatSupported(u32 format)
+{
+    switch (format & cFormatTypeMask)
+    {
+    case FORMAT_TYPE_R8:
+    case FORMAT_TYPE_R4_G4:
+    case FORMAT_TYPE_R8_G8:
+    case FORMAT_TYPE_R5_G6_B5:
+    case FORMAT_TYPE_R5_G5_B5_A1:
+    case FORMAT_TYPE_R4_G4_B4_A4:
+    case FORMAT_TYPE_R10_G10_B10_A2:
+    case FORMAT_TYPE_R8_G8_B8_A8:
+    case FORMAT_TYPE_BC1:
+    case FORMAT_TYPE_BC2:
+    case FORMAT_TYPE_BC3:
+    case FORMAT_TYPE_BC4:
+    case FORMAT_TYPE_BC5:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool IsGx2FormatCompressed(u32 format)
+{
+    const u32 type = format & cFormatTypeMask;
+    return type >= FORMAT_TYPE_BC1 && type <= FORMAT_TYPE_BC5;
+}
+
+bool IsGx2FormatSigned(u32 format)
+{
+    return (format & cFormatSignedFlag) != 0;
+}
+
+u32 GetGx2BcIndex(u32 format)
+{
+    return IsGx2FormatCompressed(format) ? (format & cFormatTypeMask) - FORMAT_TYPE_BC1 + 1 : 0;
+}
+
+u32 GetGx2FormatBpp(u32 format)
+{
+    switch (format & cFormatTypeMask)
+    {
+    case FORMAT_TYPE_R8:
+    case FORMAT_TYPE_R4_G4:
+        return 8;
+    case FORMAT_TYPE_R8_G8:
+    case FORMAT_TYPE_R5_G6_B5:
+    case FORMAT_TYPE_R5_G5_B5_A1:
+    case FORMAT_TYPE_R4_G4_B4_A4:
+        return 16;
+    case FORMAT_TYPE_R10_G10_B10_A2:
+    case FORMAT_TYPE_R8_G8_B8_A8:
+        return 32;
+    case FORMAT_TYPE_BC1:
+    case FORMAT_TYPE_BC4:
+        return 64;
+    case FORMAT_TYPE_BC2:
+    case FORMAT_TYPE_BC3:
+    case FORMAT_TYPE_BC5:
+        return 128;
+    default:
+        return 0;
+    }
+}
+
+u32 GetGx2ElementWidth(const Gx2SurfaceInfo& info)
+{
+    return IsGx2FormatCompressed(info.format) ? (info.width + 3) / 4 : info.width;
+}
+
+u32 GetGx2ElementHeight(const Gx2SurfaceInfo& info)
+{
+    return IsGx2FormatCompressed(info.format) ? (info.height + 3) / 4 : info.height;
+}
+
+u32 ComputeGx2ElementOffset(const Gx2SurfaceInfo& info, u32 x, u32 y)
+{
+    const u32 bpp = GetGx2FormatBpp(info.format);
+
+    if (IsLinear(info.tile_mode))
+        return (y * info.pitch + x) * bpp / 8;
+
+    if (info.tile_mode == TILE_MODE_1D_TILED_THIN1)
+        return ComputeMicroTiledOffset(x, y, bpp, info.pitch);
+
+    return ComputeMacroTiledOffset(x, y, bpp, info.pitch, info.tile_mode, info.swizzle);
+}
+
+static bool CanDetile(const Gx2SurfaceInfo& info)
+{
+    if (!info.image || !IsGx2FormatSupported(info.format) || IsThick(info.tile_mode) || info.tile_mode > TILE_MODE_LINEAR_SPECIAL)
+        return false;
+
+    const u32 width = GetGx2ElementWidth(info);
+    return width != 0 && GetGx2ElementHeight(info) != 0 && info.pitch >= width;
+}
+
+// Copies the elements in [x0, x1) x [y0, y1) one at a time
+static bool DetileElements(const Gx2SurfaceInfo& info, u32 x0, u32 y0, u32 x1, u32 y1, u8* out)
+{
+    const u32 width = GetGx2ElementWidth(info);
+    const u32 bytes = GetGx2FormatBpp(info.format) / 8;
+
+    for (u32 y = y0; y < y1; y++)
+    {
+        for (u32 x = x0; x < x1; x++)
+        {
+            const u32 offset = ComputeGx2ElementOffset(info, x, y);
+            if (offset + bytes > info.image_size)
+                return false;
+
+            std::memcpy(out + (y * width + x) * bytes, info.image + offset, bytes);
+        }
+    }
+
+    return true;
+}
+
+bool DetileGx2SurfaceScalar(const Gx2SurfaceInfo& info, u8* out)
+{
+    if (!CanDetile(info))
+        return false;
+
+    return DetileElements(info, 0, 0, GetGx2ElementWidth(info), GetGx2ElementHeight(info), out);
+}
+
+// Where each row of a micro tile is in the tiled data. At 16 bpp and up a row
+// is made of 16 byte runs that are contiguous on both sides: 8, 4, 2 or 1
+// elements. At 8 bpp a row is a single 8 byte run.
+//
+// A micro tile is split into 256 byte chunks, the pipe interleave. Within a
+// chunk the tiled data is contiguous, so the address of a run is the address
+// of the first element of its chunk plus the offset of the run in the chunk.
+struct MicroTileRuns
+{
+    u32 run_bytes;
+    u32 run_num;            // Per row
+    u32 chunk_num;
+    u32 chunk_bytes;
+    u16 offset[8][8];       // [y][run], bytes from the start of the micro tile
+    u8  chunk_x[4];         // First element of each chunk
+    u8  chunk_y[4];
+};
+
+static MicroTileRuns BuildMicroTileRuns(u32 bpp)
+{
+    MicroTileRuns runs;
+    std::memset(&runs, 0, sizeof(runs));
+
+    runs.run_bytes = bpp >= 16 ? 16 : 8;
+    runs.run_num = bpp / runs.run_bytes;     // A row is bpp bytes
+    runs.chunk_bytes = std::min<u32>(1 << cGroupBitNum, 8 * bpp);
+    runs.chunk_num = 8 * bpp / runs.chunk_bytes;
+
+    const u32 run_elements = 8 / runs.run_num;
+
+    for (u32 y = 0; y < 8; y++)
+    {
+        for (u32 x = 0; x < 8; x++)
+        {
+            const u32 offset = GetPixelIndexWithinMicroTile(x, y, bpp) * bpp / 8;
+            if (x % run_elements == 0)
+                runs.offset[y][x / run_elements] = u16(offset);
+
+            if (offset % runs.chunk_bytes == 0)
+            {
+                runs.chunk_x[offset / runs.chunk_bytes] = u8(x);
+                runs.chunk_y[offset / runs.chunk_bytes] = u8(y);
+            }
+        }
+    }
+
+    return runs;
+}
+
+static const MicroTileRuns& GetMicroTileRuns(u32 bpp)
+{
+    static const MicroTileRuns cRuns[] = {
+        BuildMicroTileRuns(8), BuildMicroTileRuns(16), BuildMicroTileRuns(32), BuildMicroTileRuns(64), BuildMicroTileRuns(128)
+    };
+
+    switch (bpp)
+    {
+    case 8:     return cRuns[0];
+    case 16:    return cRuns[1];
+    case 64:    return cRuns[3];
+    case 128:   return cRuns[4];
+    default:    return cRuns[2];
+    }
+}
+
+static inline void CopyRun16(u8* dst, const u8* src)
+{
+#if EDITOR_SIMD_SSE2
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+#else
+    std::memcpy(dst, src, 16);
+#endif // EDITOR_SIMD_SSE2
+}
+
+bool DetileGx2Surface(const Gx2SurfaceInfo& info, u8* out)
+{
+    if (!CanDetile(info))
+        return false;
+
+    const u32 width = GetGx2ElementWidth(info);
+    const u32 height = GetGx2ElementHeight(info);
+    const u32 bpp = GetGx2FormatBpp(info.format);
+    const u32 bytes = bpp / 8;
+
+    if (IsLinear(info.tile_mode))
+    {
+        const u32 row_bytes = width * bytes;
+        for (u32 y = 0; y < height; y++)
+        {
+            const u32 offset = y * info.pitch * bytes;
+            if (offset + row_bytes > info.image_size)
+                return false;
+
+            std::memcpy(out + y * row_bytes, info.image + offset, row_bytes);
+        }
+        return true;
+    }
+
+    const MicroTileRuns& runs = GetMicroTileRuns(bpp);
+    const u32 row_bytes = width * bytes;
+
+    for (u32 tile_y = 0; tile_y < height; tile_y += 8)
+    {
+        for (u32 tile_x = 0; tile_x < width; tile_x += 8)
+        {
+            // Tiles cut by the edge of the surface
+            if (tile_x + 8 > width || tile_y + 8 > height)
+            {
+                if (!DetileElements(info, tile_x, tile_y, std::min(tile_x + 8, width), std::min(tile_y + 8, height), out))
+                    return false;
+
+                continue;
+            }
+
+            u32 chunk_base[4];
+            for (u32 i = 0; i < runs.chunk_num; i++)
+            {
+                const u32 offset = ComputeGx2ElementOffset(info, tile_x + runs.chunk_x[i], tile_y + runs.chunk_y[i]);
+                if (offset + runs.chunk_bytes > info.image_size)
+                    return false;
+
+                // Run offsets count from the start of the micro tile
+                chunk_base[i] = offset - i * runs.chunk_bytes;
+            }
+
+            u8* dst = out + tile_y * row_bytes + tile_x * bytes;
+
+            if (runs.run_bytes == 8)
+            {
+                for (u32 y = 0; y < 8; y++, dst += row_bytes)
+                    std::memcpy(dst, info.image + chunk_base[0] + runs.offset[y][0], 8);
+            }
+            else
+            {
+                for (u32 y = 0; y < 8; y++, dst += row_bytes)
+                {
+                    for (u32 i = 0; i < runs.run_num; i++)
+                    {
+                        const u32 offset = runs.offset[y][i];
+                        CopyRun16(dst + i * 16, info.image + chunk_base[offset / runs.chunk_bytes] + offset);
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static inline u8 Expand4(u32 value) { return u8(value << 4 | value); }
+static inline u8 Expand5(u32 value) { return u8(value << 3 | value >> 2); }
+static inline u8 Expand6(u32 value) { return u8(value << 2 | value >> 4); }
+
+static inline u16 GetU16LE(const u8* data) { return u16(data[0] | data[1] << 8); }
+
+static inline u32 GetU32LE(const u8* data)
+{
+    return u32(data[0]) | u32(data[1]) << 8 | u32(data[2]) << 16 | u32(data[3]) << 24;
+}
+
+static void DecodeBc1Colors(const u8* block, u8 colors[4][4], bool has_alpha_mode)
+{
+    const u16 c0 = GetU16LE(block);
+    const u16 c1 = GetU16LE(block + 2);
+
+    colors[0][0] = Expand5(c0 >> 11); colors[0][1] = Expand6(c0 >> 5 & 0x3F); colors[0][2] = Expand5(c0 & 0x1F); colors[0][3] = 255;
+    colors[1][0] = Expand5(c1 >> 11); colors[1][1] = Expand6(c1 >> 5 & 0x3F); colors[1][2] = Expand5(c1 & 0x1F); colors[1][3] = 255;
+
+    if (c0 > c1 || !has_alpha_mode)
+    {
+        for (u32 i = 0; i < 3; i++)
+        {
+            colors[2][i] = u8((2 * colors[0][i] + colors[1][i]) / 3);
+            colors[3][i] = u8((colors[0][i] + 2 * colors[1][i]) / 3);
+        }
+        colors[2][3] = colors[3][3] = 255;
+    }
+    else
+    {
+        for (u32 i = 0; i < 3; i++)
+        {
+            colors[2][i] = u8((colors[0][i] + colors[1][i]) / 2);
+            colors[3][i] = 0;
+        }
+        colors[2][3] = 255;
+        colors[3][3] = 0;
+    }
+}
+
+// 3-bit interpolated channel of BC3 alpha, BC4 and BC5
+static void DecodeBc4Channel(const u8* block, bool is_signed, u8 out[16])
+{
+    s32 values[8];
+
+    if (is_signed)
+    {
+        // Mapped from [-127, 127] to [1, 255] for display
+        const s32 v0 = std::max<s32>(s8(block[0]), -127);
+        const s32 v1 = std::max<s32>(s8(block[1]), -127);
+        values[0] = v0;
+        values[1] = v1;
+        if (v0 > v1)
+        {
+            for (s32 i = 1; i < 7; i++)
+                values[i + 1] = ((7 - i) * v0 + i * v1) / 7;
+        }
+        else
+        {
+            for (s32 i = 1; i < 5; i++)
+                values[i + 1] = ((5 - i) * v0 + i * v1) / 5;
+            values[6] = -127;
+            values[7] = 127;
+        }
+        for (u32 i = 0; i < 8; i++)
+            values[i] += 128;
+    }
+    else
+    {
+        const s32 v0 = block[0];
+        const s32 v1 = block[1];
+        values[0] = v0;
+        values[1] = v1;
+        if (v0 > v1)
+        {
+            for (s32 i = 1; i < 7; i++)
+                values[i + 1] = ((7 - i) * v0 + i * v1) / 7;
+        }
+        else
+        {
+            for (s32 i = 1; i < 5; i++)
+                values[i + 1] = ((5 - i) * v0 + i * v1) / 5;
+            values[6] = 0;
+            values[7] = 255;
+        }
+    }
+
+    const u64 bits = u64(block[2]) | u64(block[3]) << 8 | u64(block[4]) << 16 |
+                     u64(block[5]) << 24 | u64(block[6]) << 32 | u64(block[7]) << 40;
+
+    for (u32 i = 0; i < 16; i++)
+        out[i] = u8(values[bits >> (3 * i) & 7]);
+}
+
+static void DecodeBlock(u32 type, bool is_signed, const u8* block, u8 out[16][4])
+{
+    switch (type)
+    {
+    case FORMAT_TYPE_BC1:
+    {
+        u8 colors[4][4];
+        DecodeBc1Colors(block, colors, true);
+
+        const u32 indices = GetU32LE(block + 4);
+        for (u32 i = 0; i < 16; i++)
+            std::memcpy(out[i], colors[indices >> (2 * i) & 3], 4);
+        break;
+    }
+    case FORMAT_TYPE_BC2:
+    {
+        u8 colors[4][4];
+        DecodeBc1Colors(block + 8, colors, false);
+
+        const u32 indices = GetU32LE(block + 12);
+        for (u32 i = 0; i < 16; i++)
+        {
+            std::memcpy(out[i], colors[indices >> (2 * i) & 3], 3);
+            out[i][3] = Expand4(block[i / 2] >> (4 * (i & 1)) & 0xF);
+        }
+        break;
+    }
+    case FORMAT_TYPE_BC3:
+    {
+        u8 colors[4][4];
+        DecodeBc1Colors(block + 8, colors, false);
+
+        u8 alpha[16];
+        DecodeBc4Channel(block, false, alpha);
+
+        const u32 indices = GetU32LE(block + 12);
+        for (u32 i = 0; i < 16; i++)
+        {
+            std::memcpy(out[i], colors[indices >> (2 * i) & 3], 3);
+            out[i][3] = alpha[i];
+        }
+        break;
+    }
+    case FORMAT_TYPE_BC4:
+    {
+        u8 red[16];
+        DecodeBc4Channel(block, is_signed, red);
+
+        for (u32 i = 0; i < 16; i++)
+        {
+            out[i][0] = red[i];
+            out[i][1] = out[i][2] = 0;
+            out[i][3] = 255;
+        }
+        break;
+    }
+    case FORMAT_TYPE_BC5:
+    {
+        u8 red[16], green[16];
+        DecodeBc4Channel(block, is_signed, red);
+        DecodeBc4Channel(block + 8, is_signed, green);
+
+        for (u32 i = 0; i < 16; i++)
+        {
+            out[i][0] = red[i];
+            out[i][1] = green[i];
+            out[i][2] = 0;
+            out[i][3] = 255;
+        }
+        break;
+    }
+    }
+}
+
+// Components are packed from the least significant bit up, in R, G, B, A order
+static inline void ConvertTexel(u32 type, const u8* in, u8* out)
+{
+    switch (type)
+    {
+    case FORMAT_TYPE_R8:
+        out[0] = in[0]; out[1] = 0; out[2] = 0; out[3] = 255;
+        break;
+    case FORMAT_TYPE_R4_G4:
+        out[0] = Expand4(in[0] & 0xF); out[1] = Expand4(in[0] >> 4); out[2] = 0; out[3] = 255;
+        break;
+    case FORMAT_TYPE_R8_G8:
+        out[0] = in[0]; out[1] = in[1]; out[2] = 0; out[3] = 255;
+        break;
+    case FORMAT_TYPE_R5_G6_B5:
+    {
+        const u16 value = GetU16LE(in);
+        out[0] = Expand5(value & 0x1F); out[1] = Expand6(value >> 5 & 0x3F); out[2] = Expand5(value >> 11); out[3] = 255;
+        break;
+    }
+    case FORMAT_TYPE_R5_G5_B5_A1:
+    {
+        const u16 value = GetU16LE(in);
+        out[0] = Expand5(value & 0x1F); out[1] = Expand5(value >> 5 & 0x1F); out[2] = Expand5(value >> 10 & 0x1F); out[3] = (value >> 15) ? 255 : 0;
+        break;
+    }
+    case FORMAT_TYPE_R4_G4_B4_A4:
+    {
+        const u16 value = GetU16LE(in);
+        out[0] = Expand4(value & 0xF); out[1] = Expand4(value >> 4 & 0xF); out[2] = Expand4(value >> 8 & 0xF); out[3] = Expand4(value >> 12);
+        break;
+    }
+    case FORMAT_TYPE_R10_G10_B10_A2:
+    {
+        const u32 value = GetU32LE(in);
+        out[0] = u8((value & 0x3FF) >> 2); out[1] = u8((value >> 10 & 0x3FF) >> 2); out[2] = u8((value >> 20 & 0x3FF) >> 2); out[3] = u8((value >> 30) * 0x55);
+        break;
+    }
+    default:    // R8_G8_B8_A8
+        std::memcpy(out, in, 4);
+        break;
+    }
+}
+
+static void DecodeBlocks(u32 format, const u8* elements, u32 width, u32 height, u8* out_rgba)
+{
+    const u32 type = format & cFormatTypeMask;
+    const bool is_signed = (format & cFormatSignedFlag) != 0;
+    const u32 block_bytes = GetGx2FormatBpp(format) / 8;
+    const u32 block_width = (width + 3) / 4;
+    const u32 block_height = (height + 3) / 4;
+
+    for (u32 by = 0; by < block_height; by++)
+    {
+        for (u32 bx = 0; bx < block_width; bx++)
+        {
+            u8 texels[16][4];
+            DecodeBlock(type, is_signed, elements + (by * block_width + bx) * block_bytes, texels);
+
+            // Blocks hanging over the edge of the surface are clipped
+            const u32 copy_width = std::min<u32>(4, width - bx * 4);
+            const u32 copy_height = std::min<u32>(4, height - by * 4);
+            for (u32 y = 0; y < copy_height; y++)
+                std::memcpy(out_rgba + ((by * 4 + y) * width + bx * 4) * 4, texels[y * 4], copy_width * 4);
+        }
+    }
+}
+
+static void ConvertTexels(u32 type, const u8* in, u8* out, u32 count)
+{
+    const u32 bytes = GetGx2FormatBpp(type) / 8;
+    for (u32 i = 0; i < count; i++)
+        ConvertTexel(type, in + i * bytes, out + i * 4);
+}
+
+bool ConvertGx2ToRgba8Scalar(u32 format, const u8* elements, u32 width, u32 height, u8* out_rgba)
+{
+    if (!IsGx2FormatSupported(format))
+        return false;
+
+    if (IsGx2FormatCompressed(format))
+        DecodeBlocks(format, elements, width, height, out_rgba);
+    else
+        ConvertTexels(format & cFormatTypeMask, elements, out_rgba, width * height);
+
+    return true;
+}
+
+// Fields of a format of at most 16 bits per texel, as (shift, bits) pairs. A
+// field of 0 bits reads as 0, or 255 for alpha.
+template <u32 Bytes, u32 RShift, u32 RBits, u32 GShift, u32 GBits, u32 BShift, u32 BBits, u32 AShift, u32 ABits>
+struct PackedLayout
+{
+    static constexpr u32 cBytes = Bytes;
+    static constexpr u32 cRShift = RShift, cRBits = RBits;
+    static constexpr u32 cGShift = GShift, cGBits = GBits;
+    static constexpr u32 cBShift = BShift, cBBits = BBits;
+    static constexpr u32 cAShift = AShift, cABits = ABits;
+};
+
+typedef PackedLayout<1, 0, 8, 0, 0, 0, 0, 0, 0>     LayoutR8;
+typedef PackedLayout<1, 0, 4, 4, 4, 0, 0, 0, 0>     LayoutR4G4;
+typedef PackedLayout<2, 0, 8, 8, 8, 0, 0, 0, 0>     LayoutR8G8;
+typedef PackedLayout<2, 0, 5, 5, 6, 11, 5, 0, 0>    LayoutR5G6B5;
+typedef PackedLayout<2, 0, 5, 5, 5, 10, 5, 15, 1>   LayoutR5G5B5A1;
+typedef PackedLayout<2, 0, 4, 4, 4, 8, 4, 12, 4>    LayoutR4G4B4A4;
+
+typedef void (*ConvertTexelsFunc)(u32 type, const u8* in, u8* out, u32 count);
+
+#if EDITOR_SIMD_SSE2
+
+// Extracts a field from 16 bit lanes and widens it to 8 bits the same way as
+// Expand4(), Expand5() and Expand6()
+template <u32 Shift, u32 Bits, s16 Empty>
+static inline __m128i ExpandFieldSse2(__m128i value)
+{
+    if constexpr (Bits == 0)
+        return _mm_set1_epi16(Empty);
+    else
+    {
+        const __m128i field = _mm_and_si128(_mm_srli_epi16(value, Shift), _mm_set1_epi16((1 << Bits) - 1));
+        if constexpr (Bits == 1)
+            return _mm_mullo_epi16(field, _mm_set1_epi16(255));
+        else
+            return _mm_or_si128(_mm_slli_epi16(field, 8 - Bits), _mm_srli_epi16(field, 2 * Bits - 8));
+    }
+}
+
+// 8 texels per iteration
+template <typename Layout>
+static void ConvertPackedSse2(u32 type, const u8* in, u8* out, u32 count)
+{
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i value;
+        if constexpr (Layout::cBytes == 1)
+            value = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)), _mm_setzero_si128());
+        else
+            value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+
+        const __m128i r = ExpandFieldSse2<Layout::cRShift, Layout::cRBits, 0>(value);
+        const __m128i g = ExpandFieldSse2<Layout::cGShift, Layout::cGBits, 0>(value);
+        const __m128i b = ExpandFieldSse2<Layout::cBShift, Layout::cBBits, 0>(value);
+        const __m128i a = ExpandFieldSse2<Layout::cAShift, Layout::cABits, 255>(value);
+
+        const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+
+    ConvertTexels(type, in + i * Layout::cBytes, out + i * 4, count - i);
+}
+
+#endif // EDITOR_SIMD_SSE2
+
+#if EDITOR_SIMD_AVX2
+
+template <u32 Shift, u32 Bits, s16 Empty>
+EDITOR_SIMD_TARGET_AVX2 static inline __m256i ExpandFieldAvx2(__m256i value)
+{
+    if constexpr (Bits == 0)
+        return _mm256_set1_epi16(Empty);
+    else
+    {
+        const __m256i field = _mm256_and_si256(_mm256_srli_epi16(value, Shift), _mm256_set1_epi16((1 << Bits) - 1));
+        if constexpr (Bits == 1)
+            return _mm256_mullo_epi16(field, _mm256_set1_epi16(255));
+        else
+            return _mm256_or_si256(_mm256_slli_epi16(field, 8 - Bits), _mm256_srli_epi16(field, 2 * Bits - 8));
+    }
+}
+
+// 16 texels per iteration
+template <typename Layout>
+EDITOR_SIMD_TARGET_AVX2 static void ConvertPackedAvx2(u32 type, const u8* in, u8* out, u32 count)
+{
+    u32 i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i value;
+        if constexpr (Layout::cBytes == 1)
+            value = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        else
+            value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 2));
+
+        const __m256i r = ExpandFieldAvx2<Layout::cRShift, Layout::cRBits, 0>(value);
+        const __m256i g = ExpandFieldAvx2<Layout::cGShift, Layout::cGBits, 0>(value);
+        const __m256i b = ExpandFieldAvx2<Layout::cBShift, Layout::cBBits, 0>(value);
+        const __m256i a = ExpandFieldAvx2<Layout::cAShift, Layout::cABits, 255>(value);
+
+        const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+        const __m256i ba = _mm256_or_si256(b, _mm256_slli_epi16(a, 8));
+
+        // Unpacking works within 128 bit lanes: texels 0-3 and 8-11, 4-7 and 12-15
+        const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+        const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    ConvertTexels(type, in + i * Layout::cBytes, out + i * 4, count - i);
+}
+
+#endif // EDITOR_SIMD_AVX2
+
+template <typename Layout>
+static ConvertTexelsFunc GetPackedKernel()
+{
+#if EDITOR_SIMD_AVX2
+    if (GetSimdLevel() == SIMD_LEVEL_AVX2)
+        return &ConvertPackedAvx2<Layout>;
+#endif // EDITOR_SIMD_AVX2
+#if EDITOR_SIMD_SSE2
+    return &ConvertPackedSse2<Layout>;
+#else
+    return &ConvertTexels;
+#endif // EDITOR_SIMD_SSE2
+}
+
+static void CopyTexels(u32, const u8* in, u8* out, u32 count)
+{
+    std::memcpy(out, in, count * 4);
+}
+
+static ConvertTexelsFunc GetConvertKernel(u32 type)
+{
+    switch (type)
+    {
+    case FORMAT_TYPE_R8:            return GetPackedKernel<LayoutR8>();
+    case FORMAT_TYPE_R4_G4:         return GetPackedKernel<LayoutR4G4>();
+    case FORMAT_TYPE_R8_G8:         return GetPackedKernel<LayoutR8G8>();
+    case FORMAT_TYPE_R5_G6_B5:      return GetPackedKernel<LayoutR5G6B5>();
+    case FORMAT_TYPE_R5_G5_B5_A1:   return GetPackedKernel<LayoutR5G5B5A1>();
+    case FORMAT_TYPE_R4_G4_B4_A4:   return GetPackedKernel<LayoutR4G4B4A4>();
+    case FORMAT_TYPE_R8_G8_B8_A8:   return &CopyTexels;
+    default:                        return &ConvertTexels;
+    }
+}
+
+bool ConvertGx2ToRgba8(u32 format, const u8* elements, u32 width, u32 height, u8* out_rgba)
+{
+    if (!IsGx2FormatSupported(format))
+        return false;
+
+    // Block decoding stays scalar, BC textures are mostly uploaded as is
+    if (IsGx2FormatCompressed(format))
+    {
+        DecodeBlocks(format, elements, width, height, out_rgba);
+        return true;
+    }
+
+    const u32 type = format & cFormatTypeMask;
+    GetConvertKernel(type)(type, elements, out_rgba, width * height);
+    return true;
+}
+
+bool DecodeGx2Surface(const Gx2SurfaceInfo& info, std::vector<u8>* out_rgba)
+{
+    const u32 bpp = GetGx2FormatBpp(info.format);
+    std::vector<u8> elements(GetGx2ElementWidth(info) * GetGx2ElementHeight(info) * bpp / 8);
+
+    if (!DetileGx2Surface(info, elements.data()))
+        return false;
+
+    out_rgba->resize(info.width * info.height * 4);
+    if (!ConvertGx2ToRgba8(info.format, elements.data(), info.width, info.height, out_rgba->data()))
+        return false;
+
+#ifndef RIO_RELEASE
+    {
+        std::vector<u8> reference_elements(elements.size());
+        RIO_ASSERT(DetileGx2SurfaceScalar(info, reference_elements.data()));
+        RIO_ASSERT(reference_elements == elements);
+
+        std::vector<u8> reference_rgba(out_rgba->size());
+        RIO_ASSERT(ConvertGx2ToRgba8Scalar(info.format, reference_elements.data(), info.width, info.height, reference_rgba.data()));
+        RIO_ASSERT(reference_rgba == *out_rgba);
+    }
+#endif // RIO_RELEASE
+
+    return true;
+}
+
+bool BenchmarkGx2Surface(const Gx2SurfaceInfo& info, Gx2DecodeBenchmark* inout)
+{
+    if (!CanDetile(info))
+        return false;
+
+    const u32 element_size = GetGx2ElementWidth(info) * GetGx2ElementHeight(info) * GetGx2FormatBpp(info.format) / 8;
+    const u32 rgba_size = info.width * info.height * 4;
+
+    std::vector<u8> scalar_elements(element_size), simd_elements(element_size);
+    std::vector<u8> scalar_rgba(rgba_size), simd_rgba(rgba_size);
+
+    u64 start = Trace::now();
+    const bool scalar_detiled = DetileGx2SurfaceScalar(info, scalar_elements.data());
+    inout->detile_scalar_ns += Trace::now() - start;
+
+    start = Trace::now();
+    const bool simd_detiled = DetileGx2Surface(info, simd_elements.data());
+    inout->detile_simd_ns += Trace::now() - start;
+
+    if (!scalar_detiled || !simd_detiled)
+        return false;
+
+    start = Trace::now();
+    ConvertGx2ToRgba8Scalar(info.format, scalar_elements.data(), info.width, info.height, scalar_rgba.data());
+    inout->convert_scalar_ns += Trace::now() - start;
+
+    start = Trace::now();
+    ConvertGx2ToRgba8(info.format, simd_elements.data(), info.width, info.height, simd_rgba.data());
+    inout->convert_simd_ns += Trace::now() - start;
+
+    if (scalar_elements != simd_elements || scalar_rgba != simd_rgba)
+        inout->mismatch_num++;
+
+    inout->surface_num++;
+    inout->texel_num += u64(info.width) * info.height;
+    return true;
+}
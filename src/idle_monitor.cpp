@@ -0,0 +1,69 @@
+#include <idle_monitor.h>
+#include <trace.h>
+
+#if RIO_IS_WIN
+    #include <GLFW/glfw3.h>
+#endif // RIO_IS_WIN
+
+static constexpr u64 cStatsWindow = 1000000000;  // Nanoseconds
+
+IdleMonitor::IdleMonitor()
+    : mEnabled(true)
+    , mIdle(false)
+    , mWakeFrame(cWakeFrameNum)
+    , mWindowBegin(0)
+    , mWaitTime(0)
+    , mFrameNum(0)
+    , mRenderNum(0)
+    , mStats{ 1.0f, 0.0f, 0.0f }
+{
+}
+
+void IdleMonitor::wait()
+{
+    if (!mIdle)
+        return;
+
+    EDITOR_TRACE_SCOPE("IdleWait");
+
+    const u64 begin = Trace::now();
+
+#if RIO_IS_WIN
+    // Returns early on any window or input event
+    glfwWaitEventsTimeout(cWaitTimeout);
+#endif // RIO_IS_WIN
+
+    mWaitTime += Trace::now() - begin;
+}
+
+void IdleMonitor::update(bool busy)
+{
+    if (busy || !mEnabled)
+        mWakeFrame = cWakeFrameNum;
+    else if (mWakeFrame > 0)
+        mWakeFrame--;
+
+    mIdle = mWakeFrame == 0;
+
+    mFrameNum++;
+    if (!mIdle)
+        mRenderNum++;
+
+    const u64 now = Trace::now();
+    if (mWindowBegin == 0)
+    {
+        mWindowBegin = now;
+    }
+    else if (now - mWindowBegin >= cStatsWindow)
+    {
+        const f32 elapsed = f32(now - mWindowBegin);
+        mStats.duty_cycle = 1.0f - mWaitTime / elapsed;
+        mStats.frame_rate = mFrameNum * 1e9f / elapsed;
+        mStats.render_rate = mRenderNum * 1e9f / elapsed;
+
+        mWindowBegin = now;
+        mWaitTime = 0;
+        mFrameNum = 0;
+        mRenderNum = 0;
+    }
+}
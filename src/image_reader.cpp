@@ -0,0 +1,153 @@
+#include <image_reader.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static inline u32 GetU32BE(const u8* data)
+{
+    return u32(data[0]) << 24 | u32(data[1]) << 16 | u32(data[2]) << 8 | data[3];
+}
+
+static bool ReadWholeFile(const char* filename, std::vector<u8>* out_data)
+{
+    std::FILE* file = std::fopen(filename, "rb");
+    if (!file)
+        return false;
+
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+
+    bool read = size > 0;
+    if (read)
+    {
+        out_data->resize(size);
+        read = std::fread(out_data->data(), 1, size, file) == size_t(size);
+    }
+
+    std::fclose(file);
+    return read;
+}
+
+// Undoes stored deflate blocks of a zlib stream
+static bool InflateStored(const std::vector<u8>& zlib, std::vector<u8>* out_data)
+{
+    if (zlib.size() < 6 || (zlib[0] & 0x0F) != 8)
+        return false;
+
+    size_t pos = 2;
+    for (;;)
+    {
+        if (pos + 5 > zlib.size())
+            return false;
+
+        const u8 header = zlib[pos];
+        if ((header & 0x06) != 0)
+            return false;   // Compressed block
+
+        const u32 len = zlib[pos + 1] | zlib[pos + 2] << 8;
+        const u32 nlen = zlib[pos + 3] | zlib[pos + 4] << 8;
+        if ((len ^ 0xFFFF) != nlen || pos + 5 + len > zlib.size())
+            return false;
+
+        out_data->insert(out_data->end(), zlib.begin() + pos + 5, zlib.begin() + pos + 5 + len);
+        pos += 5 + len;
+
+        if (header & 1)
+            return true;
+    }
+}
+
+static inline u8 Paeth(u8 a, u8 b, u8 c)
+{
+    const s32 p = s32(a) + b - c;
+    const s32 pa = std::abs(p - a);
+    const s32 pb = std::abs(p - b);
+    const s32 pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+bool ReadPng(const char* filename, std::vector<u8>* out_rgba, u32* out_width, u32* out_height)
+{
+    static const u8 cSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    std::vector<u8> file;
+    if (!ReadWholeFile(filename, &file) || file.size() < 8 || std::memcmp(file.data(), cSignature, 8) != 0)
+        return false;
+
+    u32 width = 0;
+    u32 height = 0;
+    std::vector<u8> idat;
+
+    size_t pos = 8;
+    while (pos + 12 <= file.size())
+    {
+        const u32 size = GetU32BE(&file[pos]);
+        const u8* type = &file[pos + 4];
+        const u8* data = &file[pos + 8];
+        if (pos + 12 + size > file.size())
+            return false;
+
+        if (std::memcmp(type, "IHDR", 4) == 0)
+        {
+            if (size != 13 || data[8] != 8 || data[9] != 6 || data[12] != 0)
+                return false;   // Only 8-bit RGBA, non-interlaced
+
+            width = GetU32BE(data);
+            height = GetU32BE(data + 4);
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0)
+        {
+            idat.insert(idat.end(), data, data + size);
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0)
+        {
+            break;
+        }
+
+        pos += 12 + size;
+    }
+
+    if (width == 0 || height == 0)
+        return false;
+
+    std::vector<u8> raw;
+    const size_t row_size = size_t(width) * 4;
+    if (!InflateStored(idat, &raw) || raw.size() != (row_size + 1) * height)
+        return false;
+
+    out_rgba->resize(row_size * height);
+    u8* dst = out_rgba->data();
+
+    for (u32 y = 0; y < height; y++)
+    {
+        const u8 filter = raw[y * (row_size + 1)];
+        const u8* src = &raw[y * (row_size + 1) + 1];
+        u8* row = dst + y * row_size;
+        const u8* prev = y > 0 ? row - row_size : nullptr;
+
+        for (size_t x = 0; x < row_size; x++)
+        {
+            const u8 a = x >= 4 ? row[x - 4] : 0;
+            const u8 b = prev ? prev[x] : 0;
+            const u8 c = prev && x >= 4 ? prev[x - 4] : 0;
+
+            switch (filter)
+            {
+            case 0: row[x] = src[x]; break;
+            case 1: row[x] = src[x] + a; break;
+            case 2: row[x] = src[x] + b; break;
+            case 3: row[x] = src[x] + u8((u32(a) + b) / 2); break;
+            case 4: row[x] = src[x] + Paeth(a, b, c); break;
+            default: return false;
+            }
+        }
+    }
+
+    *out_width = width;
+    *out_height = height;
+    return true;
+}
@@ -0,0 +1,145 @@
+#include <image_writer.h>
+
+#include <cstdio>
+#include <vector>
+
+static constexpr u32 cStoredBlockSizeMax = 0xFFFF;
+
+static const u32* GetCrcTable()
+{
+    struct CrcTable
+    {
+        u32 value[256];
+
+        CrcTable()
+        {
+            for (u32 i = 0; i < 256; i++)
+            {
+                u32 c = i;
+                for (u32 k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+                value[i] = c;
+            }
+        }
+    };
+
+    static const CrcTable sTable;
+    return sTable.value;
+}
+
+static u32 UpdateCrc(u32 crc, const u8* data, size_t size)
+{
+    const u32* table = GetCrcTable();
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+static inline void PutU32BE(std::vector<u8>& out, u32 value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void PutChunk(std::vector<u8>& out, const char* type, const u8* data, u32 size)
+{
+    PutU32BE(out, size);
+
+    const size_t type_pos = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+
+    const u32 crc = UpdateCrc(0xFFFFFFFF, out.data() + type_pos, size + 4) ^ 0xFFFFFFFF;
+    PutU32BE(out, crc);
+}
+
+bool WritePng(const char* filename, const u8* rgba, u32 width, u32 height, u32 stride)
+{
+    static const u8 cSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    const u32 row_size = 1 + width * 4;     // Filter byte + pixels
+    const u32 raw_size = row_size * height;
+    const u32 block_num = (raw_size + cStoredBlockSizeMax - 1) / cStoredBlockSizeMax;
+
+    // zlib stream: header, stored blocks, Adler-32
+    std::vector<u8> idat;
+    idat.reserve(2 + raw_size + block_num * 5 + 4);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+
+    u32 adler_a = 1;
+    u32 adler_b = 0;
+
+    u32 block_left = 0;
+    u32 remaining = raw_size;
+
+    auto put_byte = [&](u8 value)
+    {
+        if (block_left == 0)
+        {
+            block_left = remaining < cStoredBlockSizeMax ? remaining : cStoredBlockSizeMax;
+            remaining -= block_left;
+
+            idat.push_back(remaining == 0 ? 1 : 0);   // BFINAL, BTYPE = stored
+            idat.push_back(block_left & 0xFF);
+            idat.push_back(block_left >> 8);
+            idat.push_back(~block_left & 0xFF);
+            idat.push_back((~block_left >> 8) & 0xFF);
+        }
+
+        idat.push_back(value);
+        block_left--;
+
+        adler_a = (adler_a + value) % 65521;
+        adler_b = (adler_b + adler_a) % 65521;
+    };
+
+    for (u32 y = 0; y < height; y++)
+    {
+        put_byte(0);    // Filter: none
+
+        const u8* row = rgba + size_t(y) * stride;
+        for (u32 x = 0; x < width * 4; x++)
+            put_byte(row[x]);
+    }
+
+    PutU32BE(idat, (adler_b << 16) | adler_a);
+
+    u8 ihdr[13];
+    ihdr[0] = width >> 24;
+    ihdr[1] = width >> 16;
+    ihdr[2] = width >> 8;
+    ihdr[3] = width;
+    ihdr[4] = height >> 24;
+    ihdr[5] = height >> 16;
+    ihdr[6] = height >> 8;
+    ihdr[7] = height;
+    ihdr[8] = 8;    // Bit depth
+    ihdr[9] = 6;    // Color type: RGBA
+    ihdr[10] = 0;   // Compression
+    ihdr[11] = 0;   // Filter
+    ihdr[12] = 0;   // Interlace
+
+    std::vector<u8> png;
+    png.reserve(sizeof(cSignature) + 25 + idat.size() + 12 + 12);
+    png.insert(png.end(), cSignature, cSignature + sizeof(cSignature));
+    PutChunk(png, "IHDR", ihdr, sizeof(ihdr));
+    PutChunk(png, "IDAT", idat.data(), idat.size());
+    PutChunk(png, "IEND", nullptr, 0);
+
+    return WriteRawImage(filename, png.data(), png.size());
+}
+
+bool WriteRawImage(const char* filename, const u8* data, u32 size)
+{
+    std::FILE* file = std::fopen(filename, "wb");
+    if (!file)
+        return false;
+
+    const bool written = std::fwrite(data, 1, size, file) == size;
+    return std::fclose(file) == 0 && written;
+}
@@ -0,0 +1,65 @@
+#include <live_edit.h>
+#include <trace.h>
+
+#include <nw/eft/eft_Emitter.h>
+#include <nw/eft/eft_ResData.h>
+
+LiveEdit::LiveEdit()
+    : mStats{ 0, 0, 0 }
+{
+}
+
+void LiveEdit::markEdited(const nw::eft::SimpleEmitterData* data, u32 derived)
+{
+    mStats.edit_num++;
+
+    // A widget being dragged edits the same record every frame
+    for (Pending& pending : mPending)
+    {
+        if (pending.data == data)
+        {
+            pending.derived |= derived;
+            return;
+        }
+    }
+
+    mPending.push_back(Pending{ data, derived });
+}
+
+bool LiveEdit::apply(nw::eft::EmitterInstance* head)
+{
+    if (mPending.empty())
+        return false;
+
+    EDITOR_TRACE_SCOPE("ApplyLiveEdit");
+
+    bool recreate = false;
+    for (const Pending& pending : mPending)
+    {
+        if (pending.derived & DERIVED_CREATE)
+            recreate = true;
+    }
+
+    if (recreate)
+    {
+        mStats.recreate_num++;
+        mPending.clear();
+        return true;
+    }
+
+    for (nw::eft::EmitterInstance* emitter = head; emitter != NULL; emitter = emitter->next)
+    {
+        for (const Pending& pending : mPending)
+        {
+            if (emitter->data != pending.data || !(pending.derived & DERIVED_UPDATE))
+                continue;
+
+            emitter->UpdateResInfo();
+            mStats.instance_update_num++;
+            break;
+        }
+    }
+
+    mPending.clear();
+    return false;
+}
@@ -1,6 +1,9 @@
 #include <rio.h>
 
+#include "command_line.h"
 #include "editor.h"
+#include "ptcl_diff.h"
+#include "ptcl_optimizer.h"
 
 static constexpr rio::InitializeArg cInitializeArg = {
     .window = {
@@ -10,13 +13,55 @@ static constexpr rio::InitializeArg cInitializeArg = {
     }
 };
 
-int main()
+static int RunPtclDiff()
 {
+    PtclDiffReport report;
+    std::string error;
+    if (!DiffPtclFiles(g_CommandLine.diff_path[0], g_CommandLine.diff_path[1], &report, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+
+    if (g_CommandLine.diff_json)
+        WritePtclDiffJson(report, stdout);
+    else
+        WritePtclDiffText(report, stdout);
+
+    return report.isIdentical() ? 0 : 1;
+}
+
+static int RunPtclOptimize()
+{
+    PtclOptimizeReport report;
+    std::string error;
+    if (!OptimizePtclFile(g_CommandLine.optimize_path[0], g_CommandLine.optimize_path[1], &report, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+
+    WritePtclOptimizeText(report, stdout);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseCommandLine(argc, argv))
+        return -1;
+
+    // Comparisons and optimization need neither a window nor Eft
+    if (!g_CommandLine.diff_path[0].empty())
+        return RunPtclDiff();
+
+    if (!g_CommandLine.optimize_path[0].empty())
+        return RunPtclOptimize();
+
     if (!rio::Initialize<Editor>(cInitializeArg))
         return -1;
 
     rio::EnterMainLoop();
 
     rio::Exit();
-    return 0;
+    return g_CommandLine.exit_code;
 }
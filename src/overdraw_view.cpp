@@ -0,0 +1,387 @@
+#include <overdraw_view.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <nw/eft/eft_Emitter.h>
+#include <nw/eft/eft_ResData.h>
+
+#if RIO_IS_WIN
+    #include <gl_program.hpp>
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+OverdrawView::OverdrawView()
+    : mInitialized(false)
+    , mEnabled(false)
+    , mDrawing(false)
+    , mQueryActive(false)
+    , mFramebuffer(0)
+    , mDepthStencil(0)
+    , mVertexArray(0)
+    , mProgram(0)
+    , mColorLocation(-1)
+    , mStorageWidth(0)
+    , mStorageHeight(0)
+    , mWidth(0)
+    , mHeight(0)
+    , mReadbackIndex(0)
+{
+    std::memset(mReadback, 0, sizeof(mReadback));
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+OverdrawView::~OverdrawView()
+{
+    finalize();
+}
+
+bool OverdrawView::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+void OverdrawView::getLevelColor(u32 level, f32* rgba)
+{
+    static const f32 cLevelColor[cLevelNum][3] = {
+        { 0.00f, 0.00f, 0.50f },
+        { 0.00f, 0.30f, 1.00f },
+        { 0.00f, 0.80f, 0.80f },
+        { 0.00f, 0.90f, 0.20f },
+        { 1.00f, 1.00f, 0.00f },
+        { 1.00f, 0.55f, 0.00f },
+        { 1.00f, 0.00f, 0.00f },
+        { 1.00f, 1.00f, 1.00f }
+    };
+
+    if (level == 0)
+    {
+        rgba[0] = rgba[1] = rgba[2] = 0.0f;
+    }
+    else
+    {
+        const f32* color = cLevelColor[std::min<u32>(level, cLevelNum) - 1];
+        rgba[0] = color[0];
+        rgba[1] = color[1];
+        rgba[2] = color[2];
+    }
+    rgba[3] = 1.0f;
+}
+
+void OverdrawView::initialize()
+{
+    if (mInitialized || !isSupported())
+        return;
+
+#if RIO_IS_WIN
+    mProgram = CreateProgramFromContent("shaders/overdraw_heatmap.vert", "shaders/overdraw_heatmap.frag");
+    if (!mProgram)
+        return;
+
+    mColorLocation = glGetUniformLocation(mProgram, "color");
+
+    RIO_GL_CALL(glGenFramebuffers(1, &mFramebuffer));
+    RIO_GL_CALL(glGenRenderbuffers(1, &mDepthStencil));
+    RIO_GL_CALL(glGenVertexArrays(1, &mVertexArray));
+
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        Readback& readback = mReadback[i];
+        RIO_GL_CALL(glGenBuffers(1, &readback.buffer));
+        RIO_GL_CALL(glGenQueries(cQueryNumPerFrame, readback.query));
+        readback.fence = nullptr;
+    }
+#endif // RIO_IS_WIN
+
+    mStorageWidth = 0;
+    mStorageHeight = 0;
+    mWidth = 0;
+    mHeight = 0;
+    mReadbackIndex = 0;
+    mInitialized = true;
+}
+
+void OverdrawView::finalize()
+{
+    if (!mInitialized)
+        return;
+
+#if RIO_IS_WIN
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        Readback& readback = mReadback[i];
+        if (readback.fence)
+        {
+            RIO_GL_CALL(glDeleteSync(static_cast<GLsync>(readback.fence)));
+            readback.fence = nullptr;
+        }
+        RIO_GL_CALL(glDeleteQueries(cQueryNumPerFrame, readback.query));
+        RIO_GL_CALL(glDeleteBuffers(1, &readback.buffer));
+    }
+
+    RIO_GL_CALL(glDeleteVertexArrays(1, &mVertexArray));
+    RIO_GL_CALL(glDeleteRenderbuffers(1, &mDepthStencil));
+    RIO_GL_CALL(glDeleteFramebuffers(1, &mFramebuffer));
+    DestroyProgram(mProgram);
+#endif // RIO_IS_WIN
+
+    mVertexArray = 0;
+    mDepthStencil = 0;
+    mFramebuffer = 0;
+    mProgram = 0;
+    mInitialized = false;
+}
+
+void OverdrawView::reset()
+{
+#if RIO_IS_WIN
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        Readback& readback = mReadback[i];
+        if (readback.fence)
+        {
+            RIO_GL_CALL(glDeleteSync(static_cast<GLsync>(readback.fence)));
+            readback.fence = nullptr;
+        }
+        readback.query_num = 0;
+    }
+#endif // RIO_IS_WIN
+
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+void OverdrawView::resize_(s32 width, s32 height)
+{
+    if (mStorageWidth == width && mStorageHeight == height)
+        return;
+
+    mStorageWidth = width;
+    mStorageHeight = height;
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glBindRenderbuffer(GL_RENDERBUFFER, mDepthStencil));
+    RIO_GL_CALL(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height));
+    RIO_GL_CALL(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer));
+    RIO_GL_CALL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mDepthStencil));
+#endif // RIO_IS_WIN
+}
+
+void OverdrawView::begin(uintptr target, s32 target_width, s32 target_height, s32 width, s32 height)
+{
+    mDrawing = false;
+
+    if (!isEnabled())
+        return;
+
+    collect_();
+    resize_(target_width, target_height);
+
+    mWidth = width;
+    mHeight = height;
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer));
+    RIO_GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GLuint(target), 0));
+    RIO_GL_CALL(glViewport(0, 0, width, height));
+    RIO_GL_CALL(glDisable(GL_SCISSOR_TEST));
+
+    RIO_GL_CALL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    RIO_GL_CALL(glDepthMask(GL_TRUE));
+    RIO_GL_CALL(glStencilMask(0xFF));
+    RIO_GL_CALL(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
+    RIO_GL_CALL(glClearDepth(1.0));
+    RIO_GL_CALL(glClearStencil(0));
+    RIO_GL_CALL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
+
+    // Every fragment that survives the depth test bumps its pixel's count
+    RIO_GL_CALL(glEnable(GL_STENCIL_TEST));
+    RIO_GL_CALL(glStencilFunc(GL_ALWAYS, 0, 0xFF));
+    RIO_GL_CALL(glStencilOp(GL_KEEP, GL_KEEP, GL_INCR));
+#endif // RIO_IS_WIN
+
+    // Only record queries if this frame's readback slot has been collected
+    Readback& readback = mReadback[mReadbackIndex];
+    if (!readback.fence)
+        readback.query_num = 0;
+
+    mDrawing = true;
+}
+
+void OverdrawView::end()
+{
+    if (!mDrawing)
+        return;
+
+    RIO_ASSERT(!mQueryActive);
+
+    resolve_();
+    readback_();
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+#endif // RIO_IS_WIN
+
+    mDrawing = false;
+}
+
+void OverdrawView::beginEmitter(const nw::eft::EmitterInstance* emitter)
+{
+    if (!mDrawing)
+        return;
+
+    Readback& readback = mReadback[mReadbackIndex];
+    if (readback.fence || readback.query_num >= cQueryNumPerFrame)
+        return;
+
+    readback.query_name[readback.query_num] = emitter->data->name;
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glBeginQuery(GL_SAMPLES_PASSED, readback.query[readback.query_num]));
+#endif // RIO_IS_WIN
+    mQueryActive = true;
+}
+
+void OverdrawView::endEmitter()
+{
+    if (!mQueryActive)
+        return;
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glEndQuery(GL_SAMPLES_PASSED));
+#endif // RIO_IS_WIN
+
+    mReadback[mReadbackIndex].query_num++;
+    mQueryActive = false;
+}
+
+void OverdrawView::resolve_()
+{
+#if RIO_IS_WIN
+    RIO_GL_CALL(glDisable(GL_DEPTH_TEST));
+    RIO_GL_CALL(glDisable(GL_BLEND));
+    RIO_GL_CALL(glDisable(GL_CULL_FACE));
+    RIO_GL_CALL(glDepthMask(GL_FALSE));
+    RIO_GL_CALL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    RIO_GL_CALL(glStencilMask(0x00));
+    RIO_GL_CALL(glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP));
+
+    RIO_GL_CALL(glUseProgram(mProgram));
+    RIO_GL_CALL(glBindVertexArray(mVertexArray));
+
+    // One fullscreen pass per level, each only touching the pixels whose
+    // count matches
+    for (u32 level = 1; level <= cLevelNum; level++)
+    {
+        f32 color[4];
+        getLevelColor(level, color);
+
+        RIO_GL_CALL(glStencilFunc(level < cLevelNum ? GL_EQUAL : GL_LEQUAL, level, 0xFF));
+        RIO_GL_CALL(glUniform4fv(mColorLocation, 1, color));
+        RIO_GL_CALL(glDrawArrays(GL_TRIANGLES, 0, 3));
+    }
+
+    RIO_GL_CALL(glBindVertexArray(0));
+    RIO_GL_CALL(glUseProgram(0));
+
+    RIO_GL_CALL(glStencilMask(0xFF));
+    RIO_GL_CALL(glDisable(GL_STENCIL_TEST));
+    RIO_GL_CALL(glDepthMask(GL_TRUE));
+#endif // RIO_IS_WIN
+}
+
+void OverdrawView::readback_()
+{
+    Readback& readback = mReadback[mReadbackIndex];
+    if (readback.fence)
+        return; // Still in flight, skip statistics for this frame
+
+#if RIO_IS_WIN
+    readback.width = mWidth;
+    readback.height = mHeight;
+
+    RIO_GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebuffer));
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+    RIO_GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, mWidth * mHeight, nullptr, GL_STREAM_READ));
+    RIO_GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    RIO_GL_CALL(glReadPixels(0, 0, mWidth, mHeight, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, nullptr));
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif // RIO_IS_WIN
+
+    mReadbackIndex = (mReadbackIndex + 1) % cReadbackNum;
+}
+
+void OverdrawView::collect_()
+{
+#if RIO_IS_WIN
+    // Oldest slot first, so the newest completed readback wins
+    for (u32 i = 0; i < cReadbackNum; i++)
+    {
+        Readback& readback = mReadback[(mReadbackIndex + i) % cReadbackNum];
+        if (!readback.fence)
+            continue;
+
+        GLenum status = glClientWaitSync(static_cast<GLsync>(readback.fence), 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+
+        RIO_GL_CALL(glDeleteSync(static_cast<GLsync>(readback.fence)));
+        readback.fence = nullptr;
+
+        Stats stats;
+        std::memset(&stats, 0, sizeof(stats));
+        stats.width = readback.width;
+        stats.height = readback.height;
+
+        const u32 pixel_num = readback.width * readback.height;
+        u64 fragment_num = 0;
+        u32 covered_num = 0;
+
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+        const u8* counts = static_cast<const u8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixel_num, GL_MAP_READ_BIT));
+        if (counts)
+        {
+            for (u32 j = 0; j < pixel_num; j++)
+            {
+                const u32 count = counts[j];
+                stats.histogram[std::min<u32>(count, cLevelNum)]++;
+                stats.max_overdraw = std::max<u32>(stats.max_overdraw, count);
+                fragment_num += count;
+                covered_num += count != 0;
+            }
+            RIO_GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        if (pixel_num != 0)
+        {
+            stats.total_overdraw = f32(fragment_num) / pixel_num;
+            stats.covered_ratio = f32(covered_num) / pixel_num;
+        }
+        if (covered_num != 0)
+            stats.average_overdraw = f32(fragment_num) / covered_num;
+
+        // The fence was inserted after the queries ended, so they are done
+        for (u32 j = 0; j < readback.query_num; j++)
+        {
+            GLuint64 samples = 0;
+            RIO_GL_CALL(glGetQueryObjectui64v(readback.query[j], GL_QUERY_RESULT, &samples));
+            if (samples > stats.worst_emitter_fragments)
+            {
+                stats.worst_emitter_fragments = samples;
+                stats.worst_emitter_name = readback.query_name[j];
+            }
+        }
+        readback.query_num = 0;
+
+        mStats = stats;
+    }
+#endif // RIO_IS_WIN
+}
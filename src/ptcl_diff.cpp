@@ -0,0 +1,623 @@
+#include <file_util.h>
+#include <ptcl_diff.h>
+#include <ptcl_layout.h>
+#include <ptcl_writer.h>
+#include <thread_pool.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+typedef PtclTextureRes TextureRes;
+
+static constexpr u32 cTextureSlotNum = nw::eft::EFT_TEXTURE_SLOT_BIN_MAX;
+static constexpr u32 cNoTexture = 0xFFFFFFFF;
+static constexpr u32 cNameLengthMax = 256;
+static constexpr u32 cRecordSizeMax = std::max(sizeof(nw::eft::SimpleEmitterData), sizeof(nw::eft::ComplexEmitterData));
+
+static const char* const cStatusName[] = { "same", "changed", "added", "removed" };
+static const char cStatusMark[] = { '=', '~', '+', '-' };
+
+#define MEMBER_RANGE(type, member) PtclRange{ u32(offsetof(type, member)), u32(sizeof(static_cast<const type*>(nullptr)->member)) }
+
+struct PtclRange
+{
+    u32 offset;
+    u32 size;
+};
+
+struct PtclTexture
+{
+    u32 offset;     // In the file
+    u32 size;
+    u64 hash;
+};
+
+struct PtclEmitter
+{
+    std::string     name;
+    u32             texture[cPtclTextureSlotNum][PTCL_TEXTURE_DATA_NUM];  // Into PtclFile::textures, or cNoTexture
+    std::vector<u8> record;                                                 // As stored, with the positions zeroed
+    u64             hash;
+};
+
+struct PtclSet
+{
+    std::string                 name;
+    std::vector<PtclEmitter>    emitters;
+    u64                         hash;
+};
+
+struct PtclFile
+{
+    const u8*                   data;
+    u32                         size;
+    std::vector<PtclSet>        sets;
+    std::vector<PtclTexture>    textures;
+    PtclRange                   shader_table;
+    PtclRange                   primitive_table;
+    u64                         shader_hash;
+    u64                         primitive_hash;
+    u32                         emitter_num;
+};
+
+static inline u64 HashString(const std::string& str)
+{
+    return HashBytes(reinterpret_cast<const u8*>(str.data()), str.size());
+}
+
+// Positions in the file move whenever anything stored before them grows, so
+// they are left out of hashes and comparisons
+static const std::vector<PtclRange>& GetPositionRanges()
+{
+    static const std::vector<PtclRange> sRanges = []()
+    {
+        std::vector<PtclRange> ranges;
+        ranges.push_back(MEMBER_RANGE(nw::eft::CommonEmitterData, namePos));
+        ranges.push_back(MEMBER_RANGE(nw::eft::CommonEmitterData, name));
+
+        for (u32 i = 0; i < cTextureSlotNum; i++)
+        {
+            const u32 base = offsetof(nw::eft::CommonEmitterData, texRes) + i * sizeof(TextureRes);
+
+            for (PtclRange range : { MEMBER_RANGE(TextureRes, originalDataPos),
+                                 MEMBER_RANGE(TextureRes, nativeDataPos),
+                                 MEMBER_RANGE(TextureRes, gx2Texture.surface.imagePtr),
+                                 MEMBER_RANGE(TextureRes, gx2Texture.surface.mipPtr) })
+            {
+                range.offset += base;
+                ranges.push_back(range);
+            }
+        }
+
+        return ranges;
+    }();
+
+    return sRanges;
+}
+
+// Per record byte, whether a known field or a texture slot covers it
+static const std::vector<u8>& GetKnownByteMask()
+{
+    static const std::vector<u8> sMask = []()
+    {
+        std::vector<u8> mask(cRecordSizeMax, 0);
+
+        for (const PtclWriter::Field& field : PtclWriter::getFieldTable())
+            std::fill_n(mask.begin() + field.offset, field.size, 1);
+
+        std::fill_n(mask.begin() + offsetof(nw::eft::CommonEmitterData, texRes), cTextureSlotNum * sizeof(TextureRes), 1);
+
+        for (const PtclRange& range : GetPositionRanges())
+            std::fill_n(mask.begin() + range.offset, range.size, 1);
+
+        return mask;
+    }();
+
+    return sMask;
+}
+
+static bool ReadName(const PtclFile& file, u64 offset, std::string* name)
+{
+    if (offset >= file.size)
+        return false;
+
+    const char* begin = reinterpret_cast<const char*>(file.data + offset);
+    name->assign(begin, strnlen(begin, std::min<u64>(file.size - offset, cNameLengthMax)));
+    return true;
+}
+
+static bool ReadPtcl(const u8* data, u32 size, PtclFile* file, std::string* error)
+{
+    EDITOR_TRACE_SCOPE("ReadPtcl");
+
+    typedef nw::eft::HeaderData Header;
+
+    file->data = data;
+    file->size = size;
+    file->emitter_num = 0;
+
+    if (size < sizeof(Header))
+    {
+        *error = "smaller than a PTCL header";
+        return false;
+    }
+
+    const u32 set_num = Load32(data + offsetof(Header, numEmitterSet));
+    const u32 name_table = Load32(data + offsetof(Header, nameTblPos));
+    const PtclRange texture_table = { Load32(data + offsetof(Header, textureTblPos)), Load32(data + offsetof(Header, textureTblSize)) };
+    file->shader_table = { Load32(data + offsetof(Header, shaderTblPos)), Load32(data + offsetof(Header, shaderTblSize)) };
+    file->primitive_table = { Load32(data + offsetof(Header, primitiveTblPos)), Load32(data + offsetof(Header, primitiveTblSize)) };
+
+    if (name_table >= size || !InRange(texture_table.offset, texture_table.size, size) ||
+        !InRange(file->shader_table.offset, file->shader_table.size, size) ||
+        !InRange(file->primitive_table.offset, file->primitive_table.size, size))
+    {
+        *error = "a table lies outside the file";
+        return false;
+    }
+
+    if (!InRange(sizeof(Header), u64(set_num) * sizeof(nw::eft::EmitterSetData), size))
+    {
+        *error = "the emitter set table lies outside the file";
+        return false;
+    }
+
+    // Emitters of different sets can share texture data
+    std::map<std::pair<u32, u32>, u32> texture_index;
+
+    file->sets.resize(set_num);
+    for (u32 i = 0; i < set_num; i++)
+    {
+        const u8* set_data = data + sizeof(Header) + i * sizeof(nw::eft::EmitterSetData);
+        PtclSet& set = file->sets[i];
+
+        const u32 emitter_num = Load32(set_data + offsetof(nw::eft::EmitterSetData, numEmitter));
+        const u32 emitter_table = Load32(set_data + offsetof(nw::eft::EmitterSetData, emitterTbl));
+
+        if (!ReadName(*file, u64(name_table) + Load32(set_data + offsetof(nw::eft::EmitterSetData, namePos)), &set.name) ||
+            !InRange(emitter_table, u64(emitter_num) * sizeof(nw::eft::EmitterTblData), size))
+        {
+            *error = "emitter set " + std::to_string(i) + " lies outside the file";
+            return false;
+        }
+
+        set.emitters.resize(emitter_num);
+        for (u32 j = 0; j < emitter_num; j++)
+        {
+            PtclEmitter& emitter = set.emitters[j];
+
+            const u32 record = Load32(data + emitter_table + j * sizeof(nw::eft::EmitterTblData) + offsetof(nw::eft::EmitterTblData, emitter));
+            const u32 type = InRange(record, sizeof(nw::eft::CommonEmitterData), size) ? Load32(data + record + offsetof(nw::eft::CommonEmitterData, type)) : 0;
+            const u32 record_size = type == nw::eft::EFT_EMITTER_TYPE_SIMPLE ? sizeof(nw::eft::SimpleEmitterData) : sizeof(nw::eft::ComplexEmitterData);
+
+            if (!InRange(record, record_size, size) ||
+                !ReadName(*file, u64(name_table) + Load32(data + record + offsetof(nw::eft::CommonEmitterData, namePos)), &emitter.name))
+            {
+                *error = "emitter " + std::to_string(j) + " of " + set.name + " lies outside the file";
+                return false;
+            }
+
+            for (u32 k = 0; k < cPtclTextureSlotNum; k++)
+            {
+                std::fill_n(emitter.texture[k], u32(PTCL_TEXTURE_DATA_NUM), cNoTexture);
+
+                u32 texture_res;
+                if (!GetPtclTextureRes(data, size, record, k, &texture_res))
+                {
+                    *error = "the child of " + emitter.name + " lies outside the file";
+                    return false;
+                }
+
+                if (texture_res == 0)
+                    continue;
+
+                for (u32 kind = 0; kind < PTCL_TEXTURE_DATA_NUM; kind++)
+                {
+                    const u32 texture_offset = Load32(data + texture_res + GetPtclTextureDataPos(PtclTextureData(kind)));
+                    const u32 texture_size = Load32(data + texture_res + GetPtclTextureDataSize(PtclTextureData(kind)));
+                    if (texture_size == 0)
+                        continue;
+
+                    if (!InRange(texture_offset, texture_size, texture_table.size))
+                    {
+                        *error = "texture " + std::to_string(k) + " of " + emitter.name + " lies outside the texture table";
+                        return false;
+                    }
+
+                    const std::pair<u32, u32> key(texture_table.offset + texture_offset, texture_size);
+                    auto it = texture_index.find(key);
+                    if (it == texture_index.end())
+                    {
+                        it = texture_index.emplace(key, file->textures.size()).first;
+                        file->textures.push_back(PtclTexture{ key.first, key.second, 0 });
+                    }
+
+                    emitter.texture[k][kind] = it->second;
+                }
+            }
+
+            emitter.record.assign(data + record, data + record + record_size);
+            for (const PtclRange& range : GetPositionRanges())
+                std::memset(emitter.record.data() + range.offset, 0, range.size);
+        }
+
+        file->emitter_num += emitter_num;
+    }
+
+    return true;
+}
+
+static void HashPtcl(PtclFile* file, ThreadPool* pool)
+{
+    EDITOR_TRACE_SCOPE("HashPtcl");
+
+    pool->submit([file]()
+    {
+        file->shader_hash = HashBytes(file->data + file->shader_table.offset, file->shader_table.size);
+        file->primitive_hash = HashBytes(file->data + file->primitive_table.offset, file->primitive_table.size);
+    });
+
+    for (PtclTexture& texture : file->textures)
+        pool->submit([file, &texture]() { texture.hash = HashBytes(file->data + texture.offset, texture.size); });
+
+    pool->wait();
+
+    // Emitters take in the hashes of their textures
+    for (PtclSet& set : file->sets)
+    {
+        pool->submit([file, &set]()
+        {
+            set.hash = HashString(set.name);
+            for (PtclEmitter& emitter : set.emitters)
+            {
+                emitter.hash = HashMix(HashString(emitter.name), HashBytes(emitter.record.data(), emitter.record.size()));
+                for (const u32 (&slot)[PTCL_TEXTURE_DATA_NUM] : emitter.texture)
+                    for (u32 texture : slot)
+                        emitter.hash = HashMix(emitter.hash, texture == cNoTexture ? 0 : file->textures[texture].hash);
+
+                set.hash = HashMix(set.hash, emitter.hash);
+            }
+        });
+    }
+
+    pool->wait();
+}
+
+static constexpr u32 cNoMatch = 0xFFFFFFFF;
+
+// Hands out the items of the second file by name, in order for repeated names
+class NameMatcher
+{
+public:
+    template <typename T>
+    explicit NameMatcher(const std::vector<T>& items)
+    {
+        for (u32 i = 0; i < items.size(); i++)
+            mIndices[items[i].name].push_back(i);
+
+        for (auto& entry : mIndices)
+            std::reverse(entry.second.begin(), entry.second.end());
+    }
+
+    u32 take(const std::string& name)
+    {
+        auto it = mIndices.find(name);
+        if (it == mIndices.end() || it->second.empty())
+            return cNoMatch;
+
+        const u32 index = it->second.back();
+        it->second.pop_back();
+        return index;
+    }
+
+private:
+    std::unordered_map<std::string, std::vector<u32>> mIndices;
+};
+
+// Of the original and native data of a slot
+static inline u64 GetTextureHash(const PtclFile& file, const PtclEmitter& emitter, u32 slot)
+{
+    u64 hash = 0;
+    for (u32 texture : emitter.texture[slot])
+        hash = HashMix(hash, texture == cNoTexture ? 0 : file.textures[texture].hash);
+
+    return hash;
+}
+
+static void DiffEmitter(const PtclFile& a, const PtclEmitter& emitter_a, const PtclFile& b, const PtclEmitter& emitter_b, PtclEmitterDiff* diff)
+{
+    diff->name = emitter_a.name;
+    diff->status = PTCL_DIFF_CHANGED;
+    diff->texture_mask = 0;
+    diff->other_byte_num = 0;
+
+    const u8* record_a = emitter_a.record.data();
+    const u8* record_b = emitter_b.record.data();
+    const u32 size = std::min(emitter_a.record.size(), emitter_b.record.size());
+
+    for (const PtclWriter::Field& field : PtclWriter::getFieldTable())
+    {
+        if (field.offset + field.size <= size && std::memcmp(record_a + field.offset, record_b + field.offset, field.size) != 0)
+            diff->fields.push_back(field.name);
+    }
+
+    for (u32 i = 0; i < cPtclTextureSlotNum; i++)
+    {
+        if (GetTextureHash(a, emitter_a, i) != GetTextureHash(b, emitter_b, i))
+            diff->texture_mask |= 1 << i;
+    }
+
+    for (u32 i = 0; i < cTextureSlotNum; i++)
+    {
+        const u32 offset = offsetof(nw::eft::CommonEmitterData, texRes) + i * sizeof(TextureRes);
+        if (std::memcmp(record_a + offset, record_b + offset, sizeof(TextureRes)) != 0)
+            diff->texture_mask |= 1 << i;
+    }
+
+    const std::vector<u8>& known = GetKnownByteMask();
+    for (u32 i = 0; i < size; i++)
+    {
+        if (!known[i] && record_a[i] != record_b[i])
+            diff->other_byte_num++;
+    }
+
+    // Emitters that changed between simple and complex
+    diff->other_byte_num += std::max(emitter_a.record.size(), emitter_b.record.size()) - size;
+}
+
+static void DiffSet(const PtclFile& a, const PtclSet& set_a, const PtclFile& b, const PtclSet& set_b, PtclSetDiff* diff)
+{
+    diff->name = set_a.name;
+    diff->status = PTCL_DIFF_CHANGED;
+
+    std::vector<bool> matched(set_b.emitters.size(), false);
+    NameMatcher matcher(set_b.emitters);
+
+    for (const PtclEmitter& emitter_a : set_a.emitters)
+    {
+        const u32 index = matcher.take(emitter_a.name);
+        if (index == cNoMatch)
+        {
+            diff->emitters.push_back(PtclEmitterDiff{ emitter_a.name, PTCL_DIFF_REMOVED, { }, 0, 0 });
+            continue;
+        }
+
+        const PtclEmitter& emitter_b = set_b.emitters[index];
+        matched[index] = true;
+
+        if (emitter_a.hash == emitter_b.hash)
+            continue;
+
+        diff->emitters.emplace_back();
+        DiffEmitter(a, emitter_a, b, emitter_b, &diff->emitters.back());
+    }
+
+    for (u32 i = 0; i < set_b.emitters.size(); i++)
+    {
+        if (!matched[i])
+            diff->emitters.push_back(PtclEmitterDiff{ set_b.emitters[i].name, PTCL_DIFF_ADDED, { }, 0, 0 });
+    }
+}
+
+bool DiffPtcl(const u8* a, u32 a_size, const u8* b, u32 b_size, PtclDiffReport* report, std::string* error)
+{
+    EDITOR_TRACE_SCOPE("DiffPtcl");
+
+    const u64 start = Trace::now();
+
+    PtclFile file[2];
+    if (!ReadPtcl(a, a_size, &file[0], error) || !ReadPtcl(b, b_size, &file[1], error))
+        return false;
+
+    ThreadPool pool;
+    HashPtcl(&file[0], &pool);
+    HashPtcl(&file[1], &pool);
+
+    for (u32 i = 0; i < 2; i++)
+    {
+        report->set_num[i] = file[i].sets.size();
+        report->emitter_num[i] = file[i].emitter_num;
+        report->texture_num[i] = file[i].textures.size();
+    }
+
+    report->same_set_num = 0;
+    report->shader_table_changed = file[0].shader_hash != file[1].shader_hash;
+    report->primitive_table_changed = file[0].primitive_hash != file[1].primitive_hash;
+    report->sets.clear();
+
+    std::vector<bool> matched(file[1].sets.size(), false);
+    NameMatcher matcher(file[1].sets);
+
+    std::vector<PtclSetDiff> diffs(file[0].sets.size());
+    for (u32 i = 0; i < file[0].sets.size(); i++)
+    {
+        const PtclSet& set_a = file[0].sets[i];
+
+        const u32 index = matcher.take(set_a.name);
+        if (index == cNoMatch)
+        {
+            diffs[i] = PtclSetDiff{ set_a.name, PTCL_DIFF_REMOVED, { } };
+            continue;
+        }
+
+        const PtclSet& set_b = file[1].sets[index];
+        matched[index] = true;
+
+        if (set_a.hash == set_b.hash)
+        {
+            diffs[i].status = PTCL_DIFF_SAME;
+            report->same_set_num++;
+            continue;
+        }
+
+        PtclSetDiff* diff = &diffs[i];
+        pool.submit([&file, &set_a, &set_b, diff]() { DiffSet(file[0], set_a, file[1], set_b, diff); });
+    }
+
+    pool.wait();
+
+    for (PtclSetDiff& diff : diffs)
+    {
+        if (diff.status != PTCL_DIFF_SAME)
+            report->sets.push_back(std::move(diff));
+    }
+
+    for (u32 i = 0; i < file[1].sets.size(); i++)
+    {
+        if (!matched[i])
+            report->sets.push_back(PtclSetDiff{ file[1].sets[i].name, PTCL_DIFF_ADDED, { } });
+    }
+
+    report->diff_ns = Trace::now() - start;
+    return true;
+}
+
+bool DiffPtclFiles(const std::string& a, const std::string& b, PtclDiffReport* report, std::string* error)
+{
+    std::vector<u8> data[2];
+    const std::string* path[2] = { &a, &b };
+
+    for (u32 i = 0; i < 2; i++)
+    {
+        if (!ReadWholeFile(*path[i], &data[i]))
+        {
+            *error = "Could not read " + *path[i];
+            return false;
+        }
+    }
+
+    if (!DiffPtcl(data[0].data(), data[0].size(), data[1].data(), data[1].size(), report, error))
+        return false;
+
+    report->path[0] = a;
+    report->path[1] = b;
+    return true;
+}
+
+bool DiffPtclFile(const u8* a, u32 a_size, const std::string& b, PtclDiffReport* report, std::string* error)
+{
+    std::vector<u8> data;
+    if (!ReadWholeFile(b, &data))
+    {
+        *error = "Could not read " + b;
+        return false;
+    }
+
+    if (!DiffPtcl(a, a_size, data.data(), data.size(), report, error))
+        return false;
+
+    report->path[1] = b;
+    return true;
+}
+
+const char* GetPtclDiffStatusName(PtclDiffStatus status)
+{
+    return cStatusName[status];
+}
+
+void WritePtclDiffText(const PtclDiffReport& report, std::FILE* file)
+{
+    std::fprintf(file, "--- %s\n+++ %s\n", report.path[0].c_str(), report.path[1].c_str());
+    std::fprintf(file, "Sets: %u -> %u, %u identical\n", report.set_num[0], report.set_num[1], report.same_set_num);
+
+    for (const PtclSetDiff& set : report.sets)
+    {
+        std::fprintf(file, "%c %s\n", cStatusMark[set.status], set.name.c_str());
+
+        for (const PtclEmitterDiff& emitter : set.emitters)
+        {
+            std::fprintf(file, "    %c %s", cStatusMark[emitter.status], emitter.name.c_str());
+
+            const char* separator = ": ";
+            for (const std::string& field : emitter.fields)
+            {
+                std::fprintf(file, "%s%s", separator, field.c_str());
+                separator = ", ";
+            }
+
+            for (u32 i = 0; i < cPtclTextureSlotNum; i++)
+            {
+                if (!(emitter.texture_mask & (1 << i)))
+                    continue;
+
+                if (i == cPtclChildTextureSlot)
+                    std::fprintf(file, "%schild texture", separator);
+                else
+                    std::fprintf(file, "%stexture %u", separator, i);
+
+                separator = ", ";
+            }
+
+            if (emitter.other_byte_num > 0)
+                std::fprintf(file, "%s%u other bytes", separator, emitter.other_byte_num);
+
+            std::fprintf(file, "\n");
+        }
+    }
+
+    if (report.shader_table_changed)
+        std::fprintf(file, "~ shader table\n");
+    if (report.primitive_table_changed)
+        std::fprintf(file, "~ primitive table\n");
+
+    std::fprintf(file, "%s in %.2f ms\n", report.isIdentical() ? "Identical" : "Compared", report.diff_ns / 1000000.0f);
+}
+
+void WritePtclDiffJson(const PtclDiffReport& report, std::FILE* file)
+{
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"a\": { \"path\": \"%s\", \"sets\": %u, \"emitters\": %u, \"textures\": %u },\n",
+                 EscapeJson(report.path[0]).c_str(), report.set_num[0], report.emitter_num[0], report.texture_num[0]);
+    std::fprintf(file, "  \"b\": { \"path\": \"%s\", \"sets\": %u, \"emitters\": %u, \"textures\": %u },\n",
+                 EscapeJson(report.path[1]).c_str(), report.set_num[1], report.emitter_num[1], report.texture_num[1]);
+    std::fprintf(file, "  \"identical\": %s,\n", report.isIdentical() ? "true" : "false");
+    std::fprintf(file, "  \"identical_sets\": %u,\n", report.same_set_num);
+    std::fprintf(file, "  \"shader_table_changed\": %s,\n", report.shader_table_changed ? "true" : "false");
+    std::fprintf(file, "  \"primitive_table_changed\": %s,\n", report.primitive_table_changed ? "true" : "false");
+    std::fprintf(file, "  \"diff_ms\": %.3f,\n", report.diff_ns / 1000000.0);
+    std::fprintf(file, "  \"sets\": [");
+
+    for (u32 i = 0; i < report.sets.size(); i++)
+    {
+        const PtclSetDiff& set = report.sets[i];
+
+        std::fprintf(file, "%s\n    {\n", i == 0 ? "" : ",");
+        std::fprintf(file, "      \"name\": \"%s\",\n", EscapeJson(set.name).c_str());
+        std::fprintf(file, "      \"status\": \"%s\",\n", cStatusName[set.status]);
+        std::fprintf(file, "      \"emitters\": [");
+
+        for (u32 j = 0; j < set.emitters.size(); j++)
+        {
+            const PtclEmitterDiff& emitter = set.emitters[j];
+
+            std::fprintf(file, "%s\n        { \"name\": \"%s\", \"status\": \"%s\", \"fields\": [", j == 0 ? "" : ",",
+                         EscapeJson(emitter.name).c_str(), cStatusName[emitter.status]);
+
+            for (u32 k = 0; k < emitter.fields.size(); k++)
+                std::fprintf(file, "%s\"%s\"", k == 0 ? " " : ", ", emitter.fields[k].c_str());
+
+            std::fprintf(file, "%s], \"textures\": [", emitter.fields.empty() ? "" : " ");
+
+            const char* separator = " ";
+            for (u32 k = 0; k < cPtclTextureSlotNum; k++)
+            {
+                if (emitter.texture_mask & (1 << k))
+                {
+                    std::fprintf(file, "%s%u", separator, k);
+                    separator = ", ";
+                }
+            }
+
+            std::fprintf(file, "%s], \"other_bytes\": %u }", emitter.texture_mask ? " " : "", emitter.other_byte_num);
+        }
+
+        std::fprintf(file, "%s]\n    }", set.emitters.empty() ? "" : "\n      ");
+    }
+
+    std::fprintf(file, "%s]\n", report.sets.empty() ? "" : "\n  ");
+    std::fprintf(file, "}\n");
+}
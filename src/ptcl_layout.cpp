@@ -0,0 +1,206 @@
+#include <file_util.h>
+#include <ptcl_layout.h>
+
+#include <cstddef>
+
+#define MEMBER_SIZE(type, member) u32(sizeof(static_cast<const type*>(nullptr)->member))
+#define LOAD_MEMBER(data, type, member) LoadBe((data) + offsetof(type, member), MEMBER_SIZE(type, member))
+
+// File position of the ChildData of the record, or 0 if it has none
+static inline bool GetChildData(const u8* data, u32 size, u32 record, u32* child)
+{
+    typedef nw::eft::ComplexEmitterData Complex;
+
+    *child = 0;
+
+    if (Load32(data + record + offsetof(nw::eft::CommonEmitterData, type)) == nw::eft::EFT_EMITTER_TYPE_SIMPLE)
+        return true;
+
+    if (!InRange(record, sizeof(Complex), size))
+        return false;
+
+    if (!(LOAD_MEMBER(data + record, Complex, childFlg) & nw::eft::EFT_CHILD_FLAG_ENABLE))
+        return true;
+
+    const u32 position = record + LOAD_MEMBER(data + record, Complex, childDataOffset);
+    if (!InRange(position, sizeof(nw::eft::ChildData), size))
+        return false;
+
+    *child = position;
+    return true;
+}
+
+bool GetPtclTextureRes(const u8* data, u32 size, u32 record, u32 slot, u32* texture_res)
+{
+    *texture_res = 0;
+
+    if (slot < cPtclChildTextureSlot)
+    {
+        *texture_res = record + offsetof(nw::eft::CommonEmitterData, texRes) + slot * sizeof(PtclTextureRes);
+        return true;
+    }
+
+    u32 child;
+    if (!GetChildData(data, size, record, &child))
+        return false;
+
+    if (child != 0)
+        *texture_res = child + offsetof(nw::eft::ChildData, childTex);
+
+    return true;
+}
+
+u32 GetPtclTextureDataPos(PtclTextureData kind)
+{
+    return kind == PTCL_TEXTURE_ORIGINAL ? offsetof(PtclTextureRes, originalDataPos) : offsetof(PtclTextureRes, nativeDataPos);
+}
+
+u32 GetPtclTextureDataSize(PtclTextureData kind)
+{
+    return kind == PTCL_TEXTURE_ORIGINAL ? offsetof(PtclTextureRes, originalDataSize) : offsetof(PtclTextureRes, nativeDataSize);
+}
+
+bool GetPtclTableLayout(const u8* data, u32 size, PtclTable table, PtclTableLayout* layout)
+{
+    typedef nw::eft::HeaderData Header;
+
+    layout->entries.clear();
+    layout->info_size = 0;
+
+    if (table == PTCL_TABLE_SHADER)
+    {
+        layout->position = Load32(data + offsetof(Header, shaderTblPos));
+        layout->size = Load32(data + offsetof(Header, shaderTblSize));
+    }
+    else
+    {
+        layout->position = Load32(data + offsetof(Header, primitiveTblPos));
+        layout->size = Load32(data + offsetof(Header, primitiveTblSize));
+    }
+
+    if (!InRange(layout->position, layout->size, size))
+        return false;
+
+    if (layout->size == 0)
+        return true;
+
+    const u8* const image = data + layout->position;
+
+    if (table == PTCL_TABLE_SHADER)
+    {
+        typedef nw::eft::ShaderImageInformation Image;
+        typedef nw::eft::ShaderInformation Info;
+
+        if (!InRange(0, sizeof(Image), layout->size))
+            return false;
+
+        const u32 entry_num = LOAD_MEMBER(image, Image, shaderNum);
+        const u32 data_offset = LOAD_MEMBER(image, Image, offsetShaderBinInfo);
+        if (!InRange(sizeof(Image), u64(entry_num) * sizeof(Info), layout->size))
+            return false;
+
+        layout->info_size = sizeof(Image) + entry_num * sizeof(Info);
+        layout->entries.resize(entry_num);
+
+        for (u32 i = 0; i < entry_num; i++)
+        {
+            const u8* info = image + sizeof(Image) + i * sizeof(Info);
+
+            PtclTableEntry& entry = layout->entries[i];
+            entry.range_num = 1;
+            entry.offset[0] = data_offset + LOAD_MEMBER(info, Info, offset);
+            entry.size[0] = LOAD_MEMBER(info, Info, shaderSize);
+        }
+    }
+    else
+    {
+        typedef nw::eft::PrimitiveImageInformation Image;
+        typedef nw::eft::PrimitiveTableInfo Info;
+        typedef decltype(Info::pos) Attribute;
+
+        static const u32 cAttributeOffset[cPtclTableEntryRangeMax] = {
+            u32(offsetof(Info, pos)),
+            u32(offsetof(Info, normal)),
+            u32(offsetof(Info, color)),
+            u32(offsetof(Info, texCoord)),
+            u32(offsetof(Info, index))
+        };
+
+        if (!InRange(0, sizeof(Image), layout->size))
+            return false;
+
+        const u32 entry_num = LOAD_MEMBER(image, Image, primitiveNum);
+        const u32 data_offset = LOAD_MEMBER(image, Image, offsetPrimitiveTableInfo);
+        if (!InRange(sizeof(Image), u64(entry_num) * sizeof(Info), layout->size))
+            return false;
+
+        layout->info_size = sizeof(Image) + entry_num * sizeof(Info);
+        layout->entries.resize(entry_num);
+
+        for (u32 i = 0; i < entry_num; i++)
+        {
+            const u8* info = image + sizeof(Image) + i * sizeof(Info);
+
+            PtclTableEntry& entry = layout->entries[i];
+            entry.range_num = 0;
+
+            for (u32 attribute_offset : cAttributeOffset)
+            {
+                const u8* attribute = info + attribute_offset;
+                const u32 attribute_size = LOAD_MEMBER(attribute, Attribute, size);
+                if (attribute_size == 0)
+                    continue;
+
+                entry.offset[entry.range_num] = data_offset + LOAD_MEMBER(attribute, Attribute, offset);
+                entry.size[entry.range_num] = attribute_size;
+                entry.range_num++;
+            }
+        }
+    }
+
+    for (const PtclTableEntry& entry : layout->entries)
+        for (u32 i = 0; i < entry.range_num; i++)
+            if (!InRange(entry.offset[i], entry.size[i], layout->size))
+                return false;
+
+    return true;
+}
+
+bool GetPtclTableRefs(const u8* data, u32 size, u32 record, PtclTable table, std::vector<u32>* indices)
+{
+    typedef nw::eft::SimpleEmitterData Simple;
+    typedef nw::eft::ChildData Child;
+
+    if (!InRange(record, sizeof(Simple), size))
+        return false;
+
+    u32 child;
+    if (!GetChildData(data, size, record, &child))
+        return false;
+
+    const u8* const simple = data + record;
+    const u8* const child_data = data + child;
+
+    if (table == PTCL_TABLE_SHADER)
+    {
+        indices->push_back(LOAD_MEMBER(simple, Simple, shaderIndex));
+        indices->push_back(LOAD_MEMBER(simple, Simple, userShaderIndex1));
+        indices->push_back(LOAD_MEMBER(simple, Simple, userShaderIndex2));
+
+        if (child != 0)
+        {
+            indices->push_back(LOAD_MEMBER(child_data, Child, childShaderIndex));
+            indices->push_back(LOAD_MEMBER(child_data, Child, childUserShaderIndex1));
+            indices->push_back(LOAD_MEMBER(child_data, Child, childUserShaderIndex2));
+        }
+    }
+    else
+    {
+        indices->push_back(LOAD_MEMBER(simple, Simple, primitiveFigure.index));
+
+        if (child != 0)
+            indices->push_back(LOAD_MEMBER(child_data, Child, childPrimitiveFigure.index));
+    }
+
+    return true;
+}
@@ -0,0 +1,514 @@
+#include <file_util.h>
+#include <ptcl_diff.h>
+#include <ptcl_layout.h>
+#include <ptcl_optimizer.h>
+#include <thread_pool.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+static constexpr u32 cAlignmentMax = 0x2000;
+
+static const char* const cCategoryName[] = { "Textures", "Shaders", "Primitives" };
+
+// Blob of the texture table, as pointed at by one or more emitters
+struct PtclBlob
+{
+    u32 offset;         // In the texture table
+    u32 size;
+    u32 alignment;      // Of the file positions merged into it, the largest
+    u64 hash;
+    u32 kept;           // Index of the blob stored in its place
+    u32 new_offset;
+};
+
+// Position member of a texture slot and the blob it points at
+struct PtclBlobRef
+{
+    u32 position;       // In the file
+    u32 blob;
+};
+
+static inline u32 AlignUp(u32 value, u32 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Largest power of two the position is a multiple of
+static inline u32 GetAlignment(u32 position)
+{
+    return position == 0 ? cAlignmentMax : std::min(position & (~position + 1), cAlignmentMax);
+}
+
+// Collects the texture slots of every emitter and child, with bounds checks,
+// and the file positions of the emitter records
+static bool ReadBlobRefs(const u8* data, u32 size, u32 texture_table, u32 texture_table_size,
+                         std::vector<PtclBlob>* blobs, std::vector<PtclBlobRef>* refs, std::vector<u32>* records, std::string* error)
+{
+    typedef nw::eft::HeaderData Header;
+
+    const u32 set_num = Load32(data + offsetof(Header, numEmitterSet));
+    if (!InRange(sizeof(Header), u64(set_num) * sizeof(nw::eft::EmitterSetData), size))
+    {
+        *error = "the emitter set table lies outside the file";
+        return false;
+    }
+
+    std::map<std::pair<u32, u32>, u32> blob_index;
+
+    for (u32 i = 0; i < set_num; i++)
+    {
+        const u8* set_data = data + sizeof(Header) + i * sizeof(nw::eft::EmitterSetData);
+        const u32 emitter_num = Load32(set_data + offsetof(nw::eft::EmitterSetData, numEmitter));
+        const u32 emitter_table = Load32(set_data + offsetof(nw::eft::EmitterSetData, emitterTbl));
+
+        if (!InRange(emitter_table, u64(emitter_num) * sizeof(nw::eft::EmitterTblData), size))
+        {
+            *error = "emitter set " + std::to_string(i) + " lies outside the file";
+            return false;
+        }
+
+        for (u32 j = 0; j < emitter_num; j++)
+        {
+            const u32 record = Load32(data + emitter_table + j * sizeof(nw::eft::EmitterTblData) + offsetof(nw::eft::EmitterTblData, emitter));
+            if (!InRange(record, sizeof(nw::eft::CommonEmitterData), size))
+            {
+                *error = "emitter " + std::to_string(j) + " of set " + std::to_string(i) + " lies outside the file";
+                return false;
+            }
+
+            records->push_back(record);
+
+            for (u32 k = 0; k < cPtclTextureSlotNum; k++)
+            {
+                u32 texture_res;
+                if (!GetPtclTextureRes(data, size, record, k, &texture_res))
+                {
+                    *error = "the child of emitter " + std::to_string(j) + " of set " + std::to_string(i) + " lies outside the file";
+                    return false;
+                }
+
+                if (texture_res == 0)
+                    continue;
+
+                for (u32 kind = 0; kind < PTCL_TEXTURE_DATA_NUM; kind++)
+                {
+                    const u32 position = texture_res + GetPtclTextureDataPos(PtclTextureData(kind));
+                    const u32 offset = Load32(data + position);
+                    const u32 blob_size = Load32(data + texture_res + GetPtclTextureDataSize(PtclTextureData(kind)));
+                    if (blob_size == 0)
+                        continue;
+
+                    if (!InRange(offset, blob_size, texture_table_size))
+                    {
+                        *error = "texture " + std::to_string(k) + " of emitter " + std::to_string(j) + " of set " +
+                                 std::to_string(i) + " lies outside the texture table";
+                        return false;
+                    }
+
+                    // GX2 surfaces are aligned in the file, not in the table
+                    const std::pair<u32, u32> key(offset, blob_size);
+                    auto it = blob_index.find(key);
+                    if (it == blob_index.end())
+                    {
+                        it = blob_index.emplace(key, blobs->size()).first;
+                        blobs->push_back(PtclBlob{ offset, blob_size, GetAlignment(texture_table + offset), 0, u32(blobs->size()), 0 });
+                    }
+
+                    refs->push_back(PtclBlobRef{ position, it->second });
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Bytes of the table covered by at least one of the [begin, end) ranges
+static u32 GetCoveredSize(std::vector<std::pair<u32, u32>> ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+
+    u32 covered = 0;
+    u32 end = 0;
+    for (const std::pair<u32, u32>& range : ranges)
+    {
+        const u32 begin = std::max(range.first, end);
+        if (range.second > begin)
+        {
+            covered += range.second - begin;
+            end = range.second;
+        }
+    }
+
+    return covered;
+}
+
+static inline bool IsSameEntry(const PtclTableEntry& a, const PtclTableEntry& b)
+{
+    if (a.range_num != b.range_num)
+        return false;
+
+    for (u32 i = 0; i < a.range_num; i++)
+        if (a.offset[i] != b.offset[i] || a.size[i] != b.size[i])
+            return false;
+
+    return true;
+}
+
+static inline bool IsEqualEntry(const u8* table, const PtclTableEntry& a, const PtclTableEntry& b)
+{
+    if (a.range_num != b.range_num)
+        return false;
+
+    for (u32 i = 0; i < a.range_num; i++)
+        if (a.size[i] != b.size[i] || std::memcmp(table + a.offset[i], table + b.offset[i], a.size[i]) != 0)
+            return false;
+
+    return true;
+}
+
+// Finds the shader programs or primitives that no record uses and the used
+// ones that repeat an earlier one. Entries pointing at the same data are one
+// entry, so only copies count as duplicates; the bytes of a duplicate that
+// shares a range with another entry are counted in full.
+static bool AnalyzeTable(const u8* data, u32 size, PtclTable table, const std::vector<u32>& records,
+                         PtclOptimizeReport::Saving* saving, std::string* error)
+{
+    static const char* const cTableName[] = { "shader", "primitive" };
+
+    PtclTableLayout layout;
+    if (!GetPtclTableLayout(data, size, table, &layout))
+    {
+        *error = std::string("the ") + cTableName[table] + " table lies outside the file";
+        return false;
+    }
+
+    saving->table_size = layout.size;
+    saving->entry_num = layout.entries.size();
+
+    std::vector<bool> used(layout.entries.size(), false);
+    std::vector<u32> indices;
+    for (u32 record : records)
+    {
+        indices.clear();
+        if (!GetPtclTableRefs(data, size, record, table, &indices))
+        {
+            *error = "the emitter record at " + std::to_string(record) + " lies outside the file";
+            return false;
+        }
+
+        for (u32 index : indices)
+            if (index < used.size())
+                used[index] = true;
+    }
+
+    const u8* const table_data = data + layout.position;
+
+    std::vector<u64> hashes(layout.entries.size(), 0);
+    {
+        ThreadPool pool;
+        for (u32 i = 0; i < layout.entries.size(); i++)
+        {
+            if (!used[i])
+                continue;
+
+            pool.submit([table_data, &layout, &hashes, i]()
+            {
+                const PtclTableEntry& entry = layout.entries[i];
+                u64 hash = entry.range_num;
+                for (u32 j = 0; j < entry.range_num; j++)
+                    hash = HashMix(hash, HashBytes(table_data + entry.offset[j], entry.size[j]));
+
+                hashes[i] = hash;
+            });
+        }
+
+        pool.wait();
+    }
+
+    std::vector<std::pair<u32, u32>> ranges;
+    ranges.emplace_back(0, layout.info_size);
+
+    std::unordered_multimap<u64, u32> kept_by_hash;
+    for (u32 i = 0; i < layout.entries.size(); i++)
+    {
+        const PtclTableEntry& entry = layout.entries[i];
+
+        if (!used[i])
+        {
+            saving->unreferenced_num++;
+            continue;
+        }
+
+        for (u32 j = 0; j < entry.range_num; j++)
+            ranges.emplace_back(entry.offset[j], entry.offset[j] + entry.size[j]);
+
+        // Hashes only narrow the search, the bytes decide
+        bool duplicate = false;
+        bool same = false;
+        const auto range = kept_by_hash.equal_range(hashes[i]);
+        for (auto it = range.first; it != range.second && !duplicate; ++it)
+        {
+            const PtclTableEntry& kept = layout.entries[it->second];
+            if (IsEqualEntry(table_data, kept, entry))
+            {
+                duplicate = true;
+                same = IsSameEntry(kept, entry);
+            }
+        }
+
+        if (!duplicate)
+        {
+            kept_by_hash.emplace(hashes[i], i);
+        }
+        else if (!same)
+        {
+            saving->duplicate_num++;
+            for (u32 j = 0; j < entry.range_num; j++)
+                saving->duplicate_byte_num += entry.size[j];
+        }
+    }
+
+    saving->unused_byte_num = layout.size - GetCoveredSize(std::move(ranges));
+    return true;
+}
+
+bool OptimizePtcl(const u8* data, u32 size, std::vector<u8>* out, PtclOptimizeReport* report, std::string* error)
+{
+    EDITOR_TRACE_SCOPE("OptimizePtcl");
+
+    typedef nw::eft::HeaderData Header;
+
+    const u64 start = Trace::now();
+
+    std::memset(report->size, 0, sizeof(report->size));
+    std::memset(report->saving, 0, sizeof(report->saving));
+
+    if (size < sizeof(Header))
+    {
+        *error = "smaller than a PTCL header";
+        return false;
+    }
+
+    const u32 texture_table = Load32(data + offsetof(Header, textureTblPos));
+    const u32 texture_table_size = Load32(data + offsetof(Header, textureTblSize));
+    const u32 texture_table_end = texture_table + texture_table_size;
+
+    if (!InRange(texture_table, texture_table_size, size))
+    {
+        *error = "the texture table lies outside the file";
+        return false;
+    }
+
+    // Positions in the file that move with the data after the texture table
+    const u32 header_positions[] = {
+        u32(offsetof(Header, nameTblPos)),
+        u32(offsetof(Header, shaderTblPos)),
+        u32(offsetof(Header, animkeyTblPos)),
+        u32(offsetof(Header, primitiveTblPos))
+    };
+
+    std::vector<PtclBlob> blobs;
+    std::vector<PtclBlobRef> refs;
+    std::vector<u32> records;
+    if (!ReadBlobRefs(data, size, texture_table, texture_table_size, &blobs, &refs, &records, error))
+        return false;
+
+    if (!AnalyzeTable(data, size, PTCL_TABLE_SHADER, records, &report->saving[PtclOptimizeReport::CATEGORY_SHADER], error) ||
+        !AnalyzeTable(data, size, PTCL_TABLE_PRIMITIVE, records, &report->saving[PtclOptimizeReport::CATEGORY_PRIMITIVE], error))
+        return false;
+
+    {
+        ThreadPool pool;
+        for (PtclBlob& blob : blobs)
+            pool.submit([data, texture_table, &blob]() { blob.hash = HashBytes(data + texture_table + blob.offset, blob.size); });
+
+        pool.wait();
+    }
+
+    // Blobs in the order of the table, so the first copy of each is kept
+    std::vector<u32> order(blobs.size());
+    for (u32 i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&blobs](u32 a, u32 b) { return blobs[a].offset < blobs[b].offset; });
+
+    PtclOptimizeReport::Saving& texture_saving = report->saving[PtclOptimizeReport::CATEGORY_TEXTURE];
+    texture_saving.table_size = texture_table_size;
+    texture_saving.entry_num = blobs.size();
+
+    {
+        std::vector<std::pair<u32, u32>> ranges;
+        ranges.reserve(blobs.size());
+        for (const PtclBlob& blob : blobs)
+            ranges.emplace_back(blob.offset, blob.offset + blob.size);
+
+        texture_saving.unused_byte_num = texture_table_size - GetCoveredSize(std::move(ranges));
+    }
+
+    std::unordered_multimap<u64, u32> kept_by_hash;
+    for (u32 index : order)
+    {
+        PtclBlob& blob = blobs[index];
+
+        // Hashes only narrow the search, the bytes decide
+        const auto range = kept_by_hash.equal_range(blob.hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            PtclBlob& kept = blobs[it->second];
+            if (kept.size == blob.size && std::memcmp(data + texture_table + kept.offset, data + texture_table + blob.offset, blob.size) == 0)
+            {
+                blob.kept = it->second;
+                kept.alignment = std::max(kept.alignment, blob.alignment);
+                break;
+            }
+        }
+
+        if (blob.kept == index)
+        {
+            kept_by_hash.emplace(blob.hash, index);
+        }
+        else
+        {
+            texture_saving.duplicate_num++;
+            texture_saving.duplicate_byte_num += blob.size;
+        }
+    }
+
+    // Overlapping blobs are stored separately, so the new table can be larger
+    // than the bytes it replaces; nothing is saved then
+    u32 new_table_size = 0;
+    for (u32 index : order)
+    {
+        PtclBlob& blob = blobs[index];
+        if (blob.kept != index)
+            continue;
+
+        blob.new_offset = AlignUp(texture_table + new_table_size, blob.alignment) - texture_table;
+        new_table_size = blob.new_offset + blob.size;
+    }
+
+    // The tables after it keep the alignment of their old positions
+    const u32 tail_alignment = GetAlignment(texture_table_end);
+    const bool rebuild = new_table_size < texture_table_size;
+    const u32 shift = rebuild ? (texture_table_size - new_table_size) / tail_alignment * tail_alignment : 0;
+
+    if (shift == 0)
+    {
+        out->assign(data, data + size);
+    }
+    else
+    {
+        new_table_size = texture_table_size - shift;
+
+        out->assign(size - shift, 0);
+        std::memcpy(out->data(), data, texture_table);
+        std::memcpy(out->data() + texture_table + new_table_size, data + texture_table_end, size - texture_table_end);
+
+        for (u32 i = 0; i < blobs.size(); i++)
+        {
+            if (blobs[i].kept == i)
+                std::memcpy(out->data() + texture_table + blobs[i].new_offset, data + texture_table + blobs[i].offset, blobs[i].size);
+        }
+
+        // Maps a position in the input to the output; records live outside the texture table
+        const auto move = [texture_table_end, shift](u32 position) { return position >= texture_table_end ? position - shift : position; };
+
+        Store32(out->data() + offsetof(Header, textureTblSize), new_table_size);
+        for (u32 position : header_positions)
+            Store32(out->data() + position, move(Load32(data + position)));
+
+        const u32 set_num = Load32(data + offsetof(Header, numEmitterSet));
+        for (u32 i = 0; i < set_num; i++)
+        {
+            const u32 set_data = sizeof(Header) + i * sizeof(nw::eft::EmitterSetData);
+            const u32 emitter_num = Load32(data + set_data + offsetof(nw::eft::EmitterSetData, numEmitter));
+            const u32 emitter_table = Load32(data + set_data + offsetof(nw::eft::EmitterSetData, emitterTbl));
+
+            Store32(out->data() + move(set_data + offsetof(nw::eft::EmitterSetData, emitterTbl)), move(emitter_table));
+
+            for (u32 j = 0; j < emitter_num; j++)
+            {
+                const u32 entry = emitter_table + j * sizeof(nw::eft::EmitterTblData) + offsetof(nw::eft::EmitterTblData, emitter);
+                Store32(out->data() + move(entry), move(Load32(data + entry)));
+            }
+        }
+
+        for (const PtclBlobRef& ref : refs)
+            Store32(out->data() + move(ref.position), blobs[blobs[ref.blob].kept].new_offset);
+    }
+
+    report->size[0] = size;
+    report->size[1] = out->size();
+    texture_saving.saved_byte_num = shift;
+
+    // Every emitter must see the same data as before
+    PtclDiffReport diff;
+    if (!DiffPtcl(data, size, out->data(), out->size(), &diff, error))
+    {
+        *error = "the optimized PTCL cannot be read back: " + *error;
+        return false;
+    }
+
+    if (!diff.isIdentical())
+    {
+        *error = "the optimized PTCL differs from the input";
+        return false;
+    }
+
+    report->optimize_ns = Trace::now() - start;
+    return true;
+}
+
+bool OptimizePtclFile(const std::string& in, const std::string& out, PtclOptimizeReport* report, std::string* error)
+{
+    std::vector<u8> data;
+    if (!ReadWholeFile(in, &data))
+    {
+        *error = "Could not read " + in;
+        return false;
+    }
+
+    std::vector<u8> optimized;
+    if (!OptimizePtcl(data.data(), data.size(), &optimized, report, error))
+    {
+        *error = in + ": " + *error;
+        return false;
+    }
+
+    if (!WriteFileAtomic(out, optimized.data(), optimized.size()))
+    {
+        *error = "Could not write " + out;
+        return false;
+    }
+
+    report->path[0] = in;
+    report->path[1] = out;
+    return true;
+}
+
+void WritePtclOptimizeText(const PtclOptimizeReport& report, std::FILE* file)
+{
+    std::fprintf(file, "%s -> %s\n", report.path[0].c_str(), report.path[1].c_str());
+
+    static const char* const cEntryName[] = { "blobs", "programs", "primitives" };
+
+    for (u32 i = 0; i < PtclOptimizeReport::CATEGORY_NUM; i++)
+    {
+        const PtclOptimizeReport::Saving& saving = report.saving[i];
+
+        std::fprintf(file, "%-10s %10u bytes, %u %s (%u unreferenced), %u duplicates (%u bytes), %u bytes unused, %d bytes saved%s\n",
+                     cCategoryName[i], saving.table_size, saving.entry_num, cEntryName[i], saving.unreferenced_num,
+                     saving.duplicate_num, saving.duplicate_byte_num, saving.unused_byte_num, saving.saved_byte_num,
+                     i == PtclOptimizeReport::CATEGORY_TEXTURE ? "" : ", copied unchanged");
+    }
+
+    std::fprintf(file, "Total: %u -> %u bytes, %d saved, %.2f ms\n", report.size[0], report.size[1],
+                 s32(report.size[0] - report.size[1]), report.optimize_ns / 1000000.0f);
+}
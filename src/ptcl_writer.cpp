@@ -0,0 +1,607 @@
+#include <endian_swap.h>
+#include <file_util.h>
+#include <ptcl_writer.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include <nw/eft/eft_Resource.h>
+
+static constexpr u32 cFieldSizeMax = 256;
+
+// Equal blocks of this size are skipped with one memcmp when comparing files
+static constexpr u32 cCompareBlockSize = 4096;
+
+class FieldTableBuilder
+{
+public:
+    FieldTableBuilder(const void* record, std::vector<PtclWriter::Field>* fields)
+        : mpRecord(static_cast<const u8*>(record))
+        , mpFields(fields)
+    {
+    }
+
+    void setPrefix(const std::string& prefix) { mPrefix = prefix; }
+
+    template <typename T>
+    FieldTableBuilder& add(const T& field, const char* name)
+    {
+        typedef std::remove_all_extents_t<T> Element;
+
+        // Vectors, matrices and colors are made of f32
+        constexpr u32 width = std::is_arithmetic_v<Element> || std::is_enum_v<Element> ? sizeof(Element) : sizeof(f32);
+        static_assert(sizeof(T) % width == 0, "Field is not an array of its element width");
+        static_assert(sizeof(T) <= cFieldSizeMax, "Field too large");
+
+        mpFields->push_back(PtclWriter::Field{ u32(reinterpret_cast<const u8*>(&field) - mpRecord), u32(sizeof(T)), width, mPrefix + name });
+        return *this;
+    }
+
+private:
+    const u8*                       mpRecord;
+    std::vector<PtclWriter::Field>* mpFields;
+    std::string                     mPrefix;
+};
+
+static void BuildFieldTable(const nw::eft::SimpleEmitterData& data, std::vector<PtclWriter::Field>* fields)
+{
+    FieldTableBuilder builder(&data, fields);
+
+    // CommonEmitterData
+    builder.add(data.flg, "flg")
+           .add(data.randomSeed, "randomSeed")
+           .add(data.userData, "userData")
+           .add(data.userData2, "userData2")
+           .add(data.userDataF, "userDataF")
+           .add(data.userCallbackID, "userCallbackID");
+
+    // SimpleEmitterData
+    builder.add(data.isPolygon, "isPolygon")
+           .add(data.isFollowAll, "isFollowAll")
+           .add(data.isEmitterBillboardMtx, "isEmitterBillboardMtx")
+           .add(data.isWorldGravity, "isWorldGravity")
+           .add(data.isDirectional, "isDirectional")
+           .add(data.isStopEmitInFade, "isStopEmitInFade")
+           .add(data.volumeTblIndex, "volumeTblIndex")
+           .add(data.volumeSweepStartRandom, "volumeSweepStartRandom")
+           .add(data.isDisplayParent, "isDisplayParent")
+           .add(data.emitDistEnabled, "emitDistEnabled")
+           .add(data.isVolumeLatitudeEnabled, "isVolumeLatitudeEnabled")
+           .add(data.ptclRotType, "ptclRotType")
+           .add(data.ptclFollowType, "ptclFollowType")
+           .add(data.colorCombinerType, "colorCombinerType")
+           .add(data.alphaCombinerType, "alphaCombinerType")
+           .add(data.drawPath, "drawPath")
+           .add(data.displaySide, "displaySide")
+           .add(data.dynamicsRandom, "dynamicsRandom")
+           .add(data.transformSRT, "transformSRT")
+           .add(data.transformRT, "transformRT")
+           .add(data.scale, "scale")
+           .add(data.rot, "rot")
+           .add(data.trans, "trans")
+           .add(data.rotRnd, "rotRnd")
+           .add(data.transRnd, "transRnd")
+           .add(data.blendType, "blendType")
+           .add(data.zBufATestType, "zBufATestType")
+           .add(data.volumeType, "volumeType")
+           .add(data.volumeRadius, "volumeRadius")
+           .add(data.volumeSweepStart, "volumeSweepStart")
+           .add(data.volumeSweepParam, "volumeSweepParam")
+           .add(data.volumeCaliber, "volumeCaliber")
+           .add(data.volumeLatitude, "volumeLatitude")
+           .add(data.volumeLatitudeDir, "volumeLatitudeDir")
+           .add(data.lineCenter, "lineCenter")
+           .add(data.formScale, "formScale")
+           .add(data.color0, "color0")
+           .add(data.color1, "color1")
+           .add(data.alpha, "alpha")
+           .add(data.emitDistUnit, "emitDistUnit")
+           .add(data.emitDistMax, "emitDistMax")
+           .add(data.emitDistMin, "emitDistMin")
+           .add(data.emitDistMargin, "emitDistMargin")
+           .add(data.emitRate, "emitRate")
+           .add(data.startFrame, "startFrame")
+           .add(data.endFrame, "endFrame")
+           .add(data.lifeStep, "lifeStep")
+           .add(data.lifeStepRnd, "lifeStepRnd")
+           .add(data.figureVel, "figureVel")
+           .add(data.emitterVel, "emitterVel")
+           .add(data.initVelRnd, "initVelRnd")
+           .add(data.emitterVelDir, "emitterVelDir")
+           .add(data.emitterVelDirAngle, "emitterVelDirAngle")
+           .add(data.spreadVec, "spreadVec")
+           .add(data.airRegist, "airRegist")
+           .add(data.gravity, "gravity")
+           .add(data.xzDiffusionVel, "xzDiffusionVel")
+           .add(data.initPosRand, "initPosRand")
+           .add(data.ptclLife, "ptclLife")
+           .add(data.ptclLifeRnd, "ptclLifeRnd")
+           .add(data.meshType, "meshType")
+           .add(data.billboardType, "billboardType")
+           .add(data.rotBasis, "rotBasis")
+           .add(data.toCameraOffset, "toCameraOffset");
+
+    for (u32 i = 0; i < nw::eft::EFT_TEXTURE_SLOT_BIN_MAX; i++)
+    {
+        const nw::eft::TextureEmitterData& texture_data = data.textureData[i];
+
+        builder.setPrefix("textureData[" + std::to_string(i) + "].");
+        builder.add(texture_data.isTexPatAnim, "isTexPatAnim")
+               .add(texture_data.isTexPatAnimRand, "isTexPatAnimRand")
+               .add(texture_data.isTexPatAnimClump, "isTexPatAnimClump")
+               .add(texture_data.numTexDivX, "numTexDivX")
+               .add(texture_data.numTexDivY, "numTexDivY")
+               .add(texture_data.numTexPat, "numTexPat")
+               .add(texture_data.texPatFreq, "texPatFreq")
+               .add(texture_data.texPatTblUse, "texPatTblUse")
+               .add(texture_data.texPatTbl, "texPatTbl")
+               .add(texture_data.texAddressingMode, "texAddressingMode")
+               .add(texture_data.texUScale, "texUScale")
+               .add(texture_data.texVScale, "texVScale")
+               .add(texture_data.uvShiftAnimMode, "uvShiftAnimMode")
+               .add(texture_data.uvScroll, "uvScroll")
+               .add(texture_data.uvScrollInit, "uvScrollInit")
+               .add(texture_data.uvScrollInitRand, "uvScrollInitRand")
+               .add(texture_data.uvScale, "uvScale")
+               .add(texture_data.uvScaleInit, "uvScaleInit")
+               .add(texture_data.uvScaleInitRand, "uvScaleInitRand")
+               .add(texture_data.uvRot, "uvRot")
+               .add(texture_data.uvRotInit, "uvRotInit")
+               .add(texture_data.uvRotInitRand, "uvRotInitRand");
+    }
+
+    builder.setPrefix(std::string());
+    builder.add(data.colorCalcType, "colorCalcType")
+           .add(data.color, "color")
+           .add(data.colorSection1, "colorSection1")
+           .add(data.colorSection2, "colorSection2")
+           .add(data.colorSection3, "colorSection3")
+           .add(data.colorNumRepeat, "colorNumRepeat")
+           .add(data.colorRepeatStartRand, "colorRepeatStartRand")
+           .add(data.colorScale, "colorScale")
+           .add(data.initAlpha, "initAlpha")
+           .add(data.diffAlpha21, "diffAlpha21")
+           .add(data.diffAlpha32, "diffAlpha32")
+           .add(data.alphaSection1, "alphaSection1")
+           .add(data.alphaSection2, "alphaSection2")
+           .add(data.texture1ColorBlend, "texture1ColorBlend")
+           .add(data.primitiveColorBlend, "primitiveColorBlend")
+           .add(data.texture1AlphaBlend, "texture1AlphaBlend")
+           .add(data.primitiveAlphaBlend, "primitiveAlphaBlend")
+           .add(data.scaleSection1, "scaleSection1")
+           .add(data.scaleSection2, "scaleSection2")
+           .add(data.scaleRand, "scaleRand")
+           .add(data.baseScale, "baseScale")
+           .add(data.initScale, "initScale")
+           .add(data.diffScale21, "diffScale21")
+           .add(data.diffScale32, "diffScale32")
+           .add(data.initRot, "initRot")
+           .add(data.initRotRand, "initRotRand")
+           .add(data.rotVel, "rotVel")
+           .add(data.rotVelRand, "rotVelRand")
+           .add(data.rotRegist, "rotRegist")
+           .add(data.alphaAddInFade, "alphaAddInFade")
+           .add(data.shaderType, "shaderType")
+           .add(data.userShaderSetting, "userShaderSetting")
+           .add(data.shaderUseSoftEdge, "shaderUseSoftEdge")
+           .add(data.shaderApplyAlphaToRefract, "shaderApplyAlphaToRefract")
+           .add(data.shaderParam0, "shaderParam0")
+           .add(data.shaderParam1, "shaderParam1")
+           .add(data.softFadeDistance, "softFadeDistance")
+           .add(data.softVolumeParam, "softVolumeParam")
+           .add(data.userShaderDefine1, "userShaderDefine1")
+           .add(data.userShaderDefine2, "userShaderDefine2")
+           .add(data.userShaderFlag, "userShaderFlag")
+           .add(data.userShaderSwitchFlag, "userShaderSwitchFlag")
+           .add(data.userShaderParam.param, "userShaderParam.param");
+
+    std::sort(fields->begin(), fields->end(), [](const PtclWriter::Field& a, const PtclWriter::Field& b) { return a.offset < b.offset; });
+}
+
+// Host-order field bytes as they are stored in the file
+static inline void ToFileOrder(const u8* host, const PtclWriter::Field& field, u8* out)
+{
+    std::memcpy(out, host, field.size);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    switch (field.width)
+    {
+    case 2:     SwapEndian16(out, field.size / 2); break;
+    case 4:     SwapEndian32(out, field.size / 4); break;
+    case 8:     SwapEndian64(out, field.size / 8); break;
+    default:    break;
+    }
+#endif // __BYTE_ORDER__
+}
+
+PtclWriter::PtclWriter()
+    : mpBuffer(nullptr)
+{
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+bool PtclWriter::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+const std::vector<PtclWriter::Field>& PtclWriter::getFieldTable()
+{
+    // Only member addresses are taken, the record is never read
+    alignas(nw::eft::SimpleEmitterData) static const u8 sRecord[sizeof(nw::eft::SimpleEmitterData)] = { };
+
+    static const std::vector<Field> sFields = []()
+    {
+        std::vector<Field> fields;
+        BuildFieldTable(*reinterpret_cast<const nw::eft::SimpleEmitterData*>(sRecord), &fields);
+        return fields;
+    }();
+
+    return sFields;
+}
+
+const EndianSchema& PtclWriter::getRecordSchema()
+{
+    static const EndianSchema sSchema = []()
+    {
+        EndianSchema schema(sizeof(nw::eft::SimpleEmitterData));
+        for (const Field& field : getFieldTable())
+            if (field.width > 1)
+                schema.field(field.offset, field.width, field.size / field.width);
+
+        return schema;
+    }();
+
+    return sSchema;
+}
+
+void PtclWriter::setSource(const u8* data, u32 size, const std::string& path)
+{
+    reset();
+
+    mImage.assign(data, data + size);
+    mPath = path;
+
+    std::error_code error;
+    mWriteTime = std::filesystem::last_write_time(mPath, error);
+}
+
+void PtclWriter::track(const nw::eft::Resource* resource, u8* buffer)
+{
+    EDITOR_TRACE_SCOPE("TrackPtcl");
+
+    mpBuffer = nullptr;
+    mRecords.clear();
+    mFields.clear();
+    mSwapPlan = EndianSwapPlan();
+
+    const u8* const image_end = buffer + mImage.size();
+
+    // Emitters can be shared between sets
+    const nw::eft::SimpleEmitterData* first = nullptr;
+    const u32 set_num = resource->GetNumEmitterSet();
+    for (u32 i = 0; i < set_num; i++)
+    {
+        const u32 emitter_num = resource->GetNumEmitter(i);
+        for (u32 j = 0; j < emitter_num; j++)
+        {
+            // Complex emitters extend simple ones
+            const nw::eft::SimpleEmitterData* data = static_cast<const nw::eft::SimpleEmitterData*>(resource->GetEmitterData(i, j));
+            const u8* record = reinterpret_cast<const u8*>(data);
+            if (record < buffer || record + sizeof(nw::eft::SimpleEmitterData) > image_end)
+                continue;
+
+            if (!first)
+                first = data;
+
+            mRecords.push_back(record - buffer);
+        }
+    }
+
+    std::sort(mRecords.begin(), mRecords.end());
+    mRecords.erase(std::unique(mRecords.begin(), mRecords.end()), mRecords.end());
+
+    if (!first)
+    {
+        RIO_LOG("PtclWriter: no emitter record lies in the file buffer, saving is disabled\n");
+        return;
+    }
+
+    // Records lie after the header, away from the magic
+    mSwapPlan.setTag(0, Load32(mImage.data()));
+    for (u32 record : mRecords)
+        mSwapPlan.addRecords(record, getRecordSchema());
+    mSwapPlan.finalize();
+
+    std::vector<u8> host;
+    getHostImage_(&host);
+
+    const std::vector<Field>& fields = getFieldTable();
+
+    // Keep the fields that read back the file in every record
+    for (const Field& field : fields)
+    {
+        bool matches = true;
+        for (u32 record : mRecords)
+        {
+            const u32 offset = record + field.offset;
+            if (std::memcmp(buffer + offset, host.data() + offset, field.size) != 0)
+            {
+                matches = false;
+                break;
+            }
+        }
+
+        if (matches)
+            mFields.push_back(field);
+    }
+
+    mpBuffer = buffer;
+
+    std::memset(&mStats, 0, sizeof(mStats));
+    mStats.record_num = mRecords.size();
+    mStats.field_num = mFields.size();
+    mStats.dropped_field_num = fields.size() - mFields.size();
+
+    RIO_LOG("PtclWriter: %u emitter records, %u fields each (%u dropped)\n", mStats.record_num, mStats.field_num, mStats.dropped_field_num);
+}
+
+void PtclWriter::reset()
+{
+    mImage.clear();
+    mImage.shrink_to_fit();
+    mPath.clear();
+    mpBuffer = nullptr;
+    mRecords.clear();
+    mFields.clear();
+    mDelta.clear();
+    mSwapPlan = EndianSwapPlan();
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+void PtclWriter::collectChanges_(std::vector<u8>* image)
+{
+    EDITOR_TRACE_SCOPE("CollectPtclChanges");
+
+    mStats.patched_field_num = 0;
+    mStats.patched_byte_num = 0;
+
+    std::vector<u8> host;
+    getHostImage_(&host);
+
+    *image = mImage;
+
+    for (u32 record : mRecords)
+    {
+        for (const Field& field : mFields)
+        {
+            const u32 offset = record + field.offset;
+            if (std::memcmp(mpBuffer + offset, host.data() + offset, field.size) == 0)
+                continue;
+
+            ToFileOrder(mpBuffer + offset, field, image->data() + offset);
+            mStats.patched_field_num++;
+            mStats.patched_byte_num += field.size;
+        }
+    }
+}
+
+void PtclWriter::getEditedImage(std::vector<u8>* image) const
+{
+    EDITOR_TRACE_SCOPE("GetEditedPtcl");
+
+    *image = mImage;
+    if (!isTracking())
+        return;
+
+    for (u32 record : mRecords)
+        for (const Field& field : mFields)
+            ToFileOrder(mpBuffer + record + field.offset, field, image->data() + record + field.offset);
+}
+
+void PtclWriter::getHostImage_(std::vector<u8>* image) const
+{
+    EDITOR_TRACE_SCOPE("SwapPtclRecords");
+
+    *image = mImage;
+
+    [[maybe_unused]] const EndianSwapPlan::Result result = mSwapPlan.apply(image->data(), image->size());
+    RIO_ASSERT(result != EndianSwapPlan::RESULT_INVALID);
+}
+
+void PtclWriter::restoreEdits(const u8* image)
+{
+    EDITOR_TRACE_SCOPE("RestorePtclEdits");
+
+    for (u32 record : mRecords)
+    {
+        for (const Field& field : mFields)
+        {
+            const u32 offset = record + field.offset;
+
+            // Swapping is its own inverse
+            if (std::memcmp(image + offset, mImage.data() + offset, field.size) != 0)
+                ToFileOrder(image + offset, field, mpBuffer + offset);
+        }
+    }
+}
+
+const PtclWriter::Field* PtclWriter::findField_(u32 offset, u32* record) const
+{
+    auto record_it = std::upper_bound(mRecords.begin(), mRecords.end(), offset);
+    if (record_it == mRecords.begin())
+        return nullptr;
+
+    *record = *(record_it - 1);
+    const u32 record_offset = offset - *record;
+
+    auto field_it = std::upper_bound(mFields.begin(), mFields.end(), record_offset,
+                                     [](u32 value, const Field& field) { return value < field.offset; });
+    if (field_it == mFields.begin())
+        return nullptr;
+
+    const Field& field = *(field_it - 1);
+    if (record_offset >= field.offset + field.size)
+        return nullptr;
+
+    return &field;
+}
+
+bool PtclWriter::isOnDisk_(const std::string& path) const
+{
+    if (path != mPath)
+        return false;
+
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) != mImage.size() || error)
+        return false;
+
+    return std::filesystem::last_write_time(path, error) == mWriteTime && !error;
+}
+
+bool PtclWriter::write_(const std::string& path, std::vector<u8>* image)
+{
+    EDITOR_TRACE_SCOPE("WritePtcl");
+
+    if (!WriteFileAtomic(path, image->data(), image->size()))
+        return false;
+
+    mImage.swap(*image);
+
+    std::error_code error;
+    mPath = path;
+    mWriteTime = std::filesystem::last_write_time(mPath, error);
+
+    return true;
+}
+
+PtclWriter::Result PtclWriter::finishSave_(Result result, u64 start)
+{
+    mStats.save_ns = Trace::now() - start;
+    mStats.result = result;
+
+    if (result == RESULT_FAILED)
+    {
+        // The target was left as it was, and so was the kept file
+        RIO_LOG("PtclWriter: failed to save %s\n", mPath.c_str());
+    }
+    else if (result == RESULT_CONFLICT)
+    {
+        RIO_LOG("PtclWriter: %s changed on disk, not saved\n", mPath.c_str());
+    }
+
+    return result;
+}
+
+PtclWriter::Result PtclWriter::save()
+{
+    if (!isTracking())
+        return RESULT_FAILED;
+
+    const u64 start = Trace::now();
+
+    // Writing now would drop whatever replaced or touched the file since
+    if (!isOnDisk_(mPath))
+        return finishSave_(RESULT_CONFLICT, start);
+
+    std::vector<u8> image;
+    collectChanges_(&image);
+
+    if (mStats.patched_field_num == 0)
+        return finishSave_(RESULT_UNCHANGED, start);
+
+    return finishSave_(write_(mPath, &image) ? RESULT_WRITTEN : RESULT_FAILED, start);
+}
+
+PtclWriter::Result PtclWriter::saveAs(const std::string& path)
+{
+    if (!isTracking())
+        return RESULT_FAILED;
+
+    const u64 start = Trace::now();
+
+    std::vector<u8> image;
+    collectChanges_(&image);
+
+    return finishSave_(write_(path, &image) ? RESULT_WRITTEN : RESULT_FAILED, start);
+}
+
+PtclWriter::Delta PtclWriter::compareDelta(const u8* data, u32 size)
+{
+    EDITOR_TRACE_SCOPE("ComparePtcl");
+
+    mDelta.clear();
+
+    if (!isTracking() || size != mImage.size())
+        return DELTA_STRUCTURAL;
+
+    const u8* const image = mImage.data();
+
+    u32 offset = 0;
+    while (offset < size)
+    {
+        const u32 block_end = std::min(offset + cCompareBlockSize, size);
+        if (std::memcmp(image + offset, data + offset, block_end - offset) == 0)
+        {
+            offset = block_end;
+            continue;
+        }
+
+        while (offset < block_end && image[offset] == data[offset])
+            offset++;
+
+        if (offset == block_end)
+            continue;
+
+        u32 record;
+        const Field* field = findField_(offset, &record);
+        if (!field)
+        {
+            mDelta.clear();
+            return DELTA_STRUCTURAL;
+        }
+
+        // The rest of the field is copied along with the first changed byte
+        mDelta.push_back(Patch{ record, *field });
+        offset = record + field->offset + field->size;
+    }
+
+    if (!mDelta.empty())
+        return DELTA_FIELDS;
+
+    // Only touched, the kept file still matches the disk
+    std::error_code error;
+    mWriteTime = std::filesystem::last_write_time(mPath, error);
+
+    return DELTA_UNCHANGED;
+}
+
+void PtclWriter::applyDelta(const u8* data, std::vector<u32>* changed_records)
+{
+    EDITOR_TRACE_SCOPE("ApplyPtclDelta");
+
+    for (const Patch& patch : mDelta)
+    {
+        const u32 offset = patch.record + patch.field.offset;
+        std::memcpy(mImage.data() + offset, data + offset, patch.field.size);
+
+        // Swapping is its own inverse
+        ToFileOrder(data + offset, patch.field, mpBuffer + offset);
+
+        if (changed_records->empty() || changed_records->back() != patch.record)
+            changed_records->push_back(patch.record);
+    }
+
+    mStats.reloaded_field_num = mDelta.size();
+    mDelta.clear();
+
+    // The kept file matches the disk again
+    std::error_code error;
+    mWriteTime = std::filesystem::last_write_time(mPath, error);
+}
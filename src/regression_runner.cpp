@@ -0,0 +1,486 @@
+#include <regression_runner.h>
+#include <eft.h>
+#include <file_util.h>
+#include <image_reader.h>
+#include <image_writer.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+#include <nw/eft/eft_Resource.h>
+#include <nw/eft/eft_System.h>
+
+static const char* const cStatusName[] = {
+    "pass",
+    "updated",
+    "missing",
+    "fail",
+    "error"
+};
+
+// Integer Rec. 601 luma
+static inline s32 GetLuma(const u8* pixel)
+{
+    return (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2]) >> 8;
+}
+
+// Emitter set names are plain identifiers in practice, but keep paths safe
+static inline std::string GetFileName(const std::string& name)
+{
+    std::string file_name = name;
+    for (char& c : file_name)
+    {
+        if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' || c == '-'))
+            c = '_';
+    }
+    return file_name;
+}
+
+static inline std::string EscapeXml(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '&':  escaped += "&amp;";  break;
+        case '<':  escaped += "&lt;";   break;
+        case '>':  escaped += "&gt;";   break;
+        case '"':  escaped += "&quot;"; break;
+        case '\'': escaped += "&apos;"; break;
+        default:   escaped += c;        break;
+        }
+    }
+    return escaped;
+}
+
+// Returns the ratio of pixels that differ perceptibly and fills diff_rgba
+// with them in red over the dimmed golden image
+static f32 CompareImages(const u8* actual, const u8* golden, s32 width, s32 height, u8* diff_rgba)
+{
+    std::vector<u8> golden_luma(width * height);
+    for (s32 i = 0; i < width * height; i++)
+        golden_luma[i] = GetLuma(golden + i * 4);
+
+    u32 diff_num = 0;
+
+    for (s32 y = 0; y < height; y++)
+    {
+        for (s32 x = 0; x < width; x++)
+        {
+            const s32 i = y * width + x;
+            const u8* pixel = actual + i * 4;
+            const s32 luma = GetLuma(pixel);
+            const s32 alpha_delta = std::abs(s32(pixel[3]) - s32(golden[i * 4 + 3]));
+
+            bool matched = false;
+            if (alpha_delta <= RegressionRunner::cLumaTolerance)
+            {
+                for (s32 dy = -1; dy <= 1 && !matched; dy++)
+                {
+                    const s32 ny = y + dy;
+                    if (ny < 0 || ny >= height)
+                        continue;
+
+                    for (s32 dx = -1; dx <= 1 && !matched; dx++)
+                    {
+                        const s32 nx = x + dx;
+                        if (nx < 0 || nx >= width)
+                            continue;
+
+                        if (std::abs(luma - s32(golden_luma[ny * width + nx])) <= RegressionRunner::cLumaTolerance)
+                            matched = true;
+                    }
+                }
+            }
+
+            u8* out = diff_rgba + i * 4;
+            if (matched)
+            {
+                out[0] = out[1] = out[2] = golden_luma[i] / 4;
+            }
+            else
+            {
+                out[0] = 255;
+                out[1] = out[2] = 0;
+                diff_num++;
+            }
+            out[3] = 255;
+        }
+    }
+
+    return f32(diff_num) / (width * height);
+}
+
+RegressionRunner::RegressionRunner()
+    : mRunning(false)
+    , mSetIndex(0)
+    , mStartTime(0)
+    , mTotalMs(0.0f)
+{
+}
+
+RegressionRunner::~RegressionRunner()
+{
+    cancel();
+}
+
+bool RegressionRunner::start(const Settings& settings, const char* resource_name)
+{
+    if (mRunning || !FrameCapture::isSupported())
+        return false;
+
+    const std::string& output_dir = settings.update_golden ? settings.golden_dir : settings.report_dir;
+
+    std::error_code error;
+    std::filesystem::create_directories(output_dir, error);
+    if (error)
+    {
+        RIO_LOG("RegressionRunner: could not create %s\n", output_dir.c_str());
+        return false;
+    }
+
+    mSettings = settings;
+    mResourceName = resource_name;
+
+    const nw::eft::Resource* resource = g_EftSystem->GetResource(0);
+    const u32 set_num = resource->GetNumEmitterSet();
+
+    mResults.clear();
+    mResults.resize(set_num);
+    for (u32 i = 0; i < set_num; i++)
+    {
+        SetResult& result = mResults[i];
+        result.name = resource->GetEmitterSetName(i);
+        result.status = STATUS_ERROR;     // Until its frames come in
+        for (u32 j = 0; j < cCaptureFrameNum; j++)
+            result.frame[j] = FrameResult{ cCaptureFrame[j], STATUS_ERROR, 0.0f };
+        result.frame_num = 0;
+        result.calc_ms = 0.0f;
+        result.render_ms = 0.0f;
+    }
+
+    mpThreadPool.reset(new ThreadPool());
+
+    mSetIndex = 0;
+    mStartTime = Trace::now();
+    mTotalMs = 0.0f;
+    mRunning = true;
+
+    RIO_LOG("RegressionRunner: %u sets, %s golden images in %s\n", set_num, settings.update_golden ? "updating" : "comparing against", settings.golden_dir.c_str());
+    return true;
+}
+
+void RegressionRunner::finish()
+{
+    if (!mRunning)
+        return;
+
+    EDITOR_TRACE_SCOPE("RegressionFinish");
+
+    mpThreadPool->wait();
+    mpThreadPool.reset();
+
+    mTotalMs = (Trace::now() - mStartTime) / 1000000.0f;
+    mRunning = false;
+
+    if (!mSettings.update_golden)
+    {
+        writeJsonReport_();
+        writeJUnitReport_();
+    }
+
+    const Summary summary = getSummary();
+    RIO_LOG("RegressionRunner: %u passed, %u failed, %u missing, %.1f s\n", summary.pass_num, summary.fail_num, summary.missing_num, mTotalMs / 1000.0f);
+}
+
+void RegressionRunner::cancel()
+{
+    if (!mRunning)
+        return;
+
+    mpThreadPool->wait();
+    mpThreadPool.reset();
+
+    mResults.clear();
+    mRunning = false;
+}
+
+bool RegressionRunner::beginSet(u32* out_set_index)
+{
+    RIO_ASSERT(mRunning);
+
+    if (mSetIndex >= mResults.size())
+        return false;
+
+    *out_set_index = mSetIndex;
+    return true;
+}
+
+void RegressionRunner::endSet()
+{
+    RIO_ASSERT(mRunning);
+    mSetIndex++;
+}
+
+FrameCapture::Settings RegressionRunner::getCaptureSettings()
+{
+    const u32 set_index = mSetIndex;
+
+    FrameCapture::Settings settings;
+    settings.width = cSize;
+    settings.height = cSize;
+    settings.frame_num = getFrameNum();
+    settings.format = FrameCapture::FORMAT_SINK;
+    settings.encode_video = false;
+    settings.sink = [this, set_index](u32 frame, const u8* rgba, s32, s32)
+    {
+        return onFrame_(set_index, frame, rgba);
+    };
+    return settings;
+}
+
+void RegressionRunner::addCalcTime(u64 ns)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSetIndex >= mResults.size())
+        return;
+
+    SetResult& result = mResults[mSetIndex];
+    result.calc_ms += ns / 1000000.0f;
+    result.frame_num++;
+}
+
+void RegressionRunner::addRenderTime(u64 ns)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSetIndex >= mResults.size())
+        return;
+
+    mResults[mSetIndex].render_ms += ns / 1000000.0f;
+}
+
+bool RegressionRunner::isPassed() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (const SetResult& result : mResults)
+        if (result.status != STATUS_PASS && result.status != STATUS_UPDATED)
+            return false;
+
+    return !mResults.empty();
+}
+
+RegressionRunner::Summary RegressionRunner::getSummary() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Summary summary = { u32(mResults.size()), mSetIndex, 0, 0, 0 };
+
+    for (u32 i = 0; i < mResults.size() && i < mSetIndex; i++)
+    {
+        switch (mResults[i].status)
+        {
+        case STATUS_PASS:
+        case STATUS_UPDATED:
+            summary.pass_num++;
+            break;
+        case STATUS_MISSING:
+            summary.missing_num++;
+            break;
+        default:
+            summary.fail_num++;
+            break;
+        }
+    }
+
+    return summary;
+}
+
+std::vector<RegressionRunner::SetResult> RegressionRunner::getResults() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mResults;
+}
+
+bool RegressionRunner::onFrame_(u32 set_index, u32 frame, const u8* rgba)
+{
+    const u32* const slot = std::find(cCaptureFrame, cCaptureFrame + cCaptureFrameNum, frame);
+    if (slot == cCaptureFrame + cCaptureFrameNum)
+        return true;
+
+    // The capture's buffer is freed when the sink returns
+    std::vector<u8> pixels(rgba, rgba + cSize * cSize * 4);
+    const u32 frame_slot = slot - cCaptureFrame;
+
+    // Compare on the runner's own pool so the capture can be stopped while
+    // the comparison of this set overlaps the simulation of the next
+    mpThreadPool->submit([this, set_index, frame_slot, pixels = std::move(pixels)]() mutable
+    {
+        compare_(set_index, frame_slot, std::move(pixels));
+    });
+    return true;
+}
+
+void RegressionRunner::compare_(u32 set_index, u32 frame_slot, std::vector<u8> rgba)
+{
+    const u32 frame = cCaptureFrame[frame_slot];
+    const std::string golden_path = getImagePath_(mSettings.golden_dir, set_index, frame, "");
+
+    if (mSettings.update_golden)
+    {
+        const bool written = WritePng(golden_path.c_str(), rgba.data(), cSize, cSize, cSize * 4);
+        setFrameResult_(set_index, frame_slot, written ? STATUS_UPDATED : STATUS_ERROR, 0.0f);
+        return;
+    }
+
+    if (!std::filesystem::exists(golden_path))
+    {
+        setFrameResult_(set_index, frame_slot, STATUS_MISSING, 0.0f);
+        return;
+    }
+
+    std::vector<u8> golden;
+    u32 golden_width = 0;
+    u32 golden_height = 0;
+
+    if (!ReadPng(golden_path.c_str(), &golden, &golden_width, &golden_height) || golden_width != u32(cSize) || golden_height != u32(cSize))
+    {
+        setFrameResult_(set_index, frame_slot, STATUS_ERROR, 0.0f);
+        return;
+    }
+
+    std::vector<u8> diff(cSize * cSize * 4);
+    const f32 diff_ratio = CompareImages(rgba.data(), golden.data(), cSize, cSize, diff.data());
+    const bool passed = diff_ratio <= cDiffRatioMax;
+
+    // Keep what is needed to look into a failure
+    if (!passed)
+    {
+        WritePng(getImagePath_(mSettings.report_dir, set_index, frame, "_actual").c_str(), rgba.data(), cSize, cSize, cSize * 4);
+        WritePng(getImagePath_(mSettings.report_dir, set_index, frame, "_diff").c_str(), diff.data(), cSize, cSize, cSize * 4);
+    }
+
+    setFrameResult_(set_index, frame_slot, passed ? STATUS_PASS : STATUS_FAIL, diff_ratio);
+}
+
+void RegressionRunner::setFrameResult_(u32 set_index, u32 frame_slot, Status status, f32 diff_ratio)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    SetResult& result = mResults[set_index];
+    result.frame[frame_slot].status = status;
+    result.frame[frame_slot].diff_ratio = diff_ratio;
+
+    // A set is as bad as its worst frame
+    result.status = STATUS_PASS;
+    for (u32 i = 0; i < cCaptureFrameNum; i++)
+        result.status = std::max(result.status, result.frame[i].status);
+}
+
+std::string RegressionRunner::getImagePath_(const std::string& directory, u32 set_index, u32 frame, const char* suffix) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "_f%02u%s.png", frame, suffix);
+    return directory + "/" + GetFileName(mResults[set_index].name) + name;
+}
+
+bool RegressionRunner::writeJsonReport_() const
+{
+    const std::string path = mSettings.report_dir + "/regression.json";
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    const Summary summary = getSummary();
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"resource\": \"%s\",\n", EscapeJson(mResourceName).c_str());
+    std::fprintf(file, "  \"size\": %d,\n", cSize);
+    std::fprintf(file, "  \"passed\": %u,\n", summary.pass_num);
+    std::fprintf(file, "  \"failed\": %u,\n", summary.fail_num);
+    std::fprintf(file, "  \"missing\": %u,\n", summary.missing_num);
+    std::fprintf(file, "  \"total_ms\": %.3f,\n", mTotalMs);
+    std::fprintf(file, "  \"sets\": [\n");
+
+    for (u32 i = 0; i < mResults.size(); i++)
+    {
+        const SetResult& result = mResults[i];
+        const u32 frame_num = std::max<u32>(result.frame_num, 1);
+
+        std::fprintf(file, "    {\n");
+        std::fprintf(file, "      \"index\": %u,\n", i);
+        std::fprintf(file, "      \"name\": \"%s\",\n", EscapeJson(result.name).c_str());
+        std::fprintf(file, "      \"status\": \"%s\",\n", cStatusName[result.status]);
+        std::fprintf(file, "      \"calc_ms\": %.4f,\n", result.calc_ms);
+        std::fprintf(file, "      \"render_ms\": %.4f,\n", result.render_ms);
+        std::fprintf(file, "      \"calc_ms_per_frame\": %.4f,\n", result.calc_ms / frame_num);
+        std::fprintf(file, "      \"render_ms_per_frame\": %.4f,\n", result.render_ms / frame_num);
+        std::fprintf(file, "      \"frames\": [");
+
+        for (u32 j = 0; j < cCaptureFrameNum; j++)
+        {
+            const FrameResult& frame = result.frame[j];
+            std::fprintf(file, "%s{ \"frame\": %u, \"status\": \"%s\", \"diff_ratio\": %.6f }",
+                         j == 0 ? " " : ", ", frame.frame, cStatusName[frame.status], frame.diff_ratio);
+        }
+
+        std::fprintf(file, " ]\n");
+        std::fprintf(file, "    }%s\n", i + 1 < mResults.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n");
+    std::fprintf(file, "}\n");
+
+    return std::fclose(file) == 0;
+}
+
+bool RegressionRunner::writeJUnitReport_() const
+{
+    const std::string path = mSettings.report_dir + "/regression.xml";
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    const Summary summary = getSummary();
+    const std::string suite_name = EscapeXml(mResourceName);
+
+    std::fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    std::fprintf(file, "<testsuites>\n");
+    std::fprintf(file, "  <testsuite name=\"%s\" tests=\"%u\" failures=\"%u\" skipped=\"%u\" time=\"%.3f\">\n",
+                 suite_name.c_str(), summary.set_num, summary.fail_num, summary.missing_num, mTotalMs / 1000.0f);
+
+    for (const SetResult& result : mResults)
+    {
+        std::fprintf(file, "    <testcase classname=\"%s\" name=\"%s\" time=\"%.4f\">\n",
+                     suite_name.c_str(), EscapeXml(result.name).c_str(), (result.calc_ms + result.render_ms) / 1000.0f);
+
+        if (result.status == STATUS_MISSING)
+        {
+            std::fprintf(file, "      <skipped message=\"No golden image\"/>\n");
+        }
+        else if (result.status == STATUS_FAIL || result.status == STATUS_ERROR)
+        {
+            for (const FrameResult& frame : result.frame)
+            {
+                if (frame.status == STATUS_FAIL)
+                    std::fprintf(file, "      <failure message=\"Frame %u: %.2f%% of pixels differ\"/>\n", frame.frame, frame.diff_ratio * 100.0f);
+                else if (frame.status == STATUS_ERROR)
+                    std::fprintf(file, "      <failure message=\"Frame %u: could not read the golden image\"/>\n", frame.frame);
+            }
+        }
+
+        std::fprintf(file, "      <system-out>calc %.3f ms, render %.3f ms over %u frames</system-out>\n", result.calc_ms, result.render_ms, result.frame_num);
+        std::fprintf(file, "    </testcase>\n");
+    }
+
+    std::fprintf(file, "  </testsuite>\n");
+    std::fprintf(file, "</testsuites>\n");
+
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,145 @@
+#include <render_queue.h>
+#include <emitter_culler.h>
+
+#include <algorithm>
+
+#include <nw/eft/eft_Emitter.h>
+#include <nw/eft/eft_ResData.h>
+
+struct DrawState
+{
+    s32         draw_path;
+    const void* shader;
+    const void* texture;
+    u32         blend_type;
+    u32         z_buf_a_test_type;
+    u32         display_side;
+
+    bool operator==(const DrawState& rhs) const
+    {
+        return draw_path == rhs.draw_path &&
+               shader == rhs.shader &&
+               texture == rhs.texture &&
+               blend_type == rhs.blend_type &&
+               z_buf_a_test_type == rhs.z_buf_a_test_type &&
+               display_side == rhs.display_side;
+    }
+};
+
+static inline DrawState GetDrawState(const nw::eft::EmitterInstance* emitter)
+{
+    const nw::eft::SimpleEmitterData* data = emitter->data;
+
+    DrawState state;
+    state.draw_path = data->drawPath;
+    state.shader = emitter->shader[nw::eft::EFT_SHADER_TYPE_NORMAL];
+    state.texture = data->texRes[0].gx2Texture.surface.imagePtr;
+    state.blend_type = data->blendType;
+    state.z_buf_a_test_type = data->zBufATestType;
+    state.display_side = data->displaySide;
+    return state;
+}
+
+// Additive and subtractive blending commute as long as nothing writes depth
+static inline bool IsOrderIndependent(const nw::eft::SimpleEmitterData* data)
+{
+    return (data->blendType == nw::eft::EFT_BLEND_TYPE_ADD ||
+            data->blendType == nw::eft::EFT_BLEND_TYPE_SUB) &&
+            data->zBufATestType != nw::eft::EFT_ZBUFF_ATEST_TYPE_ENTITY;
+}
+
+static inline u32 HashPointer(const void* ptr)
+{
+    uintptr value = uintptr(ptr);
+    value ^= value >> 16;
+    value *= 0x45D9F3B;
+    value ^= value >> 16;
+    return u32(value);
+}
+
+RenderQueue::RenderQueue()
+    : mSortEnabled(true)
+    , mStats{ 0, 0, 0, 0 }
+{
+}
+
+void RenderQueue::build(nw::eft::EmitterInstance* head, EmitterCuller* culler)
+{
+    mPackets.clear();
+    mStats.emitter_num = 0;
+
+    u32 run = 0;
+    s32 run_blend_type = -1;    // -1 while the previous packet was order-dependent
+
+    for (nw::eft::EmitterInstance* emitter = head; emitter != NULL; emitter = emitter->next)
+    {
+        mStats.emitter_num++;
+
+        if (culler && !culler->isVisible(emitter))
+            continue;
+
+        const nw::eft::SimpleEmitterData* data = emitter->data;
+        const DrawState state = GetDrawState(emitter);
+
+        if (IsOrderIndependent(data))
+        {
+            if (run_blend_type != s32(data->blendType))
+            {
+                run++;
+                run_blend_type = data->blendType;
+            }
+        }
+        else
+        {
+            run++;
+            run_blend_type = -1;
+        }
+
+        Packet packet;
+        packet.emitter = emitter;
+        packet.sort_key = u64(u8(state.draw_path)) << 56 |
+                          u64(HashPointer(state.shader) & 0xFFFFFF) << 32 |
+                          u64(HashPointer(state.texture) & 0xFFFFFF) << 8 |
+                          u64(state.display_side & 0xFF);
+        packet.order = mPackets.size();
+        packet.run = run;
+        mPackets.push_back(packet);
+    }
+
+    mStats.draw_num = mPackets.size();
+    mStats.state_change_num_unsorted = countStateChanges_(mPackets);
+
+    if (mSortEnabled)
+    {
+        std::sort(mPackets.begin(), mPackets.end(), [](const Packet& a, const Packet& b) {
+            if (a.run != b.run)
+                return a.run < b.run;
+            if (a.sort_key != b.sort_key)
+                return a.sort_key < b.sort_key;
+            return a.order < b.order;
+        });
+
+        mStats.state_change_num_sorted = countStateChanges_(mPackets);
+    }
+    else
+    {
+        mStats.state_change_num_sorted = mStats.state_change_num_unsorted;
+    }
+}
+
+u32 RenderQueue::countStateChanges_(const std::vector<Packet>& packets)
+{
+    u32 count = 0;
+    DrawState prev_state;
+
+    for (u32 i = 0; i < packets.size(); i++)
+    {
+        const DrawState state = GetDrawState(packets[i].emitter);
+        if (i == 0 || !(state == prev_state))
+            count++;
+
+        prev_state = state;
+    }
+
+    return count;
+}
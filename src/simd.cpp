@@ -0,0 +1,29 @@
+#include <simd.h>
+
+SimdLevel GetSimdLevel()
+{
+    static const SimdLevel cLevel = []()
+    {
+#if EDITOR_SIMD_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return SIMD_LEVEL_AVX2;
+#endif // EDITOR_SIMD_AVX2
+#if EDITOR_SIMD_SSE2
+        return SIMD_LEVEL_SSE2;
+#else
+        return SIMD_LEVEL_SCALAR;
+#endif // EDITOR_SIMD_SSE2
+    }();
+
+    return cLevel;
+}
+
+const char* GetSimdLevelName()
+{
+    switch (GetSimdLevel())
+    {
+    case SIMD_LEVEL_AVX2:   return "AVX2";
+    case SIMD_LEVEL_SSE2:   return "SSE2";
+    default:                return "Scalar";
+    }
+}
@@ -0,0 +1,240 @@
+#include <stream_buffer.h>
+#include <trace.h>
+
+#include <cstring>
+
+#if RIO_IS_CAFE
+    #include <cafe/gx2.h>
+    #include <coreinit/cache.h>
+    #include <misc/rio_MemUtil.h>
+#elif RIO_IS_WIN
+    #include <misc/gl/rio_GL.h>
+#endif
+
+StreamBuffer::StreamBuffer()
+    : mpMapped(nullptr)
+    , mpStaging(nullptr)
+    , mBuffer(0)
+    , mRegionSize(0)
+    , mRegionIndex(0)
+    , mRegionUsed(0)
+    , mRegionFlushed(0)
+    , mPersistent(false)
+    , mInFrame(false)
+    , mUploadTime(0)
+{
+    std::memset(mFence, 0, sizeof(mFence));
+    std::memset(mTimeStamp, 0, sizeof(mTimeStamp));
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    finalize();
+}
+
+void StreamBuffer::initialize(u32 region_size)
+{
+    if (isInitialized())
+        return;
+
+    // Keep every region aligned for any vertex format
+    region_size = (region_size + 0xFF) & ~0xFFu;
+    const u32 total_size = region_size * cRegionNum;
+
+#if RIO_IS_CAFE
+    mpMapped = static_cast<u8*>(rio::MemUtil::alloc(total_size, GX2_VERTEX_BUFFER_ALIGNMENT));
+    mPersistent = true;
+#elif RIO_IS_WIN
+    RIO_GL_CALL(glGenBuffers(1, &mBuffer));
+    RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mBuffer));
+
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        RIO_GL_CALL(glBufferStorage(GL_ARRAY_BUFFER, total_size, nullptr, flags));
+        mpMapped = static_cast<u8*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, total_size, flags));
+    }
+
+    if (mpMapped)
+    {
+        mPersistent = true;
+    }
+    else
+    {
+        RIO_GL_CALL(glBufferData(GL_ARRAY_BUFFER, total_size, nullptr, GL_STREAM_DRAW));
+        mpStaging = new u8[region_size];
+        mPersistent = false;
+    }
+
+    RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+#endif
+
+    mRegionSize = region_size;
+    mRegionIndex = 0;
+    mRegionUsed = 0;
+    mStats.persistent = mPersistent;
+
+    RIO_LOG("StreamBuffer: %u bytes x %u regions, %s\n", region_size, cRegionNum, mPersistent ? "persistently mapped" : "staging copy");
+}
+
+void StreamBuffer::finalize()
+{
+    if (!isInitialized())
+        return;
+
+#if RIO_IS_CAFE
+    GX2DrawDone();
+    rio::MemUtil::free(mpMapped);
+#elif RIO_IS_WIN
+    for (u32 i = 0; i < cRegionNum; i++)
+    {
+        if (mFence[i])
+        {
+            RIO_GL_CALL(glDeleteSync(static_cast<GLsync>(mFence[i])));
+            mFence[i] = nullptr;
+        }
+    }
+
+    if (mpMapped)
+    {
+        RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mBuffer));
+        RIO_GL_CALL(glUnmapBuffer(GL_ARRAY_BUFFER));
+        RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
+
+    RIO_GL_CALL(glDeleteBuffers(1, &mBuffer));
+    delete[] mpStaging;
+#endif
+
+    mpMapped = nullptr;
+    mpStaging = nullptr;
+    mBuffer = 0;
+    mRegionSize = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    if (!isInitialized())
+        return;
+
+    RIO_ASSERT(!mInFrame);
+
+    const u64 start = Trace::now();
+
+    // Make sure the GPU is done with the region from cRegionNum frames ago
+#if RIO_IS_CAFE
+    if (mTimeStamp[mRegionIndex] != 0 && GX2GetRetiredTimeStamp() < mTimeStamp[mRegionIndex])
+    {
+        mStats.stall_num++;
+        GX2WaitTimeStamp(mTimeStamp[mRegionIndex]);
+    }
+#elif RIO_IS_WIN
+    if (mFence[mRegionIndex])
+    {
+        GLsync fence = static_cast<GLsync>(mFence[mRegionIndex]);
+
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            mStats.stall_num++;
+            do
+            {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            while (status == GL_TIMEOUT_EXPIRED);
+        }
+
+        RIO_GL_CALL(glDeleteSync(fence));
+        mFence[mRegionIndex] = nullptr;
+    }
+#endif
+
+    mUploadTime = Trace::now() - start;
+    mRegionUsed = 0;
+    mRegionFlushed = 0;
+    mStats.bytes_uploaded = 0;
+    mInFrame = true;
+}
+
+void* StreamBuffer::allocate(u32 size, u32 alignment, u32* out_offset)
+{
+    if (!mInFrame)
+        return nullptr;
+
+    const u32 offset = (mRegionUsed + alignment - 1) / alignment * alignment;
+    if (offset + size > mRegionSize)
+        return nullptr;
+
+    mRegionUsed = offset + size;
+
+    if (out_offset)
+        *out_offset = mRegionIndex * mRegionSize + offset;
+
+    if (mPersistent)
+        return mpMapped + mRegionIndex * mRegionSize + offset;
+    else
+        return mpStaging + offset;
+}
+
+void StreamBuffer::flush()
+{
+    if (!mInFrame || mRegionFlushed == mRegionUsed)
+        return;
+
+    const u64 start = Trace::now();
+
+    const u32 offset = mRegionFlushed;
+    const u32 size = mRegionUsed - mRegionFlushed;
+
+#if RIO_IS_CAFE
+    void* data = mpMapped + mRegionIndex * mRegionSize + offset;
+    DCFlushRange(data, size);
+    GX2Invalidate(GX2_INVALIDATE_CPU_ATTRIB_BUFFER, data, size);
+#elif RIO_IS_WIN
+    if (!mPersistent)
+    {
+        RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mBuffer));
+        RIO_GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, mRegionIndex * mRegionSize + offset, size, mpStaging + offset));
+        RIO_GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        mStats.bytes_uploaded += size;
+    }
+#endif
+
+    mRegionFlushed = mRegionUsed;
+    mUploadTime += Trace::now() - start;
+}
+
+void StreamBuffer::endFrame()
+{
+    if (!mInFrame)
+        return;
+
+    // Draws have already been issued, so uploading here would be too late
+    RIO_ASSERT(mRegionFlushed == mRegionUsed);
+
+    const u64 start = Trace::now();
+
+    mStats.bytes_written = mRegionUsed;
+
+#if RIO_IS_CAFE
+    mTimeStamp[mRegionIndex] = GX2GetLastSubmittedTimeStamp() + 1;
+#elif RIO_IS_WIN
+    mFence[mRegionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+
+    mUploadTime += Trace::now() - start;
+    mStats.upload_time_us = mUploadTime / 1000.0f;
+
+    mRegionIndex = (mRegionIndex + 1) % cRegionNum;
+    mInFrame = false;
+}
+
+uintptr StreamBuffer::getNativeHandle() const
+{
+#if RIO_IS_CAFE
+    return uintptr(mpMapped);
+#else
+    return mBuffer;
+#endif
+}
@@ -0,0 +1,474 @@
+#include <texture_streamer.h>
+#include <simd.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if RIO_IS_WIN
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+static inline Gx2SurfaceInfo GetSurfaceInfo(const GX2Surface& surface)
+{
+    Gx2SurfaceInfo info;
+    info.format = surface.format;
+    info.width = surface.width;
+    info.height = surface.height;
+    info.pitch = surface.pitch;
+    info.tile_mode = surface.tileMode;
+    info.swizzle = surface.swizzle;
+    info.image = static_cast<const u8*>(surface.imagePtr);
+    info.image_size = surface.imageSize;
+    return info;
+}
+
+static inline rio::TextureFormat GetCompressedTextureFormat(u32 format)
+{
+    switch (GetGx2BcIndex(format))
+    {
+    case 1:     return rio::TEXTURE_FORMAT_BC1_UNORM;
+    case 2:     return rio::TEXTURE_FORMAT_BC2_UNORM;
+    case 3:     return rio::TEXTURE_FORMAT_BC3_UNORM;
+    case 4:     return rio::TEXTURE_FORMAT_BC4_UNORM;
+    default:    return rio::TEXTURE_FORMAT_BC5_UNORM;
+    }
+}
+
+#if RIO_IS_WIN
+
+// sRGB variants are uploaded as UNORM, like the RGBA8 path decodes them
+static inline GLenum GetCompressedGLFormat(u32 format)
+{
+    switch (GetGx2BcIndex(format))
+    {
+    case 1:     return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case 2:     return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    case 3:     return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case 4:     return GL_COMPRESSED_RED_RGTC1;
+    default:    return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+#endif // RIO_IS_WIN
+
+// Detiles only when the blocks are kept compressed
+static bool DecodeForUpload(const Gx2SurfaceInfo& info, bool keep_compressed, std::vector<u8>* out)
+{
+    if (!keep_compressed)
+        return DecodeGx2Surface(info, out);
+
+    out->resize(GetGx2ElementWidth(info) * GetGx2ElementHeight(info) * GetGx2FormatBpp(info.format) / 8);
+    return DetileGx2Surface(info, out->data());
+}
+
+TextureStreamer::TextureStreamer()
+    : mGeneration(0)
+    , mPendingNum(0)
+    , mpPlaceholder(nullptr)
+    , mPixelBuffer(0)
+    , mpBakedCache(nullptr)
+    , mpResource(nullptr)
+    , mResourceSize(0)
+    , mBaking(false)
+    , mS3tcSupported(false)
+    , mRgtcSupported(false)
+{
+    std::memset(&mStats, 0, sizeof(mStats));
+    std::memset(&mBenchmark, 0, sizeof(mBenchmark));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    finalize();
+}
+
+bool TextureStreamer::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+void TextureStreamer::initialize()
+{
+    if (isInitialized() || !isSupported())
+        return;
+
+    u8 checker[cPlaceholderSize * cPlaceholderSize * 4];
+    for (s32 y = 0; y < cPlaceholderSize; y++)
+    {
+        for (s32 x = 0; x < cPlaceholderSize; x++)
+        {
+            const u8 value = ((x ^ y) & 1) ? 0x60 : 0xA0;
+            u8* texel = checker + (y * cPlaceholderSize + x) * 4;
+            texel[0] = texel[1] = texel[2] = value;
+            texel[3] = 255;
+        }
+    }
+
+    mpPlaceholder = new rio::Texture2D(rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM, cPlaceholderSize, cPlaceholderSize, 1);
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, GLuint(mpPlaceholder->getNativeTextureHandle())));
+    RIO_GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    RIO_GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cPlaceholderSize, cPlaceholderSize, GL_RGBA, GL_UNSIGNED_BYTE, checker));
+    RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+
+    RIO_GL_CALL(glGenBuffers(1, &mPixelBuffer));
+
+    mS3tcSupported = GLEW_EXT_texture_compression_s3tc;
+    mRgtcSupported = GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+#endif // RIO_IS_WIN
+
+    mpPlaceholder->setCompMap(0x00010205);
+
+    // Decoding only, uploads stay on the main thread
+    mpThreadPool.reset(new ThreadPool());
+}
+
+void TextureStreamer::finalize()
+{
+    if (!isInitialized())
+        return;
+
+    reset();
+    mpThreadPool.reset();
+
+#if RIO_IS_WIN
+    RIO_GL_CALL(glDeleteBuffers(1, &mPixelBuffer));
+    mPixelBuffer = 0;
+#endif // RIO_IS_WIN
+
+    delete mpPlaceholder;
+    mpPlaceholder = nullptr;
+}
+
+void TextureStreamer::reset()
+{
+    if (!isInitialized())
+        return;
+
+    // Pending decodes still read the old image data
+    mpThreadPool->wait();
+
+    for (auto& it : mEntries)
+        delete it.second.texture;
+
+    mEntries.clear();
+    mDecoded.clear();
+    mUploadQueue.clear();
+    mGeneration++;
+    mPendingNum = 0;
+
+    mpBakedCache = nullptr;
+    mpResource = nullptr;
+    mResourceSize = 0;
+
+    std::memset(&mStats, 0, sizeof(mStats));
+    std::memset(&mBenchmark, 0, sizeof(mBenchmark));
+}
+
+void TextureStreamer::setBakedCache(const BakedCache* cache, const void* resource, u32 resource_size)
+{
+    mpBakedCache = cache;
+    mpResource = static_cast<const u8*>(resource);
+    mResourceSize = resource_size;
+}
+
+bool TextureStreamer::getBaked_(const Gx2SurfaceInfo& info, Decoded* out) const
+{
+    if (!mpBakedCache || info.image < mpResource || info.image >= mpResource + mResourceSize)
+        return false;
+
+    const BakedCache::TextureRecord* record = mpBakedCache->findTexture(info.image - mpResource);
+    if (!record || record->width != info.width || record->height != info.height || record->size == 0)
+        return false;
+
+    // Baked by a driver with other compressed formats
+    if (record->compressed_format != 0 && !canKeepCompressed_(record->compressed_format))
+        return false;
+
+    out->width = record->width;
+    out->height = record->height;
+    out->compressed_format = record->compressed_format;
+    out->baked = BakedCache::getData(*record);
+    out->baked_size = record->size;
+    return true;
+}
+
+void TextureStreamer::bake(const std::string& path, const std::string& source_hash, const std::vector<GX2Texture>& textures,
+                           const void* resource, u32 resource_size)
+{
+    if (!isInitialized() || mBaking)
+        return;
+
+    const u8* begin = static_cast<const u8*>(resource);
+    const u8* end = begin + resource_size;
+
+    std::vector<BakedCache::Texture> baked;
+    std::vector<Gx2SurfaceInfo> infos;
+    std::vector<bool> keep_compressed;
+
+    for (const GX2Texture& texture : textures)
+    {
+        const Gx2SurfaceInfo info = GetSurfaceInfo(texture.surface);
+        if (info.image < begin || info.image >= end)
+            continue;
+
+        const u32 source_offset = info.image - begin;
+        if (std::any_of(baked.begin(), baked.end(), [source_offset](const BakedCache::Texture& t) { return t.source_offset == source_offset; }))
+            continue;
+
+        baked.push_back(BakedCache::Texture{ source_offset, info.width, info.height, 0, { } });
+        infos.push_back(info);
+        keep_compressed.push_back(canKeepCompressed_(info.format));
+    }
+
+    if (baked.empty())
+        return;
+
+    mBaking = true;
+
+    mpThreadPool->submit([this, path, source_hash, baked = std::move(baked), infos = std::move(infos), keep_compressed = std::move(keep_compressed)]() mutable
+    {
+        std::vector<BakedCache::Texture> written;
+        written.reserve(baked.size());
+
+        for (u32 i = 0; i < baked.size(); i++)
+        {
+            // Failed ones are left out and decoded at run time like before
+            if (!DecodeForUpload(infos[i], keep_compressed[i], &baked[i].data))
+                continue;
+
+            baked[i].compressed_format = keep_compressed[i] ? infos[i].format : 0;
+            written.push_back(std::move(baked[i]));
+        }
+
+        const u32 texture_num = written.size();
+        if (BakedCache::write(path, source_hash, std::move(written)))
+            RIO_LOG("Baked %u textures to %s\n", texture_num, path.c_str());
+        else
+            RIO_LOG("Could not write the baked cache %s\n", path.c_str());
+
+        mBaking = false;
+    });
+}
+
+const rio::Texture2D* TextureStreamer::get(const GX2Texture& texture)
+{
+    if (!isInitialized())
+        return nullptr;
+
+    const void* key = texture.surface.imagePtr;
+    if (!key)
+        return mpPlaceholder;
+
+    auto it = mEntries.find(key);
+    if (it != mEntries.end())
+        return it->second.state == STATE_READY ? it->second.texture : mpPlaceholder;
+
+    const Gx2SurfaceInfo info = GetSurfaceInfo(texture.surface);
+    mEntries.emplace(key, Entry{ STATE_DECODING, nullptr, texture.compSel, info });
+    mPendingNum++;
+
+    // Already decoded in the baked cache, only the upload is left
+    Decoded baked;
+    baked.key = key;
+    baked.generation = mGeneration;
+    baked.decode_time = 0;
+    if (getBaked_(info, &baked))
+    {
+        mUploadQueue.push_back(std::move(baked));
+        return mpPlaceholder;
+    }
+
+#if RIO_IS_WIN
+    const u32 generation = mGeneration;
+    const bool keep_compressed = canKeepCompressed_(info.format);
+
+    mpThreadPool->submit([this, key, generation, info, keep_compressed]()
+    {
+        const u64 start = Trace::now();
+
+        Decoded decoded;
+        decoded.key = key;
+        decoded.generation = generation;
+        decoded.width = info.width;
+        decoded.height = info.height;
+        decoded.compressed_format = keep_compressed ? info.format : 0;
+        decoded.baked = nullptr;
+        decoded.baked_size = 0;
+
+        if (!DecodeForUpload(info, keep_compressed, &decoded.data))
+            decoded.data.clear();
+        decoded.decode_time = Trace::now() - start;
+
+        std::lock_guard<std::mutex> lock(mDecodedMutex);
+        mDecoded.push_back(std::move(decoded));
+    });
+#endif // RIO_IS_WIN
+
+    return mpPlaceholder;
+}
+
+bool TextureStreamer::isReady(const GX2Texture& texture) const
+{
+    auto it = mEntries.find(texture.surface.imagePtr);
+    return it != mEntries.end() && it->second.state == STATE_READY;
+}
+
+void TextureStreamer::calc()
+{
+    if (!isInitialized())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mDecodedMutex);
+        for (Decoded& decoded : mDecoded)
+            mUploadQueue.push_back(std::move(decoded));
+        mDecoded.clear();
+    }
+
+    if (mUploadQueue.empty())
+        return;
+
+    EDITOR_TRACE_SCOPE("TextureUpload");
+
+    // Always make progress, even on a texture larger than the budget
+    u32 uploaded = 0;
+    while (!mUploadQueue.empty() && (uploaded == 0 || uploaded + mUploadQueue.front().getSize() <= cUploadBudget))
+    {
+        const Decoded decoded = std::move(mUploadQueue.front());
+        mUploadQueue.pop_front();
+
+        if (decoded.generation != mGeneration)
+            continue;
+
+        auto it = mEntries.find(decoded.key);
+        if (it == mEntries.end())
+            continue;
+
+        mPendingNum--;
+        mStats.decode_ms += decoded.decode_time / 1000000.0f;
+
+        Entry& entry = it->second;
+        if (decoded.getSize() == 0)
+        {
+            entry.state = STATE_FAILED;
+            mStats.failed_num++;
+            continue;
+        }
+
+        upload_(entry, decoded);
+        uploaded += decoded.getSize();
+    }
+
+    mStats.uploaded_bytes += uploaded;
+}
+
+bool TextureStreamer::canKeepCompressed_(u32 format) const
+{
+    // Signed BC4 and BC5 would sample as [-1, 1], the decoder remaps them for display
+    if (IsGx2FormatSigned(format))
+        return false;
+
+    switch (GetGx2BcIndex(format))
+    {
+    case 1:
+    case 2:
+    case 3:
+        return mS3tcSupported;
+    case 4:
+    case 5:
+        return mRgtcSupported;
+    default:
+        return false;
+    }
+}
+
+void TextureStreamer::upload_(Entry& entry, const Decoded& decoded)
+{
+    const bool compressed = decoded.compressed_format != 0;
+    const rio::TextureFormat format = compressed ? GetCompressedTextureFormat(decoded.compressed_format) : rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM;
+    entry.texture = new rio::Texture2D(format, decoded.width, decoded.height, 1);
+
+    const u32 size = decoded.getSize();
+
+#if RIO_IS_WIN
+    // Orphan the buffer so the copy never waits for the previous upload
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer));
+    RIO_GL_CALL(glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW));
+
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        std::memcpy(mapped, decoded.getData(), size);
+        RIO_GL_CALL(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    }
+    else
+    {
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    }
+
+    const void* pixels = mapped ? nullptr : decoded.getData();
+
+    RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, GLuint(entry.texture->getNativeTextureHandle())));
+    if (compressed)
+    {
+        RIO_GL_CALL(glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, decoded.width, decoded.height, GetCompressedGLFormat(decoded.compressed_format), size, pixels));
+    }
+    else
+    {
+        RIO_GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        RIO_GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, decoded.width, decoded.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+    }
+    RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+#endif // RIO_IS_WIN
+
+    // Same component selection the emitters sample the texture with, applied
+    // as GL swizzles
+    entry.texture->setCompMap(entry.comp_sel);
+    entry.state = STATE_READY;
+
+    mStats.ready_num++;
+    mStats.texture_bytes += size;
+    mStats.rgba8_bytes += u64(decoded.width) * decoded.height * 4;
+    if (compressed)
+        mStats.compressed_num++;
+    if (decoded.baked)
+        mStats.baked_num++;
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const
+{
+    Stats stats = mStats;
+    stats.pending_num = mPendingNum;
+    return stats;
+}
+
+void TextureStreamer::runBenchmark()
+{
+    if (!isInitialized())
+        return;
+
+    EDITOR_TRACE_SCOPE("TextureBenchmark");
+
+    std::memset(&mBenchmark, 0, sizeof(mBenchmark));
+    for (const auto& it : mEntries)
+        BenchmarkGx2Surface(it.second.info, &mBenchmark);
+
+    RIO_LOG("Texture decode benchmark (%s): %u surfaces, %.2f MP\n",
+            GetSimdLevelName(), mBenchmark.surface_num, mBenchmark.texel_num / 1000000.0f);
+    RIO_LOG("  Detile:  %.1f MP/s scalar, %.1f MP/s vectorized\n",
+            GetGx2BenchmarkRate(mBenchmark.texel_num, mBenchmark.detile_scalar_ns),
+            GetGx2BenchmarkRate(mBenchmark.texel_num, mBenchmark.detile_simd_ns));
+    RIO_LOG("  Convert: %.1f MP/s scalar, %.1f MP/s vectorized\n",
+            GetGx2BenchmarkRate(mBenchmark.texel_num, mBenchmark.convert_scalar_ns),
+            GetGx2BenchmarkRate(mBenchmark.texel_num, mBenchmark.convert_simd_ns));
+    if (mBenchmark.mismatch_num > 0)
+        RIO_LOG("  %u surfaces decoded differently from the scalar reference\n", mBenchmark.mismatch_num);
+}
@@ -0,0 +1,84 @@
+#include <thread_pool.h>
+#include <trace.h>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(u32 thread_num)
+    : mActiveNum(0)
+    , mExit(false)
+{
+    if (thread_num == 0)
+        thread_num = std::max(std::thread::hardware_concurrency(), 2u) - 1;   // Which may be 0 if unknown
+
+    for (u32 i = 0; i < thread_num; i++)
+        mThreads.emplace_back(&ThreadPool::workerMain_, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mJobAvailable.notify_all();
+
+    for (std::thread& thread : mThreads)
+        thread.join();
+}
+
+void ThreadPool::submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mJobAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    waitPending(0);
+}
+
+void ThreadPool::waitPending(u32 pending_num)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJobDone.wait(lock, [this, pending_num] { return mJobs.size() + mActiveNum <= pending_num; });
+}
+
+u32 ThreadPool::getPendingNum() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mJobs.size() + mActiveNum;
+}
+
+void ThreadPool::workerMain_()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobAvailable.wait(lock, [this] { return mExit || !mJobs.empty(); });
+
+            // Drain the queue before exiting so no submitted work is lost
+            if (mJobs.empty())
+                return;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mActiveNum++;
+        }
+
+        {
+            EDITOR_TRACE_SCOPE("ThreadPoolJob");
+            job();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mActiveNum--;
+        }
+        mJobDone.notify_all();
+    }
+}
@@ -0,0 +1,466 @@
+#include <thumbnail_cache.h>
+#include <eft.h>
+#include <file_util.h>
+#include <image_reader.h>
+#include <image_writer.h>
+#include <ptcl_writer.h>
+#include <trace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include <nw/eft/eft_EmitterSet.h>
+#include <nw/eft/eft_ResData.h>
+#include <nw/eft/eft_Resource.h>
+#include <nw/eft/eft_System.h>
+
+#if RIO_IS_WIN
+    #include <md5.hpp>
+    #include <misc/gl/rio_GL.h>
+#endif // RIO_IS_WIN
+
+static constexpr u32 cFrameSize = ThumbnailCache::cSize * ThumbnailCache::cSize * 4;
+
+// Hash of everything in the set that affects how it looks. Eft relocates the
+// records when entering the resource, so only the fields PtclWriter knows and
+// the texture images are hashed, never pointers or positions, and the key
+// stays the same across launches.
+static std::string HashEmitterSet(const nw::eft::Resource* resource, u32 set_index)
+{
+#if RIO_IS_WIN
+    const nw::eft::EmitterSetData* set_data = resource->GetEmitterSetData(set_index);
+    const std::vector<PtclWriter::Field>& fields = PtclWriter::getFieldTable();
+
+    MD5 md5;
+    md5.update(set_data->name, std::strlen(set_data->name));
+
+    for (u32 i = 0; i < set_data->numEmitter; i++)
+    {
+        const nw::eft::CommonEmitterData* data = set_data->emitterTbl[i].emitter;
+        const u8* record = reinterpret_cast<const u8*>(data);
+        const u32 size = data->type == nw::eft::EFT_EMITTER_TYPE_SIMPLE ? sizeof(nw::eft::SimpleEmitterData)
+                                                                         : sizeof(nw::eft::ComplexEmitterData);
+
+        md5.update(reinterpret_cast<const char*>(&data->type), sizeof(data->type));
+
+        for (const PtclWriter::Field& field : fields)
+            if (field.offset + field.size <= size)
+                md5.update(reinterpret_cast<const char*>(record + field.offset), field.size);
+
+        for (const auto& texture_res : data->texRes)
+        {
+            const GX2Surface& surface = texture_res.gx2Texture.surface;
+            const u64 texture_hash[] = {
+                u64(surface.width) << 32 | surface.height,
+                u64(surface.format) << 32 | surface.mipLevels,
+                surface.imagePtr ? HashBytes(static_cast<const u8*>(surface.imagePtr), surface.imageSize) : 0
+            };
+            md5.update(reinterpret_cast<const char*>(texture_hash), sizeof(texture_hash));
+        }
+    }
+
+    // Bump when the thumbnail framing or format changes
+    md5.update("thumbnail-v2", 12);
+
+    return md5.finalize().hexdigest();
+#else
+    return std::string();
+#endif // RIO_IS_WIN
+}
+
+ThumbnailCache::ThumbnailCache()
+    : mGeneration(0)
+    , mLoadingNum(0)
+    , mRenderSet(-1)
+    , mRenderFrame(0)
+    , mRenderPending(false)
+    , mpDepthTexture(nullptr)
+{
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    finalize();
+}
+
+bool ThumbnailCache::isSupported()
+{
+#if RIO_IS_WIN
+    return true;
+#else
+    return false;
+#endif // RIO_IS_WIN
+}
+
+void ThumbnailCache::initialize(const std::string& directory, const nw::math::MTX34& set_mtx)
+{
+    if (isInitialized() || !isSupported())
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    mDirectory = directory;
+    mSetMtx = set_mtx;
+
+    mpDepthTexture = new rio::Texture2D(rio::DEPTH_TEXTURE_FORMAT_R32_FLOAT, cSize, cSize, 1);
+    mRenderBuffer.setRenderTargetColor(&mColorTarget);
+    mRenderBuffer.setRenderTargetDepth(&mDepthTarget);
+    mRenderBuffer.setSize(cSize, cSize);
+    mDepthTarget.linkTexture2D(*mpDepthTexture);
+
+    const f32 half = cViewExtent * 0.5f;
+    mProjection.set(
+        -1000.0f,   // Near
+         1000.0f,   // Far
+         half,      // Top
+        -half,      // Bottom
+        -half,      // Left
+         half       // Right
+    );
+
+    // IO and PNG coding only, rendering stays on the main thread
+    mpThreadPool.reset(new ThreadPool(2));
+}
+
+void ThumbnailCache::finalize()
+{
+    if (!isInitialized())
+        return;
+
+    reset();
+    mpThreadPool.reset();
+
+    delete mpDepthTexture;
+    mpDepthTexture = nullptr;
+}
+
+void ThumbnailCache::reset()
+{
+    if (!isInitialized())
+        return;
+
+    if (mHandle.IsValid())
+        mHandle.GetEmitterSet()->Kill();
+
+    mRenderSet = -1;
+    mRenderPending = false;
+
+    // Pending writes still finish, pending loads are dropped by generation
+    collectReadbacks_(true);
+    mpThreadPool->wait();
+
+    for (Entry& entry : mEntries)
+        delete entry.texture;
+
+    mEntries.clear();
+    mQueue.clear();
+    mLoaded.clear();
+    mGeneration++;
+    mLoadingNum = 0;
+
+    std::memset(&mStats, 0, sizeof(mStats));
+}
+
+void ThumbnailCache::invalidate(u32 set_index)
+{
+    if (!isInitialized() || set_index >= mEntries.size())
+        return;
+
+    Entry& entry = mEntries[set_index];
+
+    // A load or render in flight would finish with the old look
+    if (entry.state == STATE_LOADING || entry.state == STATE_RENDERING)
+    {
+        reset();
+        return;
+    }
+
+    // Queued sets are hashed when they start
+    if (entry.state == STATE_QUEUED)
+        return;
+
+    if (entry.state == STATE_READY)
+        mStats.ready_num--;
+
+    delete entry.texture;
+    entry.texture = nullptr;
+    entry.hash.clear();
+    entry.state = STATE_NONE;
+}
+
+void ThumbnailCache::request(u32 set_index)
+{
+    if (!isInitialized())
+        return;
+
+    if (mEntries.empty())
+    {
+        const u32 set_num = g_EftSystem->GetResource(0)->GetNumEmitterSet();
+        mEntries.resize(set_num, Entry{ STATE_NONE, std::string(), nullptr });
+    }
+
+    if (set_index >= mEntries.size())
+        return;
+
+    Entry& entry = mEntries[set_index];
+    if (entry.state == STATE_NONE)
+    {
+        entry.state = STATE_QUEUED;
+        mQueue.push_back(set_index);
+    }
+    else if (entry.state == STATE_QUEUED)
+    {
+        // Still on screen, move it to the front
+        mQueue.erase(std::find(mQueue.begin(), mQueue.end(), set_index));
+        mQueue.push_back(set_index);
+    }
+}
+
+const rio::Texture2D* ThumbnailCache::getTexture(u32 set_index) const
+{
+    if (set_index >= mEntries.size() || mEntries[set_index].state != STATE_READY)
+        return nullptr;
+
+    return mEntries[set_index].texture;
+}
+
+const rio::Texture2D& ThumbnailCache::getRenderColorTexture() const
+{
+    RIO_ASSERT(mRenderSet >= 0);
+    return *mEntries[mRenderSet].texture;
+}
+
+void ThumbnailCache::calc()
+{
+    if (!isInitialized())
+        return;
+
+    uploadLoaded_();
+    collectReadbacks_(false);
+
+    if (mRenderSet >= 0)
+    {
+        mRenderFrame++;
+
+        // Sets that end early are taken at their last frame
+        const bool alive = mHandle.IsValid() && mHandle.GetEmitterSet()->IsAlive();
+        mRenderPending = mRenderFrame >= cCaptureFrame || !alive;
+    }
+    else
+    {
+        startNext_();
+    }
+
+    mStats.queued_num = mQueue.size();
+}
+
+void ThumbnailCache::startNext_()
+{
+    // Requests are served newest first; rows that scrolled away long ago
+    // are still served eventually
+    while (!mQueue.empty())
+    {
+        const u32 set_index = mQueue.back();
+        mQueue.pop_back();
+
+        Entry& entry = mEntries[set_index];
+        if (entry.state != STATE_QUEUED)
+            continue;
+
+        entry.hash = HashEmitterSet(g_EftSystem->GetResource(0), set_index);
+
+        const std::string path = getPath_(entry);
+        if (std::filesystem::exists(path))
+        {
+            entry.state = STATE_LOADING;
+            mLoadingNum++;
+
+            const u32 generation = mGeneration;
+            mpThreadPool->submit([this, set_index, generation, path]()
+            {
+                Loaded loaded;
+                loaded.set_index = set_index;
+                loaded.generation = generation;
+
+                u32 width = 0;
+                u32 height = 0;
+                if (!ReadPng(path.c_str(), &loaded.rgba, &width, &height) || width != u32(cSize) || height != u32(cSize))
+                    loaded.rgba.clear();
+
+                std::lock_guard<std::mutex> lock(mLoadedMutex);
+                mLoaded.push_back(std::move(loaded));
+            });
+            continue;   // Loads are cheap, keep going
+        }
+
+        EDITOR_TRACE_SCOPE("CreateThumbnailSet");
+
+        if (!g_EftSystem->CreateEmitterSetID(&mHandle, mSetMtx, set_index, 0, cEftGroup))
+        {
+            entry.state = STATE_FAILED;
+            continue;
+        }
+
+        createTexture_(entry);
+        entry.state = STATE_RENDERING;
+        mRenderSet = set_index;
+        mRenderFrame = 0;
+        mRenderPending = false;
+        return;
+    }
+}
+
+void ThumbnailCache::beginRender()
+{
+    RIO_ASSERT(mRenderPending);
+
+    EDITOR_TRACE_SCOPE("RenderThumbnail");
+
+    Entry& entry = mEntries[mRenderSet];
+    mColorTarget.linkTexture2D(*entry.texture);
+
+    entry.texture->setCompMap(0x00010203);
+    mRenderBuffer.clear(rio::RenderBuffer::CLEAR_FLAG_COLOR_DEPTH, { 0.0f, 0.0f, 0.0f, 1.0f });
+    mRenderBuffer.bind();
+}
+
+void ThumbnailCache::endRender()
+{
+    RIO_ASSERT(mRenderPending);
+
+    Entry& entry = mEntries[mRenderSet];
+
+#if RIO_IS_WIN
+    Readback readback;
+    readback.path = getPath_(entry);
+
+    RIO_GL_CALL(glGenBuffers(1, &readback.buffer));
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+    RIO_GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, cFrameSize, nullptr, GL_STREAM_READ));
+    RIO_GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    RIO_GL_CALL(glReadPixels(0, 0, cSize, cSize, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    mReadbacks.push_back(std::move(readback));
+#endif // RIO_IS_WIN
+
+    entry.texture->setCompMap(0x00010205);
+    entry.state = STATE_READY;
+
+    mStats.ready_num++;
+    mStats.rendered_num++;
+
+    finishRender_();
+}
+
+void ThumbnailCache::finishRender_()
+{
+    if (mHandle.IsValid())
+        mHandle.GetEmitterSet()->Kill();
+
+    mRenderSet = -1;
+    mRenderPending = false;
+}
+
+void ThumbnailCache::uploadLoaded_()
+{
+    std::vector<Loaded> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mLoadedMutex);
+        loaded.swap(mLoaded);
+    }
+
+    for (Loaded& item : loaded)
+    {
+        if (item.generation != mGeneration)
+            continue;
+
+        mLoadingNum--;
+
+        Entry& entry = mEntries[item.set_index];
+
+        // Unreadable cache file: render it again
+        if (item.rgba.empty())
+        {
+            entry.state = STATE_QUEUED;
+            std::filesystem::remove(getPath_(entry));
+            mQueue.push_front(item.set_index);
+            continue;
+        }
+
+        createTexture_(entry);
+
+#if RIO_IS_WIN
+        RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, GLuint(entry.texture->getNativeTextureHandle())));
+        RIO_GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        RIO_GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cSize, cSize, GL_RGBA, GL_UNSIGNED_BYTE, item.rgba.data()));
+        RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+#endif // RIO_IS_WIN
+
+        entry.texture->setCompMap(0x00010205);
+        entry.state = STATE_READY;
+
+        mStats.ready_num++;
+        mStats.loaded_num++;
+    }
+}
+
+void ThumbnailCache::collectReadbacks_(bool wait)
+{
+#if RIO_IS_WIN
+    for (auto it = mReadbacks.begin(); it != mReadbacks.end(); )
+    {
+        GLsync fence = static_cast<GLsync>(it->fence);
+
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            ++it;
+            continue;
+        }
+
+        RIO_GL_CALL(glDeleteSync(fence));
+
+        std::shared_ptr<std::vector<u8>> pixels = std::make_shared<std::vector<u8>>(cFrameSize);
+
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, it->buffer));
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, cFrameSize, GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            std::memcpy(pixels->data(), mapped, cFrameSize);
+            RIO_GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        RIO_GL_CALL(glDeleteBuffers(1, &it->buffer));
+
+        if (mapped)
+        {
+            const std::string path = it->path;
+            mpThreadPool->submit([path, pixels]()
+            {
+                WritePng(path.c_str(), pixels->data(), cSize, cSize, cSize * 4);
+            });
+        }
+
+        it = mReadbacks.erase(it);
+    }
+#endif // RIO_IS_WIN
+}
+
+void ThumbnailCache::createTexture_(Entry& entry)
+{
+    if (!entry.texture)
+        entry.texture = new rio::Texture2D(rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM, cSize, cSize, 1);
+}
+
+std::string ThumbnailCache::getPath_(const Entry& entry) const
+{
+    return mDirectory + "/" + entry.hash + ".png";
+}
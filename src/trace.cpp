@@ -0,0 +1,134 @@
+#include <trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+// Single-producer ring buffer, only ever written by its owning thread.
+// Readers snapshot the write head and copy out what is behind it.
+struct TraceThreadBuffer
+{
+    std::atomic<u64>    head;
+    u32                 tid;
+    Trace::Event        events[Trace::cEventNumPerThread];
+};
+
+static std::atomic<TraceThreadBuffer*>  sThreadBuffer[Trace::cThreadNumMax];
+static std::atomic<u32>                 sThreadNum(0);
+static std::atomic<bool>                sEnabled(true);
+
+static const std::chrono::steady_clock::time_point sStartTime = std::chrono::steady_clock::now();
+
+static thread_local TraceThreadBuffer*  tThreadBuffer = nullptr;
+static thread_local bool                tThreadBufferFull = false;
+
+static TraceThreadBuffer* GetThreadBuffer()
+{
+    if (tThreadBuffer || tThreadBufferFull)
+        return tThreadBuffer;
+
+    const u32 index = sThreadNum.fetch_add(1, std::memory_order_relaxed);
+    if (index >= Trace::cThreadNumMax)
+    {
+        // Out of slots, this thread goes unrecorded
+        tThreadBufferFull = true;
+        return nullptr;
+    }
+
+    // Intentionally never freed so that threads which already exited
+    // still show up in the dump
+    TraceThreadBuffer* buffer = new TraceThreadBuffer;
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->tid = index;
+
+    sThreadBuffer[index].store(buffer, std::memory_order_release);
+    tThreadBuffer = buffer;
+    return buffer;
+}
+
+u64 Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sStartTime).count();
+}
+
+void Trace::setEnabled(bool enabled)
+{
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Trace::isEnabled()
+{
+    return sEnabled.load(std::memory_order_relaxed);
+}
+
+void Trace::record(const char* name, u64 begin, u64 end)
+{
+    if (!isEnabled())
+        return;
+
+    TraceThreadBuffer* buffer = GetThreadBuffer();
+    if (!buffer)
+        return;
+
+    const u64 head = buffer->head.load(std::memory_order_relaxed);
+
+    Event& event = buffer->events[head % cEventNumPerThread];
+    event.name  = name;
+    event.begin = begin;
+    event.end   = end;
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+bool Trace::dump(const char* filename)
+{
+    FILE* file = std::fopen(filename, "wb");
+    if (!file)
+    {
+        RIO_LOG("Trace: could not open %s for writing\n", filename);
+        return false;
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+
+    // Events this close to being overwritten may be torn by a concurrent
+    // writer, so they are skipped
+    static constexpr u64 cOverwriteMargin = 64;
+
+    bool first = true;
+    u32 event_num = 0;
+
+    const u32 thread_num = std::min<u32>(sThreadNum.load(std::memory_order_relaxed), cThreadNumMax);
+    for (u32 i = 0; i < thread_num; i++)
+    {
+        const TraceThreadBuffer* buffer = sThreadBuffer[i].load(std::memory_order_acquire);
+        if (!buffer)
+            continue;
+
+        const u64 head = buffer->head.load(std::memory_order_acquire);
+        u64 tail = 0;
+        if (head > cEventNumPerThread - cOverwriteMargin)
+            tail = head - (cEventNumPerThread - cOverwriteMargin);
+
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                     first ? "" : ",\n", buffer->tid, buffer->tid == 0 ? "Main" : "Worker", buffer->tid);
+        first = false;
+
+        for (u64 j = tail; j < head; j++)
+        {
+            const Event& event = buffer->events[j % cEventNumPerThread];
+
+            // Chrome trace timestamps are in microseconds
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"editor\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.name, buffer->tid, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+            event_num++;
+        }
+    }
+
+    std::fputs("\n]}\n", file);
+    std::fclose(file);
+
+    RIO_LOG("Trace: wrote %u events to %s\n", event_num, filename);
+    return true;
+}
@@ -0,0 +1,419 @@
+#include <trace.h>
+#include <undo_journal.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if RIO_IS_WIN
+    #include <windows.h>
+#endif // RIO_IS_WIN
+
+// Unchanged bytes between two changed runs of a bulk page are kept in the
+// same entry rather than starting a new one
+static constexpr u32 cBulkMergeGap = 16;
+
+// Exception handlers are process-wide, so there is a single bulk snapshot
+struct BulkSnapshot
+{
+    struct Page
+    {
+        uintptr_t               address;
+        std::unique_ptr<u8[]>   bytes;
+    };
+
+    std::mutex          mutex;
+    const UndoJournal*  owner = nullptr;
+    uintptr_t           protect_begin = 0;  // Pages fully inside the buffer
+    uintptr_t           protect_end = 0;
+    u32                 page_size = 0;
+    std::vector<Page>   pages;
+};
+
+static BulkSnapshot sBulkSnapshot;
+
+static inline void CopyPage(uintptr_t address, u32 page_size)
+{
+    BulkSnapshot::Page page;
+    page.address = address;
+    page.bytes.reset(new u8[page_size]);
+    std::memcpy(page.bytes.get(), reinterpret_cast<const void*>(address), page_size);
+
+    sBulkSnapshot.pages.push_back(std::move(page));
+}
+
+#if RIO_IS_WIN
+
+static LONG CALLBACK BulkSnapshotHandler(PEXCEPTION_POINTERS info)
+{
+    const EXCEPTION_RECORD* record = info->ExceptionRecord;
+    if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || record->NumberParameters < 2 || record->ExceptionInformation[0] != 1)
+        return EXCEPTION_CONTINUE_SEARCH;
+
+    const uintptr_t address = record->ExceptionInformation[1];
+
+    std::lock_guard<std::mutex> lock(sBulkSnapshot.mutex);
+
+    if (address < sBulkSnapshot.protect_begin || address >= sBulkSnapshot.protect_end)
+        return EXCEPTION_CONTINUE_SEARCH;
+
+    // endBulk() made the pages writable again while this thread waited
+    if (!sBulkSnapshot.owner)
+        return EXCEPTION_CONTINUE_EXECUTION;
+
+    const uintptr_t page = address & ~uintptr_t(sBulkSnapshot.page_size - 1);
+
+    // Another thread may have copied it while this one waited
+    const bool copied = std::any_of(sBulkSnapshot.pages.begin(), sBulkSnapshot.pages.end(),
+                                    [page](const BulkSnapshot::Page& p) { return p.address == page; });
+    if (!copied)
+        CopyPage(page, sBulkSnapshot.page_size);
+
+    DWORD old_protect;
+    VirtualProtect(reinterpret_cast<void*>(page), sBulkSnapshot.page_size, PAGE_READWRITE, &old_protect);
+
+    return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+#endif // RIO_IS_WIN
+
+UndoJournal::UndoJournal()
+    : mpBase(nullptr)
+    , mSize(0)
+    , mCursor(0)
+    , mGroupDepth(0)
+    , mInBulk(false)
+    , mByteNum(0)
+    , mCoalescedNum(0)
+    , mDroppedNum(0)
+    , mBulkPageNum(0)
+{
+}
+
+UndoJournal::~UndoJournal()
+{
+    if (mInBulk)
+        endBulk(cNoOwner, 0);
+}
+
+void UndoJournal::attach(u8* base, u32 size)
+{
+    clear();
+
+    mpBase = base;
+    mSize = size;
+}
+
+void UndoJournal::clear()
+{
+    RIO_ASSERT(!mInBulk);
+
+    mSteps.clear();
+    mCursor = 0;
+    mGroupDepth = 0;
+    mByteNum = 0;
+    mCoalescedNum = 0;
+    mDroppedNum = 0;
+    mBulkPageNum = 0;
+}
+
+UndoJournal::Step& UndoJournal::pushStep_()
+{
+    // A new step discards everything that could be redone
+    while (mSteps.size() > mCursor)
+    {
+        mByteNum -= getStepByteNum_(mSteps.back());
+        mSteps.pop_back();
+    }
+
+    mSteps.emplace_back();
+    mSteps.back().coalescable = false;
+    mCursor++;
+    mByteNum += getStepByteNum_(mSteps.back());
+
+    return mSteps.back();
+}
+
+void UndoJournal::addEntry_(Step& step, u32 offset, const void* old_bytes, const void* new_bytes, u32 size, u32 owner, u32 tag)
+{
+    const u64 prev_byte_num = getStepByteNum_(step);
+
+    step.entries.push_back(Entry{ offset, size, u32(step.data.size()), owner, tag });
+    step.data.insert(step.data.end(), static_cast<const u8*>(old_bytes), static_cast<const u8*>(old_bytes) + size);
+    step.data.insert(step.data.end(), static_cast<const u8*>(new_bytes), static_cast<const u8*>(new_bytes) + size);
+
+    mByteNum += getStepByteNum_(step) - prev_byte_num;
+}
+
+void UndoJournal::record(const void* address, const void* old_bytes, u32 size, u32 owner, u32 tag)
+{
+    RIO_ASSERT(!mInBulk);
+
+    const u8* bytes = static_cast<const u8*>(address);
+    RIO_ASSERT(bytes >= mpBase && bytes + size <= mpBase + mSize);
+
+    const u32 offset = bytes - mpBase;
+
+    if (mGroupDepth == 0 && mCursor > 0 && mCursor == mSteps.size())
+    {
+        Step& last = mSteps.back();
+        if (last.coalescable && last.entries.size() == 1 && last.entries[0].offset == offset && last.entries[0].size == size)
+        {
+            // Keep the oldest value, take the newest
+            std::memcpy(last.data.data() + last.entries[0].data + size, bytes, size);
+            mCoalescedNum++;
+            return;
+        }
+    }
+
+    if (mGroupDepth > 0 && mCursor > 0 && mCursor == mSteps.size())
+    {
+        addEntry_(mSteps.back(), offset, old_bytes, bytes, size, owner, tag);
+        return;
+    }
+
+    Step& step = pushStep_();
+    step.coalescable = true;
+    addEntry_(step, offset, old_bytes, bytes, size, owner, tag);
+
+    trim_();
+}
+
+void UndoJournal::seal()
+{
+    if (!mSteps.empty())
+        mSteps.back().coalescable = false;
+}
+
+void UndoJournal::beginGroup()
+{
+    if (mGroupDepth++ == 0)
+        pushStep_();
+}
+
+void UndoJournal::endGroup()
+{
+    RIO_ASSERT(mGroupDepth > 0);
+    if (--mGroupDepth > 0)
+        return;
+
+    // Nothing was recorded
+    if (mSteps.back().entries.empty())
+    {
+        mByteNum -= getStepByteNum_(mSteps.back());
+        mSteps.pop_back();
+        mCursor--;
+    }
+
+    trim_();
+}
+
+bool UndoJournal::beginBulk()
+{
+    RIO_ASSERT(!mInBulk && mGroupDepth == 0);
+
+    std::lock_guard<std::mutex> lock(sBulkSnapshot.mutex);
+
+    if (!mpBase || sBulkSnapshot.owner)
+        return false;
+
+    EDITOR_TRACE_SCOPE("BeginBulkEdit");
+
+    sBulkSnapshot.owner = this;
+    sBulkSnapshot.pages.clear();
+
+    const uintptr_t begin = uintptr_t(mpBase);
+    const uintptr_t end = begin + mSize;
+
+#if RIO_IS_WIN
+    static const PVOID handler = AddVectoredExceptionHandler(1, &BulkSnapshotHandler);
+    (void)handler;
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    sBulkSnapshot.page_size = system_info.dwPageSize;
+#else
+    sBulkSnapshot.page_size = 4096;
+#endif // RIO_IS_WIN
+
+    const uintptr_t page_mask = uintptr_t(sBulkSnapshot.page_size - 1);
+    const uintptr_t first_page = begin & ~page_mask;
+    const uintptr_t last_page = (end - 1) & ~page_mask;
+
+    sBulkSnapshot.protect_begin = (begin + page_mask) & ~page_mask;
+    sBulkSnapshot.protect_end = end & ~page_mask;
+    if (sBulkSnapshot.protect_end < sBulkSnapshot.protect_begin)
+        sBulkSnapshot.protect_end = sBulkSnapshot.protect_begin;
+
+#if RIO_IS_WIN
+    // Pages shared with other allocations are copied up front, so a fault
+    // never lands inside the allocator
+    if (first_page < sBulkSnapshot.protect_begin || first_page >= sBulkSnapshot.protect_end)
+        CopyPage(first_page, sBulkSnapshot.page_size);
+    if (last_page != first_page && last_page >= sBulkSnapshot.protect_end)
+        CopyPage(last_page, sBulkSnapshot.page_size);
+
+    DWORD old_protect;
+    if (sBulkSnapshot.protect_end > sBulkSnapshot.protect_begin &&
+        !VirtualProtect(reinterpret_cast<void*>(sBulkSnapshot.protect_begin), sBulkSnapshot.protect_end - sBulkSnapshot.protect_begin, PAGE_READONLY, &old_protect))
+    {
+        // Copy everything instead
+        for (uintptr_t page = sBulkSnapshot.protect_begin; page < sBulkSnapshot.protect_end; page += sBulkSnapshot.page_size)
+            CopyPage(page, sBulkSnapshot.page_size);
+
+        sBulkSnapshot.protect_begin = sBulkSnapshot.protect_end = 0;
+    }
+#else
+    for (uintptr_t page = first_page; page <= last_page; page += sBulkSnapshot.page_size)
+        CopyPage(page, sBulkSnapshot.page_size);
+
+    sBulkSnapshot.protect_begin = sBulkSnapshot.protect_end = 0;
+#endif // RIO_IS_WIN
+
+    mInBulk = true;
+    return true;
+}
+
+void UndoJournal::endBulk(u32 owner, u32 tag)
+{
+    RIO_ASSERT(mInBulk);
+
+    EDITOR_TRACE_SCOPE("EndBulkEdit");
+
+    std::lock_guard<std::mutex> lock(sBulkSnapshot.mutex);
+
+#if RIO_IS_WIN
+    if (sBulkSnapshot.protect_end > sBulkSnapshot.protect_begin)
+    {
+        DWORD old_protect;
+        VirtualProtect(reinterpret_cast<void*>(sBulkSnapshot.protect_begin), sBulkSnapshot.protect_end - sBulkSnapshot.protect_begin, PAGE_READWRITE, &old_protect);
+    }
+#endif // RIO_IS_WIN
+
+    std::sort(sBulkSnapshot.pages.begin(), sBulkSnapshot.pages.end(),
+              [](const BulkSnapshot::Page& a, const BulkSnapshot::Page& b) { return a.address < b.address; });
+
+    mBulkPageNum = sBulkSnapshot.pages.size();
+
+    Step& step = pushStep_();
+
+    const uintptr_t begin = uintptr_t(mpBase);
+    const uintptr_t end = begin + mSize;
+
+    for (const BulkSnapshot::Page& page : sBulkSnapshot.pages)
+    {
+        const uintptr_t from = std::max(page.address, begin);
+        const uintptr_t to = std::min(page.address + sBulkSnapshot.page_size, end);
+
+        const u8* old_bytes = page.bytes.get() + (from - page.address);
+        const u8* new_bytes = reinterpret_cast<const u8*>(from);
+        const u32 size = to - from;
+
+        u32 i = 0;
+        while (i < size)
+        {
+            if (old_bytes[i] == new_bytes[i])
+            {
+                i++;
+                continue;
+            }
+
+            // Extend the run over short unchanged gaps
+            u32 run_end = i + 1;
+            for (u32 j = run_end; j < size && j < run_end + cBulkMergeGap; j++)
+            {
+                if (old_bytes[j] != new_bytes[j])
+                    run_end = j + 1;
+            }
+
+            addEntry_(step, from - begin + i, old_bytes + i, new_bytes + i, run_end - i, owner, tag);
+            i = run_end;
+        }
+    }
+
+    sBulkSnapshot.pages.clear();
+    sBulkSnapshot.pages.shrink_to_fit();
+    sBulkSnapshot.owner = nullptr;
+    mInBulk = false;
+
+    if (step.entries.empty())
+    {
+        mByteNum -= getStepByteNum_(step);
+        mSteps.pop_back();
+        mCursor--;
+        return;
+    }
+
+    trim_();
+}
+
+bool UndoJournal::undo(std::vector<Change>* changes)
+{
+    RIO_ASSERT(!mInBulk && mGroupDepth == 0);
+
+    if (!canUndo())
+        return false;
+
+    Step& step = mSteps[--mCursor];
+    step.coalescable = false;
+
+    for (auto it = step.entries.rbegin(); it != step.entries.rend(); ++it)
+    {
+        std::memcpy(mpBase + it->offset, step.data.data() + it->data, it->size);
+        changes->push_back(Change{ it->offset, it->size, it->owner, it->tag });
+    }
+
+    return true;
+}
+
+bool UndoJournal::redo(std::vector<Change>* changes)
+{
+    RIO_ASSERT(!mInBulk && mGroupDepth == 0);
+
+    if (!canRedo())
+        return false;
+
+    const Step& step = mSteps[mCursor++];
+
+    for (const Entry& entry : step.entries)
+    {
+        std::memcpy(mpBase + entry.offset, step.data.data() + entry.data + entry.size, entry.size);
+        changes->push_back(Change{ entry.offset, entry.size, entry.owner, entry.tag });
+    }
+
+    return true;
+}
+
+void UndoJournal::trim_()
+{
+    // The step being grouped is never dropped
+    while (mCursor > 1 && (mSteps.size() > cStepNumMax || mByteNum > cByteNumMax))
+    {
+        mByteNum -= getStepByteNum_(mSteps.front());
+        mSteps.pop_front();
+        mCursor--;
+        mDroppedNum++;
+    }
+}
+
+u64 UndoJournal::getStepByteNum_(const Step& step)
+{
+    return sizeof(Step) + step.entries.capacity() * sizeof(Entry) + step.data.capacity();
+}
+
+UndoJournal::Stats UndoJournal::getStats() const
+{
+    Stats stats;
+    stats.undo_num = mCursor;
+    stats.redo_num = mSteps.size() - mCursor;
+    stats.entry_num = 0;
+    for (const Step& step : mSteps)
+        stats.entry_num += step.entries.size();
+    stats.byte_num = mByteNum;
+    stats.coalesced_num = mCoalescedNum;
+    stats.dropped_num = mDroppedNum;
+    stats.bulk_page_num = mBulkPageNum;
+
+    return stats;
+}
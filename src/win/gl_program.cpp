@@ -0,0 +1,93 @@
+#include <gl_program.hpp>
+
+#include <misc/gl/rio_GL.h>
+
+#include <vector>
+
+bool ReadContentFile(const char* filename, u8** out_data, u32* out_size);
+void FreeContentFile(const void* data);
+
+static GLuint CompileShader(GLenum type, const char* fname)
+{
+    u8* source = nullptr;
+    u32 source_len = 0;
+
+    if (!ReadContentFile(fname, &source, &source_len))
+    {
+        RIO_LOG("Could not read shader %s\n", fname);
+        return 0;
+    }
+
+    GLuint shader = glCreateShader(type);
+
+    const GLchar* source_str = reinterpret_cast<const GLchar*>(source);
+    const GLint source_str_len = source_len;
+    RIO_GL_CALL(glShaderSource(shader, 1, &source_str, &source_str_len));
+    RIO_GL_CALL(glCompileShader(shader));
+
+    FreeContentFile(source);
+
+    GLint status = GL_FALSE;
+    RIO_GL_CALL(glGetShaderiv(shader, GL_COMPILE_STATUS, &status));
+    if (status == GL_FALSE)
+    {
+        GLint log_len = 0;
+        RIO_GL_CALL(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_len));
+
+        std::vector<GLchar> log(log_len + 1, '\0');
+        RIO_GL_CALL(glGetShaderInfoLog(shader, log_len, nullptr, log.data()));
+        RIO_LOG("Failed to compile %s:\n%s\n", fname, log.data());
+
+        RIO_GL_CALL(glDeleteShader(shader));
+        return 0;
+    }
+
+    return shader;
+}
+
+u32 CreateProgramFromContent(const char* vertex_fname, const char* fragment_fname)
+{
+    GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, vertex_fname);
+    if (!vertex_shader)
+        return 0;
+
+    GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, fragment_fname);
+    if (!fragment_shader)
+    {
+        RIO_GL_CALL(glDeleteShader(vertex_shader));
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    RIO_GL_CALL(glAttachShader(program, vertex_shader));
+    RIO_GL_CALL(glAttachShader(program, fragment_shader));
+    RIO_GL_CALL(glLinkProgram(program));
+
+    RIO_GL_CALL(glDeleteShader(vertex_shader));
+    RIO_GL_CALL(glDeleteShader(fragment_shader));
+
+    GLint status = GL_FALSE;
+    RIO_GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    if (status == GL_FALSE)
+    {
+        GLint log_len = 0;
+        RIO_GL_CALL(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_len));
+
+        std::vector<GLchar> log(log_len + 1, '\0');
+        RIO_GL_CALL(glGetProgramInfoLog(program, log_len, nullptr, log.data()));
+        RIO_LOG("Failed to link %s + %s:\n%s\n", vertex_fname, fragment_fname, log.data());
+
+        RIO_GL_CALL(glDeleteProgram(program));
+        return 0;
+    }
+
+    return program;
+}
+
+void DestroyProgram(u32 program)
+{
+    if (program)
+    {
+        RIO_GL_CALL(glDeleteProgram(program));
+    }
+}
@@ -1,4 +1,5 @@
 #include <globals.hpp>
+#include <trace.h>
 
 #include <algorithm>
 
@@ -27,6 +28,8 @@ ShaderCacheMap g_ShaderCache;
 
 void RunCommand(const char* cmd)
 {
+    EDITOR_TRACE_SCOPE("RunCommand");
+
     STARTUPINFOA si = { sizeof(STARTUPINFOA), 0 };
     si.dwFlags = STARTF_USESHOWWINDOW;
     si.wShowWindow = SW_HIDE;